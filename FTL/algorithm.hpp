@@ -0,0 +1,534 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // int32_t, uint8_t
+#include <algorithm> // std::find and friends, used as the scalar fallback
+#include <numeric> // accumulate
+#include <atomic> // atomic
+#include <type_traits> // integral_constant
+
+// Search, reduction and comparison algorithms over contiguous containers, vectorized for the element types
+// where it pays off: int32_t, float and uint8_t, plus any byte sized integral type for the equality based algorithms.
+// Every algorithm takes its range through data() and size(), so any ftl container or std::vector/std::string works.
+// The instruction set is chosen at runtime (AVX2, then SSE2), and other element types or targets fall back to std::.
+//
+// Float results follow operator< and operator== like the std:: algorithms do, with two exceptions:
+// which element min_element/max_element pick is unspecified when the range contains a NaN,
+// and sum adds the elements in a different order, so it may round differently than std::accumulate.
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FTL_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h> // __cpuidex, _BitScanForward
+#endif
+#endif
+
+namespace ftl {
+
+  enum class simd_level { scalar, sse2, avx2 };
+
+  namespace detail {
+    inline simd_level detect_simd_level() noexcept {
+#if defined(FTL_SIMD_X86) && defined(_MSC_VER) && !defined(__clang__)
+      int regs[4];
+      __cpuid(regs, 0);
+      if (regs[0] < 7) return simd_level::sse2;
+      __cpuid(regs, 1);
+      const bool osxsave{ (regs[2] & (1 << 27)) != 0 };
+      const bool avx{ (regs[2] & (1 << 28)) != 0 };
+      // The OS must also save the ymm registers on context switches.
+      if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return simd_level::sse2;
+      __cpuidex(regs, 7, 0);
+      return (regs[1] & (1 << 5)) ? simd_level::avx2 : simd_level::sse2;
+#elif defined(FTL_SIMD_X86)
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") ? simd_level::avx2 : simd_level::sse2;
+#else
+      return simd_level::scalar;
+#endif
+    }
+
+    inline ::std::atomic<simd_level>& active_simd_level() noexcept {
+      static ::std::atomic<simd_level> level{ detect_simd_level() };
+      return level;
+    }
+  } // namespace detail
+
+  // The instruction set the algorithms below currently use.
+  inline simd_level current_simd_level() noexcept {
+    return detail::active_simd_level().load(::std::memory_order_relaxed);
+  }
+
+  // Caps the instruction set used by the algorithms below, e.g. to benchmark or test the narrower paths.
+  // Levels the CPU does not support are ignored. Returns the level now in use.
+  inline simd_level limit_simd_level(simd_level level) noexcept {
+    const simd_level supported{ detail::detect_simd_level() };
+    const simd_level chosen{ level < supported ? level : supported };
+    detail::active_simd_level().store(chosen, ::std::memory_order_relaxed);
+    return chosen;
+  }
+
+  // The type sum() accumulates into: wide enough that summing a container of int32_t or uint8_t cannot overflow.
+  template<typename T> struct accumulator_type { using type = T; };
+  template<> struct accumulator_type<::std::int32_t> { using type = ::std::int64_t; };
+  template<> struct accumulator_type<::std::uint8_t> { using type = ::std::uint64_t; };
+
+  namespace detail {
+    // Element types with vectorized ordering and arithmetic.
+    template<typename T>
+    struct is_simd_arithmetic : ::std::integral_constant<bool,
+      ::std::is_same<T, ::std::int32_t>::value || ::std::is_same<T, float>::value || ::std::is_same<T, ::std::uint8_t>::value> {};
+
+    // Element types whose equality is a bitwise comparison, which the byte kernels can run on as uint8_t.
+    template<typename T>
+    struct is_simd_byte : ::std::integral_constant<bool,
+      ::std::is_integral<T>::value && sizeof(T) == 1 && !::std::is_same<T, bool>::value> {};
+
+    // Element types with vectorized equality.
+    template<typename T>
+    struct is_simd_equality : ::std::integral_constant<bool,
+      is_simd_arithmetic<T>::value || is_simd_byte<T>::value> {};
+
+    template<typename T>
+    struct simd_equality_type { using type = T; };
+    template<> struct simd_equality_type<char> { using type = ::std::uint8_t; };
+    template<> struct simd_equality_type<signed char> { using type = ::std::uint8_t; };
+
+#if defined(FTL_SIMD_X86)
+    inline unsigned count_trailing_zeros(unsigned mask) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+      unsigned long index;
+      _BitScanForward(&index, mask);
+      return static_cast<unsigned>(index);
+#else
+      return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    inline unsigned population_count(unsigned mask) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+      // __popcnt needs the POPCNT extension, which SSE2 alone does not guarantee.
+      mask = mask - ((mask >> 1) & 0x55555555u);
+      mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+      return (((mask + (mask >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+#else
+      return static_cast<unsigned>(__builtin_popcount(mask));
+#endif
+    }
+
+    namespace sse2 {
+      template<typename T> struct ops;
+
+      template<>
+      struct ops<::std::int32_t> {
+        using reg = __m128i;
+        static constexpr ::std::size_t width{ 4 };
+        static reg load(const ::std::int32_t *p) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+        static void store(::std::int32_t *p, reg r) noexcept { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), r); }
+        static reg splat(::std::int32_t v) noexcept { return _mm_set1_epi32(v); }
+        static unsigned eq(reg a, reg b) noexcept { return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b)))); }
+        // SSE2 has no 32 bit min/max, so select through a comparison mask.
+        static reg min(reg a, reg b) noexcept {
+          const reg less{ _mm_cmplt_epi32(a, b) };
+          return _mm_or_si128(_mm_and_si128(less, a), _mm_andnot_si128(less, b));
+        }
+        static reg max(reg a, reg b) noexcept {
+          const reg greater{ _mm_cmpgt_epi32(a, b) };
+          return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+        }
+        using sum_type = ::std::int64_t;
+        using acc = __m128i;
+        static acc acc_zero() noexcept { return _mm_setzero_si128(); }
+        static acc acc_add(acc s, reg v) noexcept {
+          // Sign extend to 64 bits by interleaving each lane with its sign.
+          const reg sign{ _mm_srai_epi32(v, 31) };
+          s = _mm_add_epi64(s, _mm_unpacklo_epi32(v, sign));
+          return _mm_add_epi64(s, _mm_unpackhi_epi32(v, sign));
+        }
+        static sum_type acc_reduce(acc s) noexcept {
+          ::std::int64_t lanes[2];
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), s);
+          return lanes[0] + lanes[1];
+        }
+      };
+
+      template<>
+      struct ops<float> {
+        using reg = __m128;
+        static constexpr ::std::size_t width{ 4 };
+        static reg load(const float *p) noexcept { return _mm_loadu_ps(p); }
+        static void store(float *p, reg r) noexcept { _mm_storeu_ps(p, r); }
+        static reg splat(float v) noexcept { return _mm_set1_ps(v); }
+        static unsigned eq(reg a, reg b) noexcept { return static_cast<unsigned>(_mm_movemask_ps(_mm_cmpeq_ps(a, b))); }
+        static reg min(reg a, reg b) noexcept { return _mm_min_ps(a, b); }
+        static reg max(reg a, reg b) noexcept { return _mm_max_ps(a, b); }
+        using sum_type = float;
+        using acc = __m128;
+        static acc acc_zero() noexcept { return _mm_setzero_ps(); }
+        static acc acc_add(acc s, reg v) noexcept { return _mm_add_ps(s, v); }
+        static sum_type acc_reduce(acc s) noexcept {
+          float lanes[4];
+          _mm_storeu_ps(lanes, s);
+          return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+      };
+
+      template<>
+      struct ops<::std::uint8_t> {
+        using reg = __m128i;
+        static constexpr ::std::size_t width{ 16 };
+        static reg load(const ::std::uint8_t *p) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+        static void store(::std::uint8_t *p, reg r) noexcept { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), r); }
+        static reg splat(::std::uint8_t v) noexcept { return _mm_set1_epi8(static_cast<char>(v)); }
+        static unsigned eq(reg a, reg b) noexcept { return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))); }
+        static reg min(reg a, reg b) noexcept { return _mm_min_epu8(a, b); }
+        static reg max(reg a, reg b) noexcept { return _mm_max_epu8(a, b); }
+        using sum_type = ::std::uint64_t;
+        using acc = __m128i;
+        static acc acc_zero() noexcept { return _mm_setzero_si128(); }
+        // The sum of absolute differences against zero adds each half of the register into a 64 bit lane.
+        static acc acc_add(acc s, reg v) noexcept { return _mm_add_epi64(s, _mm_sad_epu8(v, _mm_setzero_si128())); }
+        static sum_type acc_reduce(acc s) noexcept {
+          ::std::uint64_t lanes[2];
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), s);
+          return lanes[0] + lanes[1];
+        }
+      };
+
+#include "algorithm_kernels.inl"
+    } // namespace sse2
+
+    // The AVX2 kernels are compiled for AVX2 regardless of the compiler flags, and only called once the CPU has been checked.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+    namespace avx2 {
+      template<typename T> struct ops;
+
+      template<>
+      struct ops<::std::int32_t> {
+        using reg = __m256i;
+        static constexpr ::std::size_t width{ 8 };
+        static reg load(const ::std::int32_t *p) noexcept { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void store(::std::int32_t *p, reg r) noexcept { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), r); }
+        static reg splat(::std::int32_t v) noexcept { return _mm256_set1_epi32(v); }
+        static unsigned eq(reg a, reg b) noexcept { return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)))); }
+        static reg min(reg a, reg b) noexcept { return _mm256_min_epi32(a, b); }
+        static reg max(reg a, reg b) noexcept { return _mm256_max_epi32(a, b); }
+        using sum_type = ::std::int64_t;
+        using acc = __m256i;
+        static acc acc_zero() noexcept { return _mm256_setzero_si256(); }
+        static acc acc_add(acc s, reg v) noexcept {
+          s = _mm256_add_epi64(s, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+          return _mm256_add_epi64(s, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+        }
+        static sum_type acc_reduce(acc s) noexcept {
+          ::std::int64_t lanes[4];
+          _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), s);
+          return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+      };
+
+      template<>
+      struct ops<float> {
+        using reg = __m256;
+        static constexpr ::std::size_t width{ 8 };
+        static reg load(const float *p) noexcept { return _mm256_loadu_ps(p); }
+        static void store(float *p, reg r) noexcept { _mm256_storeu_ps(p, r); }
+        static reg splat(float v) noexcept { return _mm256_set1_ps(v); }
+        static unsigned eq(reg a, reg b) noexcept { return static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ))); }
+        static reg min(reg a, reg b) noexcept { return _mm256_min_ps(a, b); }
+        static reg max(reg a, reg b) noexcept { return _mm256_max_ps(a, b); }
+        using sum_type = float;
+        using acc = __m256;
+        static acc acc_zero() noexcept { return _mm256_setzero_ps(); }
+        static acc acc_add(acc s, reg v) noexcept { return _mm256_add_ps(s, v); }
+        static sum_type acc_reduce(acc s) noexcept {
+          float lanes[8];
+          _mm256_storeu_ps(lanes, s);
+          return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+        }
+      };
+
+      template<>
+      struct ops<::std::uint8_t> {
+        using reg = __m256i;
+        static constexpr ::std::size_t width{ 32 };
+        static reg load(const ::std::uint8_t *p) noexcept { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void store(::std::uint8_t *p, reg r) noexcept { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), r); }
+        static reg splat(::std::uint8_t v) noexcept { return _mm256_set1_epi8(static_cast<char>(v)); }
+        static unsigned eq(reg a, reg b) noexcept { return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b))); }
+        static reg min(reg a, reg b) noexcept { return _mm256_min_epu8(a, b); }
+        static reg max(reg a, reg b) noexcept { return _mm256_max_epu8(a, b); }
+        using sum_type = ::std::uint64_t;
+        using acc = __m256i;
+        static acc acc_zero() noexcept { return _mm256_setzero_si256(); }
+        static acc acc_add(acc s, reg v) noexcept { return _mm256_add_epi64(s, _mm256_sad_epu8(v, _mm256_setzero_si256())); }
+        static sum_type acc_reduce(acc s) noexcept {
+          ::std::uint64_t lanes[4];
+          _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), s);
+          return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+      };
+
+#include "algorithm_kernels.inl"
+    } // namespace avx2
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif // FTL_SIMD_X86
+
+    // Dispatchers over raw ranges. Each is only instantiated for the element types its kernels exist for.
+    template<typename T>
+    const T* simd_find(const T *first, const T *last, T value) noexcept {
+#if defined(FTL_SIMD_X86)
+      switch (current_simd_level()) {
+      case simd_level::avx2: return avx2::find(first, last, value);
+      case simd_level::sse2: return sse2::find(first, last, value);
+      default: break;
+      }
+#endif
+      return ::std::find(first, last, value);
+    }
+
+    template<typename T>
+    ::std::size_t simd_count(const T *first, const T *last, T value) noexcept {
+#if defined(FTL_SIMD_X86)
+      switch (current_simd_level()) {
+      case simd_level::avx2: return avx2::count(first, last, value);
+      case simd_level::sse2: return sse2::count(first, last, value);
+      default: break;
+      }
+#endif
+      return static_cast<::std::size_t>(::std::count(first, last, value));
+    }
+
+    template<typename T>
+    T simd_min_value(const T *first, const T *last) noexcept {
+#if defined(FTL_SIMD_X86)
+      switch (current_simd_level()) {
+      case simd_level::avx2: return avx2::min_value(first, last);
+      case simd_level::sse2: return sse2::min_value(first, last);
+      default: break;
+      }
+#endif
+      return *::std::min_element(first, last);
+    }
+
+    template<typename T>
+    T simd_max_value(const T *first, const T *last) noexcept {
+#if defined(FTL_SIMD_X86)
+      switch (current_simd_level()) {
+      case simd_level::avx2: return avx2::max_value(first, last);
+      case simd_level::sse2: return sse2::max_value(first, last);
+      default: break;
+      }
+#endif
+      return *::std::max_element(first, last);
+    }
+
+    template<typename T>
+    typename accumulator_type<T>::type simd_sum(const T *first, const T *last) noexcept {
+#if defined(FTL_SIMD_X86)
+      switch (current_simd_level()) {
+      case simd_level::avx2: return avx2::sum(first, last);
+      case simd_level::sse2: return sse2::sum(first, last);
+      default: break;
+      }
+#endif
+      return ::std::accumulate(first, last, typename accumulator_type<T>::type{ 0 });
+    }
+
+    template<typename T>
+    ::std::size_t simd_mismatch(const T *a, const T *b, ::std::size_t n) noexcept {
+#if defined(FTL_SIMD_X86)
+      switch (current_simd_level()) {
+      case simd_level::avx2: return avx2::mismatch(a, b, n);
+      case simd_level::sse2: return sse2::mismatch(a, b, n);
+      default: break;
+      }
+#endif
+      return static_cast<::std::size_t>(::std::mismatch(a, a + n, b).first - a);
+    }
+
+    inline const ::std::uint8_t* simd_find_first_of(const ::std::uint8_t *first, const ::std::uint8_t *last, const ::std::uint8_t *set, ::std::size_t set_size) noexcept {
+#if defined(FTL_SIMD_X86)
+      switch (current_simd_level()) {
+      case simd_level::avx2: return avx2::find_first_of(first, last, set, set_size);
+      case simd_level::sse2: return sse2::find_first_of(first, last, set, set_size);
+      default: break;
+      }
+#endif
+      return ::std::find_first_of(first, last, set, set + set_size);
+    }
+
+    template<typename T>
+    const typename simd_equality_type<T>::type* as_simd(const T *p) noexcept {
+      return reinterpret_cast<const typename simd_equality_type<T>::type*>(p);
+    }
+
+    template<typename Pointer, typename T>
+    Pointer find(Pointer first, ::std::size_t n, const T &value, ::std::true_type) noexcept {
+      using U = typename simd_equality_type<T>::type;
+      return first + (simd_find(as_simd(first), as_simd(first) + n, static_cast<U>(value)) - as_simd(first));
+    }
+    template<typename Pointer, typename T>
+    Pointer find(Pointer first, ::std::size_t n, const T &value, ::std::false_type) {
+      return ::std::find(first, first + n, value);
+    }
+
+    template<typename Pointer, typename T>
+    ::std::size_t count(Pointer first, ::std::size_t n, const T &value, ::std::true_type) noexcept {
+      using U = typename simd_equality_type<T>::type;
+      return simd_count(as_simd(first), as_simd(first) + n, static_cast<U>(value));
+    }
+    template<typename Pointer, typename T>
+    ::std::size_t count(Pointer first, ::std::size_t n, const T &value, ::std::false_type) {
+      return static_cast<::std::size_t>(::std::count(first, first + n, value));
+    }
+
+    // The extreme value is found with a vector pass, then located with a second one. Both stream through memory,
+    // which beats a single pass tracking the index in every lane for the element types supported here.
+    template<typename Pointer>
+    Pointer min_element(Pointer first, ::std::size_t n, ::std::true_type) noexcept {
+      if (n == 0) return first;
+      const auto *found = simd_find(&*first, &*first + n, simd_min_value(&*first, &*first + n));
+      // A float range with NaNs can reduce to a NaN, which compares unequal to every element.
+      if (found == &*first + n) return ::std::min_element(first, first + n);
+      return found - &*first + first;
+    }
+    template<typename Pointer>
+    Pointer min_element(Pointer first, ::std::size_t n, ::std::false_type) {
+      return ::std::min_element(first, first + n);
+    }
+
+    template<typename Pointer>
+    Pointer max_element(Pointer first, ::std::size_t n, ::std::true_type) noexcept {
+      if (n == 0) return first;
+      const auto *found = simd_find(&*first, &*first + n, simd_max_value(&*first, &*first + n));
+      if (found == &*first + n) return ::std::max_element(first, first + n);
+      return found - &*first + first;
+    }
+    template<typename Pointer>
+    Pointer max_element(Pointer first, ::std::size_t n, ::std::false_type) {
+      return ::std::max_element(first, first + n);
+    }
+
+    template<typename T>
+    typename accumulator_type<T>::type sum(const T *first, ::std::size_t n, ::std::true_type) noexcept {
+      return simd_sum(first, first + n);
+    }
+    template<typename T>
+    typename accumulator_type<T>::type sum(const T *first, ::std::size_t n, ::std::false_type) {
+      return ::std::accumulate(first, first + n, typename accumulator_type<T>::type{});
+    }
+
+    template<typename T>
+    bool equal(const T *a, const T *b, ::std::size_t n, ::std::true_type) noexcept {
+      return simd_mismatch(as_simd(a), as_simd(b), n) == n;
+    }
+    template<typename T>
+    bool equal(const T *a, const T *b, ::std::size_t n, ::std::false_type) {
+      return ::std::equal(a, a + n, b);
+    }
+
+    template<typename T>
+    bool lexicographical_compare(const T *a, ::std::size_t a_size, const T *b, ::std::size_t b_size, ::std::true_type) noexcept {
+      const ::std::size_t n{ a_size < b_size ? a_size : b_size };
+      ::std::size_t i{ 0 };
+      // Elements which compare unequal but unordered (NaNs) don't decide the comparison, so keep searching past them.
+      while ((i += simd_mismatch(a + i, b + i, n - i)) != n) {
+        if (a[i] < b[i]) return true;
+        if (b[i] < a[i]) return false;
+        ++i;
+      }
+      return a_size < b_size;
+    }
+    template<typename T>
+    bool lexicographical_compare(const T *a, ::std::size_t a_size, const T *b, ::std::size_t b_size, ::std::false_type) {
+      return ::std::lexicographical_compare(a, a + a_size, b, b + b_size);
+    }
+
+    template<typename Pointer, typename T>
+    Pointer find_first_of(Pointer first, ::std::size_t n, const T *set, ::std::size_t set_size, ::std::true_type) noexcept {
+      const ::std::uint8_t *bytes{ reinterpret_cast<const ::std::uint8_t*>(&*first) };
+      return first + (simd_find_first_of(bytes, bytes + n, reinterpret_cast<const ::std::uint8_t*>(set), set_size) - bytes);
+    }
+    template<typename Pointer, typename T>
+    Pointer find_first_of(Pointer first, ::std::size_t n, const T *set, ::std::size_t set_size, ::std::false_type) {
+      return ::std::find_first_of(first, first + n, set, set + set_size);
+    }
+
+    template<typename Container>
+    using container_value_t = typename ::std::remove_cv<typename ::std::remove_reference<decltype(*::std::declval<const Container&>().data())>::type>::type;
+  } // namespace detail
+
+  // Returns a pointer to the first element equal to value, or to the end of the container if there is none.
+  template<typename Container>
+  auto find(const Container &c, const detail::container_value_t<Container> &value) -> decltype(c.data()) {
+    using T = detail::container_value_t<Container>;
+    return detail::find(c.data(), c.size(), value, detail::is_simd_equality<T>{});
+  }
+
+  // Returns the number of elements equal to value.
+  template<typename Container>
+  ::std::size_t count(const Container &c, const detail::container_value_t<Container> &value) {
+    using T = detail::container_value_t<Container>;
+    return detail::count(c.data(), c.size(), value, detail::is_simd_equality<T>{});
+  }
+
+  // Returns a pointer to the first smallest element, or to the end of an empty container.
+  template<typename Container>
+  auto min_element(const Container &c) -> decltype(c.data()) {
+    using T = detail::container_value_t<Container>;
+    return detail::min_element(c.data(), c.size(), detail::is_simd_arithmetic<T>{});
+  }
+
+  // Returns a pointer to the first largest element, or to the end of an empty container.
+  template<typename Container>
+  auto max_element(const Container &c) -> decltype(c.data()) {
+    using T = detail::container_value_t<Container>;
+    return detail::max_element(c.data(), c.size(), detail::is_simd_arithmetic<T>{});
+  }
+
+  // Returns the sum of the elements, accumulated in accumulator_type.
+  template<typename Container>
+  typename accumulator_type<detail::container_value_t<Container>>::type sum(const Container &c) {
+    using T = detail::container_value_t<Container>;
+    return detail::sum<T>(c.data(), c.size(), detail::is_simd_arithmetic<T>{});
+  }
+
+  // Returns true if both containers hold the same number of elements and every pair compares equal.
+  template<typename Container1, typename Container2>
+  bool equal(const Container1 &a, const Container2 &b) {
+    using T = detail::container_value_t<Container1>;
+    static_assert(::std::is_same<T, detail::container_value_t<Container2>>::value, "ftl::equal compares containers of the same element type.");
+    return a.size() == b.size() && detail::equal<T>(a.data(), b.data(), a.size(), detail::is_simd_equality<T>{});
+  }
+
+  // Returns true if a orders before b, element by element like std::lexicographical_compare.
+  template<typename Container1, typename Container2>
+  bool lexicographical_compare(const Container1 &a, const Container2 &b) {
+    using T = detail::container_value_t<Container1>;
+    static_assert(::std::is_same<T, detail::container_value_t<Container2>>::value, "ftl::lexicographical_compare compares containers of the same element type.");
+    return detail::lexicographical_compare<T>(a.data(), a.size(), b.data(), b.size(), detail::is_simd_arithmetic<T>{});
+  }
+
+  // Returns a pointer to the first element which equals any element of set, or to the end of the container.
+  // Vectorized for byte sized elements, e.g. scanning a string for delimiters.
+  template<typename Container, typename Set>
+  auto find_first_of(const Container &c, const Set &set) -> decltype(c.data()) {
+    using T = detail::container_value_t<Container>;
+    static_assert(::std::is_same<T, detail::container_value_t<Set>>::value, "ftl::find_first_of searches for elements of the same type.");
+    return detail::find_first_of(c.data(), c.size(), set.data(), set.size(), detail::is_simd_byte<T>{});
+  }
+
+} // namespace ftl
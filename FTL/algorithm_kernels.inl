@@ -0,0 +1,164 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+// Vectorized kernels shared by every instruction set in algorithm.hpp.
+// This file is included once per instruction set, inside a namespace which defines ops<T> for that instruction set:
+//   reg, width, load, store, splat, eq (lane mask of equal lanes), min, max,
+//   sum_type, acc, acc_zero, acc_add and acc_reduce (widening sum of a register into an accumulator).
+// It must not be included anywhere else.
+
+template<typename T>
+const T* find(const T *first, const T *last, T value) noexcept {
+  using op = ops<T>;
+  const typename op::reg needle{ op::splat(value) };
+  for (; static_cast<std::size_t>(last - first) >= op::width; first += op::width) {
+    const unsigned mask{ op::eq(op::load(first), needle) };
+    if (mask) return first + count_trailing_zeros(mask);
+  }
+  for (; first != last; ++first) {
+    if (*first == value) return first;
+  }
+  return last;
+}
+
+template<typename T>
+std::size_t count(const T *first, const T *last, T value) noexcept {
+  using op = ops<T>;
+  const typename op::reg needle{ op::splat(value) };
+  std::size_t result{ 0 };
+  for (; static_cast<std::size_t>(last - first) >= op::width; first += op::width) {
+    result += population_count(op::eq(op::load(first), needle));
+  }
+  for (; first != last; ++first) {
+    result += (*first == value);
+  }
+  return result;
+}
+
+template<typename T>
+T reduce_min(typename ops<T>::reg r) noexcept {
+  T lanes[ops<T>::width];
+  ops<T>::store(lanes, r);
+  T result{ lanes[0] };
+  for (std::size_t i{ 1 }; i < ops<T>::width; ++i) {
+    if (lanes[i] < result) result = lanes[i];
+  }
+  return result;
+}
+
+template<typename T>
+T reduce_max(typename ops<T>::reg r) noexcept {
+  T lanes[ops<T>::width];
+  ops<T>::store(lanes, r);
+  T result{ lanes[0] };
+  for (std::size_t i{ 1 }; i < ops<T>::width; ++i) {
+    if (result < lanes[i]) result = lanes[i];
+  }
+  return result;
+}
+
+// [first, last) must not be empty.
+template<typename T>
+T min_value(const T *first, const T *last) noexcept {
+  using op = ops<T>;
+  const std::size_t n{ static_cast<std::size_t>(last - first) };
+  if (n < op::width) {
+    T result{ *first };
+    for (++first; first != last; ++first) {
+      if (*first < result) result = *first;
+    }
+    return result;
+  }
+  typename op::reg acc{ op::load(first) };
+  for (first += op::width; static_cast<std::size_t>(last - first) >= op::width; first += op::width) {
+    acc = op::min(acc, op::load(first));
+  }
+  // min is idempotent, so the tail is covered by one more block overlapping the elements already seen.
+  acc = op::min(acc, op::load(last - op::width));
+  return reduce_min<T>(acc);
+}
+
+// [first, last) must not be empty.
+template<typename T>
+T max_value(const T *first, const T *last) noexcept {
+  using op = ops<T>;
+  const std::size_t n{ static_cast<std::size_t>(last - first) };
+  if (n < op::width) {
+    T result{ *first };
+    for (++first; first != last; ++first) {
+      if (result < *first) result = *first;
+    }
+    return result;
+  }
+  typename op::reg acc{ op::load(first) };
+  for (first += op::width; static_cast<std::size_t>(last - first) >= op::width; first += op::width) {
+    acc = op::max(acc, op::load(first));
+  }
+  acc = op::max(acc, op::load(last - op::width));
+  return reduce_max<T>(acc);
+}
+
+template<typename T>
+typename ops<T>::sum_type sum(const T *first, const T *last) noexcept {
+  using op = ops<T>;
+  typename op::acc acc{ op::acc_zero() };
+  for (; static_cast<std::size_t>(last - first) >= op::width; first += op::width) {
+    acc = op::acc_add(acc, op::load(first));
+  }
+  typename op::sum_type result{ op::acc_reduce(acc) };
+  for (; first != last; ++first) {
+    result += *first;
+  }
+  return result;
+}
+
+// Returns the index of the first i in [0, n) for which !(a[i] == b[i]), or n if there is none.
+template<typename T>
+std::size_t mismatch(const T *a, const T *b, std::size_t n) noexcept {
+  using op = ops<T>;
+  const unsigned all_lanes{ static_cast<unsigned>((std::uint64_t{ 1 } << op::width) - 1) };
+  std::size_t i{ 0 };
+  for (; n - i >= op::width; i += op::width) {
+    const unsigned mask{ op::eq(op::load(a + i), op::load(b + i)) };
+    if (mask != all_lanes) return i + count_trailing_zeros(~mask);
+  }
+  for (; i != n; ++i) {
+    if (!(a[i] == b[i])) return i;
+  }
+  return n;
+}
+
+// Finds the first byte of [first, last) which is also in [set, set + set_size).
+inline const std::uint8_t* find_first_of(const std::uint8_t *first, const std::uint8_t *last, const std::uint8_t *set, std::size_t set_size) noexcept {
+  using op = ops<std::uint8_t>;
+  // Small sets are compared a register at a time against every candidate. Larger ones use a lookup table.
+  constexpr std::size_t max_vector_set{ 16 };
+  if (set_size == 0) return last;
+  if (set_size > max_vector_set) {
+    bool table[256] = {};
+    for (std::size_t i{ 0 }; i < set_size; ++i) {
+      table[set[i]] = true;
+    }
+    for (; first != last; ++first) {
+      if (table[*first]) return first;
+    }
+    return last;
+  }
+  typename op::reg needles[max_vector_set];
+  for (std::size_t i{ 0 }; i < set_size; ++i) {
+    needles[i] = op::splat(set[i]);
+  }
+  for (; static_cast<std::size_t>(last - first) >= op::width; first += op::width) {
+    const typename op::reg block{ op::load(first) };
+    unsigned mask{ 0 };
+    for (std::size_t i{ 0 }; i < set_size; ++i) {
+      mask |= op::eq(block, needles[i]);
+    }
+    if (mask) return first + count_trailing_zeros(mask);
+  }
+  for (; first != last; ++first) {
+    for (std::size_t i{ 0 }; i < set_size; ++i) {
+      if (*first == set[i]) return first;
+    }
+  }
+  return last;
+}
@@ -3,17 +3,183 @@
 #pragma once
 
 #include <limits> // numeric_limits
-#include <type_traits> // std::false_type
-#include <cstddef> // ptrdiff_t
+#include <type_traits> // std::false_type, is_empty
+#include <cstddef> // ptrdiff_t, max_align_t
+#include <cstdlib> // posix_memalign, free
 #include <utility> // forward
-#include <cstring> // memset, size_t
+#include <cstring> // memcpy, size_t
 #include <cassert> // assert
+#include <cstdint> // uintptr_t
+#include <new> // bad_alloc
+
+#ifdef _WIN32
+#include <malloc.h> // _aligned_malloc, _aligned_free
+#endif
+
 namespace ftl {
 
+  // The result of allocate_at_least: the block and the number of elements it can actually hold.
+  template<typename Pointer, typename SizeType = std::size_t>
+  struct allocation_result {
+    Pointer ptr;
+    SizeType count;
+  };
+
+  namespace detail {
+    template<typename Alloc>
+    struct has_allocate_at_least {
+    private:
+      template<typename> struct check : std::true_type {};
+      template<typename A> static auto test(int)->check<decltype(std::declval<A&>().allocate_at_least(std::declval<typename A::size_type>()))>;
+      template<class> static auto test(long)->std::false_type;
+    public:
+      static constexpr bool value{ decltype(test<Alloc>(0))::value };
+    };
+
+    template<typename Alloc>
+    allocation_result<typename Alloc::pointer, typename Alloc::size_type> allocate_at_least(Alloc &alloc, typename Alloc::size_type n, std::true_type) {
+      auto result = alloc.allocate_at_least(n);
+      assert(result.count >= n);
+      return { result.ptr, result.count };
+    }
+    template<typename Alloc>
+    allocation_result<typename Alloc::pointer, typename Alloc::size_type> allocate_at_least(Alloc &alloc, typename Alloc::size_type n, std::false_type) {
+      return { alloc.allocate(n), n };
+    }
+  } // namespace detail
+
+  // Allocates room for at least n elements. Allocators which round requests up (to size classes, pages, ...)
+  // may report the real size by providing allocate_at_least(n), returning anything with ptr and count members.
+  // The block must later be deallocated with the returned count.
+  template<typename Alloc>
+  allocation_result<typename Alloc::pointer, typename Alloc::size_type> allocate_at_least(Alloc &alloc, typename Alloc::size_type n) {
+    return detail::allocate_at_least(alloc, n, std::integral_constant<bool, detail::has_allocate_at_least<Alloc>::value>{});
+  }
+
+  namespace detail {
+    template<typename Alloc>
+    struct has_reallocate {
+    private:
+      template<typename> struct check : std::true_type {};
+      template<typename A> static auto test(int)->check<decltype(std::declval<A&>().reallocate(std::declval<typename A::pointer>(),
+        std::declval<typename A::size_type>(), std::declval<typename A::size_type>()))>;
+      template<class> static auto test(long)->std::false_type;
+    public:
+      static constexpr bool value{ decltype(test<Alloc>(0))::value };
+    };
+  } // namespace detail
+
+  // Resizes the block p of old_count elements to hold at least n, carrying its bytes over, like realloc.
+  // Allocators which can grow a block without copying it (in place, or by remapping its pages) opt in by providing
+  // reallocate(p, old_count, n), returning anything with ptr and count members. It must leave the old block intact
+  // when it throws. Only trivially relocatable elements may be carried over this way, since the bytes move as they are.
+  template<typename Alloc>
+  allocation_result<typename Alloc::pointer, typename Alloc::size_type> reallocate(Alloc &alloc, typename Alloc::pointer p,
+    typename Alloc::size_type old_count, typename Alloc::size_type n) {
+    static_assert(detail::has_reallocate<Alloc>::value, "The allocator does not provide reallocate.");
+    auto result = alloc.reallocate(p, old_count, n);
+    assert(result.count >= n);
+    return { result.ptr, result.count };
+  }
+
+  namespace detail {
+    template<typename...>
+    struct make_void { using type = void; };
+    template<typename... Ts>
+    using void_t = typename make_void<Ts...>::type;
+
+    template<typename Alloc, typename = void>
+    struct propagate_on_copy_assignment : std::false_type {};
+    template<typename Alloc>
+    struct propagate_on_copy_assignment<Alloc, void_t<typename Alloc::propagate_on_container_copy_assignment>>
+      : std::integral_constant<bool, Alloc::propagate_on_container_copy_assignment::value> {};
+    template<typename Alloc, typename = void>
+    struct propagate_on_move_assignment : std::false_type {};
+    template<typename Alloc>
+    struct propagate_on_move_assignment<Alloc, void_t<typename Alloc::propagate_on_container_move_assignment>>
+      : std::integral_constant<bool, Alloc::propagate_on_container_move_assignment::value> {};
+    template<typename Alloc, typename = void>
+    struct propagate_on_swap : std::false_type {};
+    template<typename Alloc>
+    struct propagate_on_swap<Alloc, void_t<typename Alloc::propagate_on_container_swap>>
+      : std::integral_constant<bool, Alloc::propagate_on_container_swap::value> {};
+    // Stateless allocators are always equal unless they say otherwise.
+    template<typename Alloc, typename = void>
+    struct is_always_equal : std::is_empty<Alloc> {};
+    template<typename Alloc>
+    struct is_always_equal<Alloc, void_t<typename Alloc::is_always_equal>>
+      : std::integral_constant<bool, Alloc::is_always_equal::value> {};
+
+    template<typename Alloc>
+    bool allocators_equal(const Alloc &, const Alloc &, std::true_type) noexcept { return true; }
+    template<typename Alloc>
+    bool allocators_equal(const Alloc &lhs, const Alloc &rhs, std::false_type) noexcept { return lhs == rhs; }
+
+    template<typename Alloc, typename = void>
+    struct has_select_on_copy : std::false_type {};
+    template<typename Alloc>
+    struct has_select_on_copy<Alloc, void_t<decltype(std::declval<const Alloc&>().select_on_container_copy_construction())>> : std::true_type {};
+
+    template<typename Alloc>
+    Alloc select_on_copy(const Alloc &alloc, std::true_type) { return alloc.select_on_container_copy_construction(); }
+    template<typename Alloc>
+    Alloc select_on_copy(const Alloc &alloc, std::false_type) { return alloc; }
+  } // namespace detail
+
+  // Container allocator awareness, as with std::allocator_traits. Allocators may declare
+  // propagate_on_container_copy_assignment, propagate_on_container_move_assignment and propagate_on_container_swap
+  // (each false unless declared), and is_always_equal (true for empty allocators unless declared).
+  // Stateful allocators compare equal when one can free what the other allocated.
+  template<typename Alloc>
+  bool allocators_equal(const Alloc &lhs, const Alloc &rhs) noexcept {
+    return detail::allocators_equal(lhs, rhs, std::integral_constant<bool, detail::is_always_equal<Alloc>::value>{});
+  }
+
+  // The allocator a copy of a container using alloc gets: alloc.select_on_container_copy_construction() if it has one,
+  // and a copy of alloc otherwise.
+  template<typename Alloc>
+  Alloc select_on_container_copy_construction(const Alloc &alloc) {
+    return detail::select_on_copy(alloc, std::integral_constant<bool, detail::has_select_on_copy<Alloc>::value>{});
+  }
+
+  namespace detail {
+    // new only aligns to max_align_t before C++17, so over-aligned blocks come from the platform's aligned malloc.
+    inline void* aligned_allocate(std::size_t bytes, std::size_t alignment) {
+      if (alignment < sizeof(void*)) alignment = sizeof(void*);
+      if (bytes == 0) bytes = 1;
+      void *memory{ nullptr };
+#ifdef _WIN32
+      memory = ::_aligned_malloc(bytes, alignment);
+#else
+      if (::posix_memalign(&memory, alignment, bytes) != 0) memory = nullptr;
+#endif
+      if (!memory) throw std::bad_alloc{};
+      return memory;
+    }
+    inline void aligned_deallocate(void *p) noexcept {
+#ifdef _WIN32
+      ::_aligned_free(p);
+#else
+      std::free(p);
+#endif
+    }
+
+    template<typename T>
+    struct is_over_aligned : std::integral_constant<bool, (alignof(T) > alignof(std::max_align_t))> {};
+
+    // The alignment of the blocks Alloc hands out: its alignment member if it declares one, and that of its
+    // value_type otherwise.
+    template<typename Alloc, typename = void>
+    struct allocation_alignment : std::integral_constant<std::size_t, alignof(typename Alloc::value_type)> {};
+    template<typename Alloc>
+    struct allocation_alignment<Alloc, void_t<decltype(Alloc::alignment)>>
+      : std::integral_constant<std::size_t, (Alloc::alignment > alignof(typename Alloc::value_type) ? Alloc::alignment : alignof(typename Alloc::value_type))> {};
+  } // namespace detail
+
   // Allocator interface:
   // This is the default allocator. It fulfills the minimum interface requirements of an allocator.
   // If you wish to write a custom allocator, it must have at least these type aliases and member functions.
-  // It does not need to derive from this class.
+  // It does not need to derive from this class. It may optionally provide allocate_at_least and reallocate (see above).
   template<typename T>
   class default_allocator {
   public:
@@ -31,7 +197,7 @@ namespace ftl {
     default_allocator() noexcept {}
     default_allocator(const default_allocator<T> &alloc) noexcept { *this = alloc; }
     template<class U>
-    default_allocator(const default_allocator<U> &alloc) noexcept;
+    default_allocator(const default_allocator<U> &) noexcept {}
     ~default_allocator() {}
 
     pointer address(reference x) const noexcept { return &x; }
@@ -40,11 +206,11 @@ namespace ftl {
       // the default allocator uses the system new and delete implementations.
       // Therefore it can't do anything with the hint pointer.
       (void)hint; // unused
-      return reinterpret_cast<pointer>(::new char[n * sizeof(value_type)]);
+      return allocate(n, detail::is_over_aligned<value_type>{});
     }
     void deallocate(pointer p, size_type n) {
       (void)n; // unused
-      ::delete[] (char*)p;
+      deallocate(p, detail::is_over_aligned<value_type>{});
     }
     size_type max_size() const noexcept { return ::std::numeric_limits<unsigned>::max(); }
     template<typename U, typename... Args>
@@ -55,11 +221,94 @@ namespace ftl {
     void destroy(U* p) {
       p->~U();
     }
+  private:
+    // Types aligned beyond what new guarantees get their alignment from the aligned allocation functions.
+    pointer allocate(size_type n, std::false_type) {
+      return reinterpret_cast<pointer>(::new char[n * sizeof(value_type)]);
+    }
+    pointer allocate(size_type n, std::true_type) {
+      if (n > std::numeric_limits<size_type>::max() / sizeof(value_type)) throw std::bad_alloc{};
+      return static_cast<pointer>(detail::aligned_allocate(n * sizeof(value_type), alignof(value_type)));
+    }
+    void deallocate(pointer p, std::false_type) noexcept {
+      ::delete[] (char*)p;
+    }
+    void deallocate(pointer p, std::true_type) noexcept {
+      detail::aligned_deallocate(p);
+    }
   };
 
+  template<typename T, typename U>
+  bool operator==(const default_allocator<T> &, const default_allocator<U> &) noexcept { return true; }
+  template<typename T, typename U>
+  bool operator!=(const default_allocator<T> &, const default_allocator<U> &) noexcept { return false; }
+
+  // aligned_allocator hands out blocks aligned to Align bytes, 64 by default: a cache line, and the width of an
+  // AVX-512 register. A vector using it has an aligned data(), so SIMD loops can use aligned loads without a scalar
+  // prologue, and arrays of per-thread slots don't share their first line with anything else.
+  // Types aligned beyond Align keep their own alignment. allocate_at_least rounds blocks up to a multiple of the
+  // alignment, so the last SIMD block of a full vector is whole.
+  template<typename T, std::size_t Align = 64>
+  class aligned_allocator {
+    static_assert(Align && (Align & (Align - 1)) == 0, "The alignment must be a power of two.");
+  public:
+    using value_type = T;
+    using pointer = T*;
+    using reference = T&;
+    using const_pointer = const T *;
+    using const_reference = const T&;
+    using size_type = std::size_t;
+    using difference_type = ::std::ptrdiff_t;
+    template<typename Type>
+    using rebind = aligned_allocator<Type, Align>;
+    using propagate_on_container_move_assignment = ::std::false_type;
+    static constexpr size_type alignment{ Align > alignof(T) ? Align : alignof(T) };
+
+    aligned_allocator() noexcept = default;
+    template<typename U, std::size_t UAlign>
+    aligned_allocator(const aligned_allocator<U, UAlign> &) noexcept {}
+
+    pointer allocate(size_type n) {
+      if (n > max_size()) throw ::std::bad_alloc{};
+      return static_cast<pointer>(detail::aligned_allocate(n * sizeof(value_type), alignment));
+    }
+    allocation_result<pointer, size_type> allocate_at_least(size_type n) {
+      if (n > max_size()) throw ::std::bad_alloc{};
+      const size_type bytes{ (n * sizeof(value_type) + alignment - 1) / alignment * alignment };
+      return { static_cast<pointer>(detail::aligned_allocate(bytes, alignment)), bytes / sizeof(value_type) };
+    }
+    void deallocate(pointer p, size_type) noexcept {
+      detail::aligned_deallocate(p);
+    }
+    size_type max_size() const noexcept { return (::std::numeric_limits<size_type>::max() - alignment) / sizeof(value_type); }
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+      ::new ((void*)p) U(::std::forward<Args>(args)...);
+    }
+    template<class U>
+    void destroy(U* p) {
+      p->~U();
+    }
+  };
+
+  template<typename T, std::size_t Align>
+  constexpr typename aligned_allocator<T, Align>::size_type aligned_allocator<T, Align>::alignment;
+
+  template<typename T, std::size_t TAlign, typename U, std::size_t UAlign>
+  bool operator==(const aligned_allocator<T, TAlign> &, const aligned_allocator<U, UAlign> &) noexcept { return true; }
+  template<typename T, std::size_t TAlign, typename U, std::size_t UAlign>
+  bool operator!=(const aligned_allocator<T, TAlign> &, const aligned_allocator<U, UAlign> &) noexcept { return false; }
+
   // This allocator takes the element count as a template parameter
-  // It then reserves that much stack space to dish out allocations from
-  template<typename T, std::size_t N>
+  // It then reserves that much stack space to dish out allocations from.
+  // Allocations are bumped off the top of the buffer. Deallocating the topmost block reclaims it, but deallocating
+  // any other block does nothing: its space stays taken, even once the blocks above it are freed, until a rewind.
+  // marker() and rewind(marker), or a scope, free everything allocated since the marker at once, for repeated
+  // scratch allocations.
+  // reallocate grows the topmost block in place, so a vector on top of the stack can reserve without copying.
+  // When the buffer runs out, allocate throws std::bad_alloc, or with HeapFallback falls back to new.
+  // The buffer belongs to the allocator object, so copies start out empty and only compare equal to themselves.
+  template<typename T, std::size_t N, bool HeapFallback = false>
   class linear_stack_allocator {
   public:
     using value_type = T;
@@ -70,11 +319,28 @@ namespace ftl {
     using size_type = std::size_t;
     using difference_type = ::std::ptrdiff_t;
     template<typename Type>
-    using rebind = linear_stack_allocator<Type, N>;
+    using rebind = linear_stack_allocator<Type, N, HeapFallback>;
     using propagate_on_container_move_assignment = ::std::false_type;
+    // The number of elements allocated from the buffer at the time.
+    using marker_type = size_type;
+
+    // Rewinds the allocator to where it was when the scope was created.
+    class scope {
+    public:
+      explicit scope(linear_stack_allocator &alloc) noexcept : m_alloc(alloc), m_marker{ alloc.marker() } {}
+      scope(const scope &) = delete;
+      scope& operator=(const scope &) = delete;
+      ~scope() { m_alloc.rewind(m_marker); }
+    private:
+      linear_stack_allocator &m_alloc;
+      marker_type m_marker;
+    };
 
     linear_stack_allocator() noexcept = default;
-    linear_stack_allocator(const linear_stack_allocator<T, N> &alloc) noexcept {}
+    linear_stack_allocator(const linear_stack_allocator &) noexcept {}
+    template<typename U>
+    linear_stack_allocator(const linear_stack_allocator<U, N, HeapFallback> &) noexcept {}
+    linear_stack_allocator& operator=(const linear_stack_allocator &) noexcept { return *this; }
     ~linear_stack_allocator() = default;
 
     pointer address(reference x) const noexcept {
@@ -85,21 +351,45 @@ namespace ftl {
     }
     pointer allocate(size_type n, const void * hint = 0) {
       // Since this is a linear allocator, the hint is ignored.
-      assert(max_size() >= m_index + n);
-      size_t alloc_index{ m_index };
+      (void)hint;
+      if (n > N - m_index) return allocate_overflow(n, ::std::integral_constant<bool, HeapFallback>{});
+      pointer result{ storage() + m_index };
       m_index += n;
-      return reinterpret_cast<pointer>(m_storage) + alloc_index;
+      return result;
     }
-    void deallocate(pointer p, size_type n) {
-      if (p != reinterpret_cast<pointer>(m_storage) - n) {
-        return;
+    void deallocate(pointer p, size_type n) noexcept {
+      if (!owns(p)) {
+        heap_deallocate(p, detail::is_over_aligned<value_type>{});
       }
-      else {
+      else if (p + n == storage() + m_index) {
         m_index -= n;
-        ::std::memset(m_storage + m_index, 0, n * sizeof(value_type));
       }
     }
-    size_type max_size() const noexcept { return N; }
+    // Grows or shrinks the topmost block in place when the buffer has room, and moves the block otherwise.
+    allocation_result<pointer, size_type> reallocate(pointer p, size_type old_count, size_type n) {
+      if (owns(p) && p + old_count == storage() + m_index) {
+        const size_type start{ static_cast<size_type>(p - storage()) };
+        if (n <= N - start) {
+          m_index = start + n;
+          return { p, n };
+        }
+      }
+      pointer result{ allocate(n) };
+      ::std::memcpy(static_cast<void*>(result), static_cast<const void*>(p), (old_count < n ? old_count : n) * sizeof(value_type));
+      deallocate(p, old_count);
+      return { result, n };
+    }
+
+    marker_type marker() const noexcept { return m_index; }
+    // Frees everything allocated from the buffer since marker was taken.
+    void rewind(marker_type marker) noexcept {
+      assert(marker <= m_index);
+      m_index = marker;
+    }
+    // The number of elements the buffer has left.
+    size_type available() const noexcept { return N - m_index; }
+
+    size_type max_size() const noexcept { return HeapFallback ? ::std::numeric_limits<size_type>::max() / sizeof(value_type) : N; }
     template<typename U, typename... Args>
     void construct(U* p, Args&&... args) {
       ::new ((void*)p) U(::std::forward<Args>(args)...);
@@ -109,8 +399,47 @@ namespace ftl {
       p->~U();
     }
   private:
-    char m_storage[N * sizeof(value_type)]{ 0 };
-    size_t m_index{ 0 };
+    pointer storage() noexcept { return reinterpret_cast<pointer>(m_storage); }
+    const_pointer storage() const noexcept { return reinterpret_cast<const_pointer>(m_storage); }
+    bool owns(const_pointer p) const noexcept {
+      // Compared as integers, since pointers into different objects can't be ordered.
+      // The end of the buffer counts, as empty allocations may be placed there.
+      const ::std::uintptr_t address{ reinterpret_cast<::std::uintptr_t>(p) };
+      const ::std::uintptr_t first{ reinterpret_cast<::std::uintptr_t>(m_storage) };
+      return address >= first && address <= first + sizeof(m_storage);
+    }
+    pointer allocate_overflow(size_type n, ::std::true_type) {
+      if (n > max_size()) throw ::std::bad_alloc{};
+      return heap_allocate(n, detail::is_over_aligned<value_type>{});
+    }
+    pointer allocate_overflow(size_type, ::std::false_type) {
+      throw ::std::bad_alloc{};
+    }
+    // Heap blocks for over-aligned types come from the aligned allocation functions, as in default_allocator.
+    pointer heap_allocate(size_type n, ::std::false_type) {
+      return reinterpret_cast<pointer>(::new char[n * sizeof(value_type)]);
+    }
+    pointer heap_allocate(size_type n, ::std::true_type) {
+      return static_cast<pointer>(detail::aligned_allocate(n * sizeof(value_type), alignof(value_type)));
+    }
+    void heap_deallocate(pointer p, ::std::false_type) noexcept {
+      ::delete[] reinterpret_cast<char*>(p);
+    }
+    void heap_deallocate(pointer p, ::std::true_type) noexcept {
+      detail::aligned_deallocate(p);
+    }
+
+    alignas(value_type) char m_storage[N * sizeof(value_type)];
+    size_type m_index{ 0 };
   };
 
+  template<typename T, typename U, std::size_t N, bool HeapFallback>
+  bool operator==(const linear_stack_allocator<T, N, HeapFallback> &lhs, const linear_stack_allocator<U, N, HeapFallback> &rhs) noexcept {
+    return static_cast<const void*>(&lhs) == static_cast<const void*>(&rhs);
+  }
+  template<typename T, typename U, std::size_t N, bool HeapFallback>
+  bool operator!=(const linear_stack_allocator<T, N, HeapFallback> &lhs, const linear_stack_allocator<U, N, HeapFallback> &rhs) noexcept {
+    return !(lhs == rhs);
+  }
+
 } // namespace ftl
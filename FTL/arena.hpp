@@ -0,0 +1,253 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "allocator.hpp" // allocation_result
+
+#include <cassert> // assert
+#include <cstddef> // size_t, ptrdiff_t, max_align_t
+#include <cstdint> // uintptr_t
+#include <cstring> // memcpy
+#include <limits> // numeric_limits
+#include <new> // bad_alloc
+#include <type_traits> // false_type
+#include <utility> // forward
+
+namespace ftl {
+
+  // What an arena holds, for tuning its chunk sizes.
+  struct arena_stats {
+    // Chunks the arena owns, including those kept for reuse across reset.
+    ::std::size_t chunks;
+    // The total size of those chunks.
+    ::std::size_t reserved_bytes;
+    // Bytes handed out since the last reset, less those given back by LIFO deallocation.
+    ::std::size_t used_bytes;
+    // The most used_bytes has been since the arena was created.
+    ::std::size_t peak_used_bytes;
+    ::std::size_t resets;
+  };
+
+  // arena bump-allocates from heap chunks which grow geometrically, from initial_chunk_bytes up to max_chunk_bytes
+  // (larger requests get a chunk of their own). Memory is released all at once: reset makes every chunk free again in
+  // O(1), keeping them for the next round, and release or the destructor frees them.
+  // deallocate only reclaims the most recent allocation, so a vector growing at the top of the arena doesn't waste
+  // its old buffers; anything else is a no-op until reset. reallocate grows the most recent allocation in place.
+  // Nothing is destroyed on reset: the arena is meant for objects whose destructors are trivial or have already run.
+  // An arena is not thread safe, and is neither copyable nor movable since allocators refer to it.
+  class arena {
+  public:
+    static constexpr ::std::size_t default_initial_chunk_bytes{ 4096 };
+    static constexpr ::std::size_t default_max_chunk_bytes{ ::std::size_t{ 64 } << 20 };
+
+    explicit arena(::std::size_t initial_chunk_bytes = default_initial_chunk_bytes, ::std::size_t max_chunk_bytes = default_max_chunk_bytes) noexcept;
+    arena(const arena &) = delete;
+    arena& operator=(const arena &) = delete;
+    ~arena();
+
+    void* allocate(::std::size_t bytes, ::std::size_t alignment = alignof(::std::max_align_t));
+    void deallocate(void *p, ::std::size_t bytes) noexcept;
+    // Resizes the block p of old_bytes, in place when it is the most recent allocation and the chunk has room.
+    // Otherwise the bytes are copied to a new block.
+    void* reallocate(void *p, ::std::size_t old_bytes, ::std::size_t new_bytes, ::std::size_t alignment = alignof(::std::max_align_t));
+    // Frees every allocation at once, keeping the chunks for reuse.
+    void reset() noexcept;
+    // Frees every allocation and gives the chunks back to the heap.
+    void release() noexcept;
+
+    arena_stats stats() const noexcept;
+
+  private:
+    struct chunk {
+      chunk *next;
+      ::std::size_t size;
+      char* begin() noexcept { return reinterpret_cast<char*>(this) + header_bytes; }
+      char* end() noexcept { return reinterpret_cast<char*>(this) + size; }
+    };
+    // The header is padded so chunk memory starts with the alignment of new.
+    static constexpr ::std::size_t header_bytes{ (sizeof(chunk) + alignof(::std::max_align_t) - 1) / alignof(::std::max_align_t) * alignof(::std::max_align_t) };
+
+    static char* align_up(char *p, ::std::size_t alignment) noexcept {
+      const ::std::uintptr_t address{ reinterpret_cast<::std::uintptr_t>(p) };
+      return p + ((alignment - address % alignment) % alignment);
+    }
+    // Makes the next chunk with room for bytes current, reusing a retained one if it is large enough.
+    void next_chunk(::std::size_t bytes);
+    void use(chunk *c) noexcept;
+
+    chunk *m_head{ nullptr };
+    chunk *m_current{ nullptr };
+    char *m_cursor{ nullptr };
+    char *m_limit{ nullptr };
+    ::std::size_t m_next_chunk_bytes;
+    ::std::size_t m_initial_chunk_bytes;
+    ::std::size_t m_max_chunk_bytes;
+    ::std::size_t m_chunks{ 0 };
+    ::std::size_t m_reserved_bytes{ 0 };
+    ::std::size_t m_used_bytes{ 0 };
+    ::std::size_t m_peak_used_bytes{ 0 };
+    ::std::size_t m_resets{ 0 };
+  };
+
+  inline arena::arena(::std::size_t initial_chunk_bytes, ::std::size_t max_chunk_bytes) noexcept
+    : m_next_chunk_bytes{ initial_chunk_bytes }
+    , m_initial_chunk_bytes{ initial_chunk_bytes }
+    , m_max_chunk_bytes{ max_chunk_bytes < initial_chunk_bytes ? initial_chunk_bytes : max_chunk_bytes } {
+  }
+
+  inline arena::~arena() {
+    release();
+  }
+
+  inline void* arena::allocate(::std::size_t bytes, ::std::size_t alignment) {
+    assert(alignment && (alignment & (alignment - 1)) == 0);
+    char *p{ align_up(m_cursor, alignment) };
+    if (!m_current || p > m_limit || static_cast<::std::size_t>(m_limit - p) < bytes) {
+      if (bytes > ::std::numeric_limits<::std::size_t>::max() - alignment - header_bytes) throw ::std::bad_alloc{};
+      next_chunk(bytes + alignment - 1);
+      p = align_up(m_cursor, alignment);
+    }
+    m_cursor = p + bytes;
+    m_used_bytes += bytes;
+    if (m_used_bytes > m_peak_used_bytes) m_peak_used_bytes = m_used_bytes;
+    return p;
+  }
+
+  inline void arena::deallocate(void *p, ::std::size_t bytes) noexcept {
+    // Blocks in other chunks can't end at the cursor, so this only ever rewinds the current chunk.
+    if (p && static_cast<char*>(p) + bytes == m_cursor) {
+      m_cursor = static_cast<char*>(p);
+      m_used_bytes -= bytes;
+    }
+  }
+
+  inline void* arena::reallocate(void *p, ::std::size_t old_bytes, ::std::size_t new_bytes, ::std::size_t alignment) {
+    char *block{ static_cast<char*>(p) };
+    if (block && block + old_bytes == m_cursor && static_cast<::std::size_t>(m_limit - block) >= new_bytes) {
+      m_cursor = block + new_bytes;
+      m_used_bytes = m_used_bytes - old_bytes + new_bytes;
+      if (m_used_bytes > m_peak_used_bytes) m_peak_used_bytes = m_used_bytes;
+      return block;
+    }
+    void *result{ allocate(new_bytes, alignment) };
+    if (block) {
+      ::std::memcpy(result, block, old_bytes < new_bytes ? old_bytes : new_bytes);
+    }
+    deallocate(block, old_bytes);
+    return result;
+  }
+
+  inline void arena::use(chunk *c) noexcept {
+    m_current = c;
+    m_cursor = c->begin();
+    m_limit = c->end();
+  }
+
+  inline void arena::next_chunk(::std::size_t bytes) {
+    // The chunks after the current one are free. The first one large enough is moved up to follow it, so the ones
+    // it skipped stay free for later requests.
+    chunk **link{ m_current ? &m_current->next : &m_head };
+    chunk **candidate{ link };
+    while (*candidate && static_cast<::std::size_t>((*candidate)->end() - (*candidate)->begin()) < bytes) {
+      candidate = &(*candidate)->next;
+    }
+    chunk *c{ *candidate };
+    if (c) {
+      *candidate = c->next;
+    }
+    else {
+      ::std::size_t size{ m_next_chunk_bytes };
+      if (size < bytes + header_bytes) size = bytes + header_bytes;
+      c = reinterpret_cast<chunk*>(::new char[size]);
+      c->size = size;
+      ++m_chunks;
+      m_reserved_bytes += size;
+      m_next_chunk_bytes = m_next_chunk_bytes * 2 > m_max_chunk_bytes ? m_max_chunk_bytes : m_next_chunk_bytes * 2;
+    }
+    c->next = *link;
+    *link = c;
+    use(c);
+  }
+
+  inline void arena::reset() noexcept {
+    if (m_head) {
+      use(m_head);
+    }
+    m_used_bytes = 0;
+    ++m_resets;
+  }
+
+  inline void arena::release() noexcept {
+    while (m_head) {
+      chunk *next{ m_head->next };
+      ::delete[] reinterpret_cast<char*>(m_head);
+      m_head = next;
+    }
+    m_current = nullptr;
+    m_cursor = m_limit = nullptr;
+    m_next_chunk_bytes = m_initial_chunk_bytes;
+    m_chunks = 0;
+    m_reserved_bytes = 0;
+    m_used_bytes = 0;
+  }
+
+  inline arena_stats arena::stats() const noexcept {
+    return { m_chunks, m_reserved_bytes, m_used_bytes, m_peak_used_bytes, m_resets };
+  }
+
+  // arena_allocator is a handle to an arena, so any number of containers can allocate from the same one and all be
+  // freed by its reset. It has no default constructor; containers using it must be given one, e.g.
+  //   ftl::arena request_arena;
+  //   ftl::vector<int, ftl::arena_allocator<int>> ids{ ftl::arena_allocator<int>{ request_arena } };
+  // Handles compare equal when they share an arena.
+  template<typename T>
+  class arena_allocator {
+  public:
+    using value_type = T;
+    using pointer = T*;
+    using reference = T&;
+    using const_pointer = const T *;
+    using const_reference = const T&;
+    using size_type = ::std::size_t;
+    using difference_type = ::std::ptrdiff_t;
+    template<typename Type>
+    using rebind = arena_allocator<Type>;
+    using propagate_on_container_move_assignment = ::std::false_type;
+
+    arena_allocator(arena &source) noexcept : m_arena{ &source } {}
+    template<class U>
+    arena_allocator(const arena_allocator<U> &other) noexcept : m_arena{ &other.resource() } {}
+
+    arena& resource() const noexcept { return *m_arena; }
+
+    pointer allocate(size_type n) {
+      if (n > max_size()) throw ::std::bad_alloc{};
+      return static_cast<pointer>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(pointer p, size_type n) noexcept {
+      m_arena->deallocate(p, n * sizeof(T));
+    }
+    allocation_result<pointer, size_type> reallocate(pointer p, size_type old_count, size_type n) {
+      if (n > max_size()) throw ::std::bad_alloc{};
+      return { static_cast<pointer>(m_arena->reallocate(p, old_count * sizeof(T), n * sizeof(T), alignof(T))), n };
+    }
+    size_type max_size() const noexcept { return ::std::numeric_limits<size_type>::max() / sizeof(T) / 2; }
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+      ::new ((void*)p) U(::std::forward<Args>(args)...);
+    }
+    template<class U>
+    void destroy(U* p) {
+      p->~U();
+    }
+
+  private:
+    arena *m_arena;
+  };
+
+  template<typename T, typename U>
+  bool operator==(const arena_allocator<T> &lhs, const arena_allocator<U> &rhs) noexcept { return &lhs.resource() == &rhs.resource(); }
+  template<typename T, typename U>
+  bool operator!=(const arena_allocator<T> &lhs, const arena_allocator<U> &rhs) noexcept { return !(lhs == rhs); }
+
+} // namespace ftl
@@ -0,0 +1,111 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// Compares the vectorized algorithms in algorithm.hpp against their std:: counterparts.
+// Every algorithm runs over the same data with std::, then with ftl:: capped at each instruction set level.
+// Searches look for a value that is absent, so every element is visited. Results are in nanoseconds per element.
+#include "../algorithm.hpp"
+#include "../vector.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+
+namespace {
+  volatile std::uint64_t g_sink;
+
+  template<typename Function>
+  double ns_per_element(std::size_t elements, std::size_t repetitions, Function function) {
+    std::uint64_t sink{ 0 };
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t r{ 0 }; r < repetitions; ++r) {
+      sink += static_cast<std::uint64_t>(function());
+    }
+    auto stop = std::chrono::steady_clock::now();
+    g_sink = sink;
+    return std::chrono::duration<double, std::nano>(stop - start).count() / static_cast<double>(elements * repetitions);
+  }
+
+  template<typename StdFunction, typename FtlFunction>
+  void report(const char *name, std::size_t elements, std::size_t repetitions, StdFunction std_function, FtlFunction ftl_function) {
+    const double std_ns{ ns_per_element(elements, repetitions, std_function) };
+    double ftl_ns[3];
+    const ftl::simd_level levels[3] = { ftl::simd_level::scalar, ftl::simd_level::sse2, ftl::simd_level::avx2 };
+    for (int i{ 0 }; i < 3; ++i) {
+      if (ftl::limit_simd_level(levels[i]) == levels[i]) {
+        ftl_ns[i] = ns_per_element(elements, repetitions, ftl_function);
+      }
+      else {
+        ftl_ns[i] = -1.0;
+      }
+    }
+    std::printf("%-32s %10zu %10.3f %10.3f %10.3f %10.3f\n", name, elements, std_ns, ftl_ns[0], ftl_ns[1], ftl_ns[2]);
+  }
+
+  template<typename T>
+  void report_type(const char *type, std::size_t elements, std::size_t repetitions) {
+    ftl::vector<T> data;
+    ftl::vector<T> other;
+    for (std::size_t i{ 0 }; i < elements; ++i) {
+      data.push_back(static_cast<T>(i % 100 + 1));
+    }
+    other = data;
+    const T absent{ 0 };
+    std::string name;
+
+    name = std::string{ "find<" } + type + ">";
+    report(name.c_str(), elements, repetitions,
+      [&] { return std::find(data.begin(), data.end(), absent) - data.begin(); },
+      [&] { return ftl::find(data, absent) - data.begin(); });
+    name = std::string{ "count<" } + type + ">";
+    report(name.c_str(), elements, repetitions,
+      [&] { return std::count(data.begin(), data.end(), T{ 7 }); },
+      [&] { return ftl::count(data, T{ 7 }); });
+    name = std::string{ "min_element<" } + type + ">";
+    report(name.c_str(), elements, repetitions,
+      [&] { return std::min_element(data.begin(), data.end()) - data.begin(); },
+      [&] { return ftl::min_element(data) - data.begin(); });
+    name = std::string{ "max_element<" } + type + ">";
+    report(name.c_str(), elements, repetitions,
+      [&] { return std::max_element(data.begin(), data.end()) - data.begin(); },
+      [&] { return ftl::max_element(data) - data.begin(); });
+    name = std::string{ "sum<" } + type + ">";
+    report(name.c_str(), elements, repetitions,
+      [&] { return std::accumulate(data.begin(), data.end(), typename ftl::accumulator_type<T>::type{ 0 }); },
+      [&] { return ftl::sum(data); });
+    name = std::string{ "equal<" } + type + ">";
+    report(name.c_str(), elements, repetitions,
+      [&] { return std::equal(data.begin(), data.end(), other.begin()); },
+      [&] { return ftl::equal(data, other); });
+    name = std::string{ "lexicographical_compare<" } + type + ">";
+    report(name.c_str(), elements, repetitions,
+      [&] { return std::lexicographical_compare(data.begin(), data.end(), other.begin(), other.end()); },
+      [&] { return ftl::lexicographical_compare(data, other); });
+  }
+
+  void report_find_first_of(std::size_t elements, std::size_t repetitions) {
+    std::string text(elements, 'a');
+    const std::string delimiters{ ",;:\n" };
+    const std::string letters{ "ABCDEFGHIJKLMNOPQRSTUVWXYZ" };
+    report("find_first_of<char, 4>", elements, repetitions,
+      [&] { return std::find_first_of(text.begin(), text.end(), delimiters.begin(), delimiters.end()) - text.begin(); },
+      [&] { return ftl::find_first_of(text, delimiters) - text.data(); });
+    report("find_first_of<char, 26>", elements, repetitions,
+      [&] { return std::find_first_of(text.begin(), text.end(), letters.begin(), letters.end()) - text.begin(); },
+      [&] { return ftl::find_first_of(text, letters) - text.data(); });
+  }
+
+  void report_all(std::size_t elements, std::size_t repetitions) {
+    report_type<std::int32_t>("int32_t", elements, repetitions);
+    report_type<float>("float", elements, repetitions);
+    report_type<std::uint8_t>("uint8_t", elements, repetitions);
+    report_find_first_of(elements, repetitions);
+  }
+} // namespace
+
+int main() {
+  std::printf("%-32s %10s %10s %10s %10s %10s\n", "algorithm", "elements", "std_ns", "scalar_ns", "sse2_ns", "avx2_ns");
+  // Cache resident, then streaming from memory.
+  report_all(4096, 20000);
+  report_all(1u << 24, 10);
+  return 0;
+}
@@ -0,0 +1,101 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// Measures how appends from many producer threads scale, from 1 thread up to the number of hardware threads.
+// Every producer appends the same number of results into one shared container, either one at a time or in batches.
+// ftl::concurrent_vector is compared against an ftl::vector guarded by a std::mutex.
+#include "../concurrent_vector.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+  struct result {
+    std::uint64_t id;
+    double value;
+  };
+
+  using clock = std::chrono::steady_clock;
+
+  struct locked_vector {
+    ftl::vector<result> results;
+    std::mutex mutex;
+
+    void push_back(const result &r) {
+      std::lock_guard<std::mutex> lock{ mutex };
+      results.push_back(r);
+    }
+    void append(const result *first, std::size_t n) {
+      std::lock_guard<std::mutex> lock{ mutex };
+      results.insert(results.end(), first, first + n);
+    }
+    std::size_t size() const { return results.size(); }
+  };
+
+  struct lock_free_vector {
+    ftl::concurrent_vector<result> results;
+
+    void push_back(const result &r) {
+      results.push_back(r);
+    }
+    void append(const result *first, std::size_t n) {
+      results.grow_by(first, first + n);
+    }
+    std::size_t size() const { return results.size(); }
+  };
+
+  // Runs `threads` producers appending `per_thread` results each, `batch` at a time, and returns the wall time in ms.
+  template<typename Container>
+  double run(unsigned threads, std::size_t per_thread, std::size_t batch) {
+    Container container;
+    std::vector<std::thread> producers;
+    const auto start = clock::now();
+    for (unsigned t{ 0 }; t < threads; ++t) {
+      producers.emplace_back([&container, t, per_thread, batch] {
+        std::vector<result> pending(batch);
+        for (std::size_t i{ 0 }; i < per_thread; i += batch) {
+          const std::size_t count{ std::min(batch, per_thread - i) };
+          for (std::size_t j{ 0 }; j < count; ++j) {
+            pending[j] = result{ t * per_thread + i + j, static_cast<double>(i + j) * 0.5 };
+          }
+          if (batch == 1) {
+            container.push_back(pending[0]);
+          }
+          else {
+            container.append(pending.data(), count);
+          }
+        }
+      });
+    }
+    for (auto &producer : producers) producer.join();
+    const double ms{ std::chrono::duration<double, std::milli>(clock::now() - start).count() };
+    if (container.size() != threads * per_thread) std::printf("size mismatch!\n");
+    return ms;
+  }
+
+  void report(unsigned threads, std::size_t per_thread, std::size_t batch) {
+    const double locked{ run<locked_vector>(threads, per_thread, batch) };
+    const double lock_free{ run<lock_free_vector>(threads, per_thread, batch) };
+    const double total{ static_cast<double>(threads * per_thread) };
+    std::printf("%8u %8zu %14.2f %14.2f %14.2f %16.2f %8.2fx\n", threads, batch, locked, lock_free,
+      total / locked / 1000.0, total / lock_free / 1000.0, locked / lock_free);
+  }
+} // namespace
+
+int main() {
+  const unsigned max_threads{ std::max(1u, std::thread::hardware_concurrency()) };
+  const std::size_t per_thread{ 1000000 };
+  std::printf("%8s %8s %14s %14s %14s %16s %9s\n", "threads", "batch", "mutex_ms", "concurrent_ms", "mutex_Mops", "concurrent_Mops", "speedup");
+  for (std::size_t batch : { std::size_t{ 1 }, std::size_t{ 64 } }) {
+    for (unsigned threads{ 1 }; threads <= max_threads; threads *= 2) {
+      report(threads, per_thread, batch);
+    }
+    if ((max_threads & (max_threads - 1)) != 0) {
+      report(max_threads, per_thread, batch);
+    }
+  }
+  return 0;
+}
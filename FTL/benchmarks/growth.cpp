@@ -0,0 +1,141 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// Compares the growth policies on push_back heavy workloads.
+// For every policy it reports the reallocation count, the bytes left unused at the end, the time taken,
+// and the peak resident set size of a child process running the workload (POSIX only).
+#include "../vector.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define FTL_BENCH_HAS_FORK 1
+#endif
+
+namespace {
+  struct allocation_stats {
+    std::size_t allocations{ 0 };
+    std::size_t bytes{ 0 };
+  };
+  allocation_stats g_stats;
+
+  // Forwards to default_allocator and counts every allocation the vector makes.
+  template<typename T>
+  class counting_allocator : public ftl::default_allocator<T> {
+  public:
+    template<typename Type>
+    using rebind = counting_allocator<Type>;
+    T* allocate(std::size_t n, const void *hint = 0) {
+      ++g_stats.allocations;
+      g_stats.bytes += n * sizeof(T);
+      return ftl::default_allocator<T>::allocate(n, hint);
+    }
+  };
+
+  // Reports the size class it would round the request up to through allocate_at_least,
+  // the way a malloc_usable_size aware allocator would.
+  template<typename T>
+  class size_class_allocator : public counting_allocator<T> {
+  public:
+    template<typename Type>
+    using rebind = size_class_allocator<Type>;
+    ftl::allocation_result<T*> allocate_at_least(std::size_t n) {
+      const std::size_t count{ ftl::size_class_growth<>::round_to_size_class(n * sizeof(T)) / sizeof(T) };
+      return { this->allocate(count), count };
+    }
+  };
+
+  struct result {
+    std::size_t reallocations;
+    std::size_t slack_bytes;
+    double milliseconds;
+  };
+
+  template<typename Vector>
+  result run(std::size_t vectors, std::size_t elements) {
+    g_stats = allocation_stats{};
+    std::size_t slack{ 0 };
+    auto start = std::chrono::steady_clock::now();
+    {
+      ftl::vector<Vector> all;
+      all.reserve(vectors);
+      for (std::size_t v{ 0 }; v < vectors; ++v) {
+        all.emplace_back();
+        Vector &vec = all.back();
+        for (std::size_t i{ 0 }; i < elements; ++i) {
+          vec.push_back(static_cast<std::uint32_t>(i));
+        }
+        slack += (vec.capacity() - vec.size()) * sizeof(std::uint32_t);
+      }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    return { g_stats.allocations - 1, slack, std::chrono::duration<double, std::milli>(stop - start).count() };
+  }
+
+  long peak_rss_kb() {
+#ifdef FTL_BENCH_HAS_FORK
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+  }
+
+  template<typename Vector>
+  void report(const char *policy, std::size_t vectors, std::size_t elements) {
+#ifdef FTL_BENCH_HAS_FORK
+    // Peak RSS only ever increases, so every measurement runs in a fresh child process.
+    int pipe_fds[2];
+    if (pipe(pipe_fds) == 0) {
+      pid_t child = fork();
+      if (child == 0) {
+        close(pipe_fds[0]);
+        const long baseline{ peak_rss_kb() };
+        result r = run<Vector>(vectors, elements);
+        long rss{ peak_rss_kb() - baseline };
+        ssize_t written{ write(pipe_fds[1], &r, sizeof(r)) };
+        written += write(pipe_fds[1], &rss, sizeof(rss));
+        _exit(written == static_cast<ssize_t>(sizeof(r) + sizeof(rss)) ? 0 : 1);
+      }
+      close(pipe_fds[1]);
+      result r{};
+      long rss{ -1 };
+      bool ok{ read(pipe_fds[0], &r, sizeof(r)) == static_cast<ssize_t>(sizeof(r))
+        && read(pipe_fds[0], &rss, sizeof(rss)) == static_cast<ssize_t>(sizeof(rss)) };
+      close(pipe_fds[0]);
+      waitpid(child, nullptr, 0);
+      if (ok) {
+        std::printf("%-22s %10zu %10zu %14zu %14zu %12ld %10.2f\n", policy, vectors, elements, r.reallocations, r.slack_bytes, rss, r.milliseconds);
+        return;
+      }
+    }
+#endif
+    result r = run<Vector>(vectors, elements);
+    std::printf("%-22s %10zu %10zu %14zu %14zu %12s %10.2f\n", policy, vectors, elements, r.reallocations, r.slack_bytes, "n/a", r.milliseconds);
+  }
+
+  void report_all(std::size_t vectors, std::size_t elements) {
+    using value = std::uint32_t;
+    report<ftl::vector<value, counting_allocator<value>, ftl::doubling_growth>>("doubling", vectors, elements);
+    report<ftl::vector<value, counting_allocator<value>, ftl::three_halves_growth>>("three_halves", vectors, elements);
+    report<ftl::vector<value, counting_allocator<value>, ftl::size_class_growth<>>>("size_class", vectors, elements);
+    report<ftl::vector<value, size_class_allocator<value>, ftl::size_class_growth<>>>("size_class+at_least", vectors, elements);
+  }
+} // namespace
+
+int main() {
+  std::printf("%-22s %10s %10s %14s %14s %12s %10s\n", "policy", "vectors", "elements", "reallocations", "slack_bytes", "peak_rss_kb", "ms");
+  report_all(1, 1u << 26);
+  report_all(1, 50000000);
+  report_all(1000, 100000);
+  report_all(1000000, 17);
+  return 0;
+}
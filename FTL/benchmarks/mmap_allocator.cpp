@@ -0,0 +1,45 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// push_back of 2^30 ints into an ftl::vector with mmap_allocator, against one with default_allocator.
+// Besides the total, each run reports the slowest window of 1024 push_backs. With default_allocator that window holds
+// the last reallocation, which copies the whole buffer; with mmap_allocator the buffer is grown by mremap, so the
+// worst window should stay flat as the vector grows. Pass an element count as the first argument to override 2^30.
+#include "../mmap_allocator.hpp"
+#include "../vector.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+  using clock = std::chrono::steady_clock;
+
+  template<typename Alloc>
+  void report(const char *name, std::size_t count) {
+    ftl::vector<int, Alloc> container;
+    double worst_window_us{ 0 };
+    const auto start = clock::now();
+    auto previous = start;
+    for (std::size_t i{ 0 }; i < count; ++i) {
+      container.push_back(static_cast<int>(i));
+      // Sampling the clock once per window keeps the timing from dominating the loop.
+      if ((i & 1023) == 1023) {
+        const auto now = clock::now();
+        worst_window_us = std::max(worst_window_us, std::chrono::duration<double, std::micro>(now - previous).count());
+        previous = now;
+      }
+    }
+    const double total_ms{ std::chrono::duration<double, std::milli>(clock::now() - start).count() };
+    const bool intact{ container[count / 2] == static_cast<int>(count / 2) };
+    std::printf("%-18s %12zu %12.2f %16.2f %8s\n", name, count, total_ms, worst_window_us, intact ? "ok" : "WRONG");
+  }
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t count{ argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : std::size_t{ 1 } << 30 };
+  std::printf("%-18s %12s %12s %16s %8s\n", "allocator", "elements", "total_ms", "worst_1k_push_us", "check");
+  report<ftl::mmap_allocator<int>>("mmap_allocator", count);
+  report<ftl::default_allocator<int>>("default_allocator", count);
+  return 0;
+}
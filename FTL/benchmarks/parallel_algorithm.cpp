@@ -0,0 +1,65 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// Speedup curves for parallel_sort and parallel_reduce over 10^8 elements, on pools of 1 to 64 threads.
+// Each row is timed against std::sort and std::accumulate on the same data, so speedup is relative to serial code
+// rather than to the one thread pool. Pass an element count as the first argument to override 10^8.
+#include "../parallel_algorithm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+
+namespace {
+  using clock = std::chrono::steady_clock;
+
+  double ms_since(clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+  }
+
+  void fill_random(ftl::vector<std::uint32_t> &data, std::size_t count) {
+    std::mt19937 rng{ 42 };
+    data.clear();
+    data.reserve(count);
+    for (std::size_t i{ 0 }; i < count; ++i) {
+      data.push_back(rng());
+    }
+  }
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t count{ argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : std::size_t{ 100000000 } };
+  ftl::vector<std::uint32_t> data;
+
+  fill_random(data, count);
+  auto start = clock::now();
+  const std::uint64_t serial_sum{ std::accumulate(data.begin(), data.end(), std::uint64_t{ 0 }) };
+  const double serial_reduce_ms{ ms_since(start) };
+  start = clock::now();
+  std::sort(data.begin(), data.end());
+  const double serial_sort_ms{ ms_since(start) };
+
+  std::printf("%zu elements, std::accumulate %.2f ms, std::sort %.2f ms\n", count, serial_reduce_ms, serial_sort_ms);
+  std::printf("%8s %12s %14s %10s %14s\n", "threads", "reduce_ms", "reduce_speedup", "sort_ms", "sort_speedup");
+  for (std::size_t threads{ 1 }; threads <= 64; threads *= 2) {
+    ftl::thread_pool pool{ threads };
+
+    fill_random(data, count);
+    start = clock::now();
+    const std::uint64_t sum{ ftl::parallel_reduce(data, std::uint64_t{ 0 }, pool) };
+    const double reduce_ms{ ms_since(start) };
+
+    start = clock::now();
+    ftl::parallel_sort(data, std::less<std::uint32_t>{}, pool);
+    const double sort_ms{ ms_since(start) };
+
+    if (sum != serial_sum || !std::is_sorted(data.begin(), data.end())) {
+      std::printf("wrong result with %zu threads\n", threads);
+      return 1;
+    }
+    std::printf("%8zu %12.2f %13.2fx %10.2f %13.2fx\n", threads, reduce_ms, serial_reduce_ms / reduce_ms, sort_ms, serial_sort_ms / sort_ms);
+  }
+  return 0;
+}
@@ -0,0 +1,101 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// Hardware event counters for the benchmarks, read through perf_event_open on Linux.
+// Each counter is opened on its own, counting user space only, so the ones a machine lacks (virtual machines often
+// expose no PMU, and perf_event_paranoid may forbid them) are simply reported as unavailable.
+#pragma once
+
+#include <cstdint>
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define FTL_BENCH_HAS_PERF 1
+#else
+#define FTL_BENCH_HAS_PERF 0
+#endif
+
+namespace ftl_bench {
+
+  enum counter { cycles, instructions, cache_misses, branch_misses, counter_count };
+
+  inline const char* counter_name(int c) {
+    static const char *names[counter_count]{ "cycles", "instructions", "cache_misses", "branch_misses" };
+    return names[c];
+  }
+
+  struct counter_values {
+    std::uint64_t value[counter_count];
+    bool available[counter_count];
+  };
+
+  class perf_counters {
+  public:
+    perf_counters() {
+#if FTL_BENCH_HAS_PERF
+      static const std::uint64_t configs[counter_count]{ PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+      for (int c{ 0 }; c < counter_count; ++c) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[c];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fds[c] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+      }
+#else
+      for (int &fd : m_fds) fd = -1;
+#endif
+    }
+    perf_counters(const perf_counters &) = delete;
+    perf_counters& operator=(const perf_counters &) = delete;
+    ~perf_counters() {
+#if FTL_BENCH_HAS_PERF
+      for (int fd : m_fds) {
+        if (fd >= 0) ::close(fd);
+      }
+#endif
+    }
+
+    bool any_available() const {
+      for (int fd : m_fds) {
+        if (fd >= 0) return true;
+      }
+      return false;
+    }
+
+    void start() {
+#if FTL_BENCH_HAS_PERF
+      for (int fd : m_fds) {
+        if (fd < 0) continue;
+        ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+#endif
+    }
+
+    counter_values stop() {
+      counter_values result{};
+#if FTL_BENCH_HAS_PERF
+      for (int fd : m_fds) {
+        if (fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      }
+      for (int c{ 0 }; c < counter_count; ++c) {
+        std::uint64_t value{ 0 };
+        result.available[c] = m_fds[c] >= 0 && ::read(m_fds[c], &value, sizeof(value)) == static_cast<ssize_t>(sizeof(value));
+        result.value[c] = result.available[c] ? value : 0;
+      }
+#endif
+      return result;
+    }
+
+  private:
+    int m_fds[counter_count];
+  };
+
+} // namespace ftl_bench
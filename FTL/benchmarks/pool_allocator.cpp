@@ -0,0 +1,61 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// Churn of 10^7 allocate/deallocate pairs through pool_allocator and default_allocator.
+// A window of 4096 live blocks of 1 to 16 ints is kept, and each step frees a random block and allocates a new one
+// of random size in its place, which is what many small vectors spilling over their inline buffers look like.
+// Pass a pair count as the first argument to override 10^7.
+#include "../pool_allocator.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+  using clock = std::chrono::steady_clock;
+
+  struct slot {
+    int *block;
+    std::size_t size;
+  };
+
+  template<typename Alloc>
+  void churn(const char *name, Alloc alloc, std::size_t pairs) {
+    constexpr std::size_t window{ 4096 };
+    std::mt19937 rng{ 42 };
+    std::uniform_int_distribution<std::size_t> size_of{ 1, 16 };
+    // The random choices are drawn up front, so the timed loop only measures the allocator.
+    std::vector<std::uint32_t> choices(pairs);
+    for (auto &choice : choices) choice = static_cast<std::uint32_t>(rng() % window) | static_cast<std::uint32_t>(size_of(rng) << 16);
+
+    std::vector<slot> live(window);
+    for (auto &s : live) {
+      s.size = size_of(rng);
+      s.block = alloc.allocate(s.size);
+    }
+    std::uint64_t checksum{ 0 };
+    const auto start = clock::now();
+    for (std::uint32_t choice : choices) {
+      slot &s = live[choice & 0xFFFF];
+      alloc.deallocate(s.block, s.size);
+      s.size = choice >> 16;
+      s.block = alloc.allocate(s.size);
+      s.block[0] = static_cast<int>(s.size);
+      checksum += reinterpret_cast<std::uintptr_t>(s.block) & 0xFF;
+    }
+    const double elapsed_ns{ std::chrono::duration<double, std::nano>(clock::now() - start).count() };
+    for (auto &s : live) alloc.deallocate(s.block, s.size);
+    std::printf("%-18s %12zu %12.2f %12.2f %8llu\n", name, pairs, elapsed_ns / 1e6, elapsed_ns / static_cast<double>(pairs),
+      static_cast<unsigned long long>(checksum % 1000));
+  }
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t pairs{ argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : std::size_t{ 10000000 } };
+  std::printf("%-18s %12s %12s %12s %8s\n", "allocator", "pairs", "total_ms", "ns_per_pair", "check");
+  churn("default_allocator", ftl::default_allocator<int>{}, pairs);
+  ftl::block_pool pool;
+  churn("pool_allocator", ftl::pool_allocator<int, 16>{ pool }, pairs);
+  return 0;
+}
@@ -0,0 +1,77 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// Compares appending to and scanning ftl::segmented_vector against ftl::vector.
+// Besides the total, the append pass reports the slowest window of 1024 push_backs. For ftl::vector that window holds
+// the final reallocation copying the whole buffer.
+// The scan pass sums every element, through for_each_block for the segmented_vector.
+#include "../segmented_vector.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+
+namespace {
+  using clock = std::chrono::steady_clock;
+
+  struct timings {
+    double append_ms{ 0 };
+    double worst_window_us{ 0 };
+    double scan_ms{ 0 };
+    std::uint64_t checksum{ 0 };
+  };
+
+  template<typename Container>
+  void append(Container &container, std::size_t count, timings &t) {
+    const auto start = clock::now();
+    auto previous = start;
+    for (std::size_t i{ 0 }; i < count; ++i) {
+      container.push_back(static_cast<std::uint32_t>(i));
+      // Sampling the clock once per window keeps the timing from dominating the loop.
+      if ((i & 1023) == 1023) {
+        const auto now = clock::now();
+        t.worst_window_us = std::max(t.worst_window_us, std::chrono::duration<double, std::micro>(now - previous).count());
+        previous = now;
+      }
+    }
+    t.append_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+  }
+
+  std::uint64_t sum(const ftl::vector<std::uint32_t> &container) {
+    return std::accumulate(container.begin(), container.end(), std::uint64_t{ 0 });
+  }
+  std::uint64_t sum(const ftl::segmented_vector<std::uint32_t> &container) {
+    std::uint64_t total{ 0 };
+    container.for_each_block([&](const std::uint32_t *first, const std::uint32_t *last) {
+      total = std::accumulate(first, last, total);
+    });
+    return total;
+  }
+
+  template<typename Container>
+  timings run(std::size_t count) {
+    timings t;
+    Container container;
+    append(container, count, t);
+    const auto start = clock::now();
+    t.checksum = sum(container);
+    t.scan_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    return t;
+  }
+
+  template<typename Container>
+  void report(const char *name, std::size_t count) {
+    const timings t{ run<Container>(count) };
+    std::printf("%-18s %12zu %12.2f %16.2f %10.2f %20llu\n", name, count, t.append_ms, t.worst_window_us, t.scan_ms,
+      static_cast<unsigned long long>(t.checksum));
+  }
+} // namespace
+
+int main() {
+  std::printf("%-18s %12s %12s %16s %10s %20s\n", "container", "elements", "append_ms", "worst_1k_push_us", "scan_ms", "checksum");
+  for (std::size_t count : { std::size_t{ 1000000 }, std::size_t{ 10000000 }, std::size_t{ 50000000 } }) {
+    report<ftl::vector<std::uint32_t>>("vector", count);
+    report<ftl::segmented_vector<std::uint32_t>>("segmented_vector", count);
+  }
+  return 0;
+}
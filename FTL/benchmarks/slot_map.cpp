@@ -0,0 +1,141 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// Compares slot_map against std::unordered_map<uint64_t, T> on an entity churn workload.
+// Both containers start with the same entities. Every tick then destroys a slice of random live entities,
+// spawns as many new ones, looks every live entity up by its handle, and updates all entities in a linear pass.
+#include "../slot_map.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+  struct entity {
+    float position[3];
+    float velocity[3];
+    std::uint32_t id;
+  };
+
+  struct timings {
+    double populate{ 0 };
+    double churn{ 0 };
+    double lookup{ 0 };
+    double iterate{ 0 };
+    double checksum{ 0 };
+  };
+
+  using clock = std::chrono::steady_clock;
+  double ms_since(clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+  }
+
+  entity make_entity(std::uint32_t id) {
+    const float f{ static_cast<float>(id) };
+    return entity{ { f, f, f }, { 1.0f, 0.5f, 0.25f }, id };
+  }
+
+  // Handles are 64 bit: the slot_map key packed into an integer, or an ever increasing id for the unordered_map.
+  struct slot_map_world {
+    using key = ftl::slot_map<entity>::key;
+    ftl::slot_map<entity> entities;
+    std::uint32_t next_id{ 0 };
+
+    std::uint64_t spawn() {
+      key k{ entities.insert(make_entity(next_id++)) };
+      return (static_cast<std::uint64_t>(k.generation) << 32) | k.index;
+    }
+    void destroy(std::uint64_t handle) {
+      entities.erase(key{ static_cast<std::uint32_t>(handle), static_cast<std::uint32_t>(handle >> 32) });
+    }
+    entity* find(std::uint64_t handle) {
+      return entities.find(key{ static_cast<std::uint32_t>(handle), static_cast<std::uint32_t>(handle >> 32) });
+    }
+    template<typename Function>
+    void for_each(Function function) {
+      for (entity &e : entities) {
+        function(e);
+      }
+    }
+  };
+
+  struct unordered_map_world {
+    std::unordered_map<std::uint64_t, entity> entities;
+    std::uint32_t next_id{ 0 };
+
+    std::uint64_t spawn() {
+      const std::uint64_t handle{ next_id };
+      entities.emplace(handle, make_entity(next_id++));
+      return handle;
+    }
+    void destroy(std::uint64_t handle) {
+      entities.erase(handle);
+    }
+    entity* find(std::uint64_t handle) {
+      auto it = entities.find(handle);
+      return it == entities.end() ? nullptr : &it->second;
+    }
+    template<typename Function>
+    void for_each(Function function) {
+      for (auto &pair : entities) {
+        function(pair.second);
+      }
+    }
+  };
+
+  template<typename World>
+  timings run(std::size_t population, std::size_t ticks, std::size_t churn_per_tick) {
+    timings t;
+    World world;
+    std::vector<std::uint64_t> handles;
+    handles.reserve(population);
+    std::mt19937_64 rng{ 42 };
+
+    auto start = clock::now();
+    for (std::size_t i{ 0 }; i < population; ++i) {
+      handles.push_back(world.spawn());
+    }
+    t.populate = ms_since(start);
+
+    for (std::size_t tick{ 0 }; tick < ticks; ++tick) {
+      start = clock::now();
+      for (std::size_t i{ 0 }; i < churn_per_tick; ++i) {
+        std::uint64_t &handle = handles[rng() % handles.size()];
+        world.destroy(handle);
+        handle = world.spawn();
+      }
+      t.churn += ms_since(start);
+
+      start = clock::now();
+      for (std::uint64_t handle : handles) {
+        entity *e{ world.find(handle) };
+        if (e) t.checksum += e->position[0];
+      }
+      t.lookup += ms_since(start);
+
+      start = clock::now();
+      world.for_each([&](entity &e) {
+        for (int axis{ 0 }; axis < 3; ++axis) {
+          e.position[axis] += e.velocity[axis];
+        }
+      });
+      t.iterate += ms_since(start);
+    }
+    return t;
+  }
+
+  template<typename World>
+  void report(const char *container, std::size_t population, std::size_t ticks, std::size_t churn_per_tick) {
+    timings t = run<World>(population, ticks, churn_per_tick);
+    std::printf("%-16s %10zu %6zu %10zu %12.2f %12.2f %12.2f %12.2f %16.0f\n", container, population, ticks, churn_per_tick,
+      t.populate, t.churn, t.lookup, t.iterate, t.checksum);
+  }
+} // namespace
+
+int main() {
+  std::printf("%-16s %10s %6s %10s %12s %12s %12s %12s %16s\n", "container", "entities", "ticks", "churn", "populate_ms", "churn_ms", "lookup_ms", "iterate_ms", "checksum");
+  report<slot_map_world>("slot_map", 1000000, 10, 100000);
+  report<unordered_map_world>("unordered_map", 1000000, 10, 100000);
+  return 0;
+}
@@ -0,0 +1,96 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// Throughput of snapshot save and load, to compare against the bandwidth of the disk and of a pipe.
+// The raw case is a vector of 2^27 uint64_t (1 GiB) written to a file and read back, then streamed through a pipe to a
+// reader thread. The per-element case writes short strings through snapshot_traits.
+// Pass an element count as the first argument to override 2^27, and a path as the second to pick the file system.
+// The file is not fsynced, so on a machine with spare memory the file numbers measure the page cache.
+#include "../snapshot.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#if FTL_HAS_SNAPSHOT
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+  using clock = std::chrono::steady_clock;
+
+  double seconds_since(clock::time_point start) {
+    return std::chrono::duration<double>(clock::now() - start).count();
+  }
+
+  void report(const char *name, double bytes, double seconds) {
+    std::printf("%-28s %12.1f %10.3f %10.2f\n", name, bytes / (1 << 20), seconds, bytes / seconds / (1 << 30));
+  }
+
+  template<typename Container>
+  void file_round_trip(const char *name, const char *path, const Container &data) {
+    const int fd{ ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644) };
+    if (fd < 0) {
+      std::perror(path);
+      std::exit(1);
+    }
+    auto start = clock::now();
+    const double bytes{ static_cast<double>(ftl::save_at(fd, 0, data)) };
+    report((std::string{ name } + " save file").c_str(), bytes, seconds_since(start));
+    Container loaded;
+    start = clock::now();
+    ftl::load_at(fd, 0, loaded);
+    report((std::string{ name } + " load file").c_str(), bytes, seconds_since(start));
+    if (loaded.size() != data.size() || loaded.back() != data.back()) {
+      std::printf("wrong result\n");
+      std::exit(1);
+    }
+    ::close(fd);
+    std::remove(path);
+  }
+
+  template<typename Container>
+  void pipe_round_trip(const char *name, const Container &data) {
+    int fds[2];
+    if (::pipe(fds) != 0) {
+      std::perror("pipe");
+      std::exit(1);
+    }
+    Container loaded;
+    const auto start = clock::now();
+    std::thread reader{ [&] { ftl::load(fds[0], loaded); } };
+    ftl::save(fds[1], data);
+    reader.join();
+    const double elapsed{ seconds_since(start) };
+    report((std::string{ name } + " through pipe").c_str(), static_cast<double>(data.size() * sizeof(typename Container::value_type)), elapsed);
+    ::close(fds[0]);
+    ::close(fds[1]);
+  }
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t count{ argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : std::size_t{ 1 } << 27 };
+  const char *path{ argc > 2 ? argv[2] : "ftl_snapshot_bench.bin" };
+
+  std::printf("%-28s %12s %10s %10s\n", "case", "MiB", "seconds", "GiB/s");
+  ftl::vector<std::uint64_t> raw;
+  raw.resize(count, std::uint64_t{ 0 });
+  for (std::size_t i{ 0 }; i < count; ++i) raw[i] = i * 0x9E3779B97F4A7C15ull;
+  file_round_trip("uint64_t", path, raw);
+  pipe_round_trip("uint64_t", raw);
+  raw = ftl::vector<std::uint64_t>{};
+
+  ftl::vector<std::string> strings;
+  const std::size_t string_count{ count / 16 };
+  strings.reserve(string_count);
+  for (std::size_t i{ 0 }; i < string_count; ++i) strings.push_back(std::to_string(i));
+  file_round_trip("string", path, strings);
+  return 0;
+}
+#else
+int main() {
+  std::printf("snapshots are not available on this platform\n");
+  return 0;
+}
+#endif
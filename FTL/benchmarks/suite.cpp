@@ -0,0 +1,289 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// The regression suite: push_back, reserve, insert and erase on every vector and allocator of the library, next to
+// std::vector with std::allocator, for int, a 64 byte trivially copyable struct, and std::string, at several sizes.
+// Each case reports the time per operation and, where perf_event_open gives access to them, cycles, instructions,
+// cache misses and branch misses per operation; counters the machine doesn't expose are left out.
+// Usage: FTL_bench_suite [--json | --csv] [--scale=<factor>] [filter]
+// The default output is a table. --json and --csv write one record per case, in a stable order, so the results of
+// two runs can be diffed or loaded side by side. --scale multiplies the work per case (0.01 for a smoke test), and
+// only cases whose name contains the filter run.
+#include "perf_counters.hpp"
+#include "../vector.hpp"
+#include "../arena.hpp"
+#include "../pool_allocator.hpp"
+#include "../mmap_allocator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+  using clock = std::chrono::steady_clock;
+  volatile std::uintptr_t g_sink;
+
+  // A cache line of payload which is trivially copyable, so the library may relocate it with memcpy.
+  struct blob64 {
+    std::uint64_t words[8];
+  };
+
+  template<typename T>
+  struct element;
+  template<>
+  struct element<int> {
+    static const char* name() { return "int"; }
+    static int make(std::size_t i) { return static_cast<int>(i); }
+  };
+  template<>
+  struct element<blob64> {
+    static const char* name() { return "blob64"; }
+    static blob64 make(std::size_t i) {
+      blob64 result;
+      for (std::uint64_t &word : result.words) word = i;
+      return result;
+    }
+  };
+  template<>
+  struct element<std::string> {
+    static const char* name() { return "string"; }
+    // Long enough to be heap allocated by every standard library, so moving and copying differ.
+    static std::string make(std::size_t i) { return std::string(24, static_cast<char>('a' + i % 26)); }
+  };
+
+  // How to make an empty container, and how to release what its allocator holds between measurements.
+  template<typename Container>
+  struct container_factory {
+    static Container make() { return Container{}; }
+    static void reset() {}
+  };
+  template<typename T>
+  struct container_factory<ftl::vector<T, ftl::arena_allocator<T>>> {
+    static ftl::arena& source() {
+      static ftl::arena instance{ std::size_t{ 1 } << 20 };
+      return instance;
+    }
+    static ftl::vector<T, ftl::arena_allocator<T>> make() { return ftl::vector<T, ftl::arena_allocator<T>>{ ftl::arena_allocator<T>{ source() } }; }
+    static void reset() { source().reset(); }
+  };
+
+  struct options {
+    enum class format { table, json, csv } output{ format::table };
+    double scale{ 1.0 };
+    const char *filter{ "" };
+  };
+
+  struct result {
+    std::string name;
+    const char *container;
+    const char *element;
+    const char *operation;
+    std::size_t size;
+    std::uint64_t ops;
+    double ns_per_op;
+    ftl_bench::counter_values counters;
+  };
+
+  class suite {
+  public:
+    explicit suite(const options &opts) : m_options(opts) {}
+
+    // Picks the repetitions so a measurement does about 4 million units of work (times the scale), takes the
+    // fastest of three measurements of body(repetitions), and records it as repetitions * ops_per_repetition operations.
+    template<typename Body>
+    void run(const char *container, const char *element, const char *operation, std::size_t size,
+      std::uint64_t ops_per_repetition, std::uint64_t work_per_repetition, Body body) {
+      std::string name{ std::string{ container } + "/" + element + "/" + operation + "/" + std::to_string(size) };
+      if (!std::strstr(name.c_str(), m_options.filter)) return;
+      const double budget{ 4e6 * m_options.scale };
+      const std::size_t repetitions{ std::max<std::size_t>(1, static_cast<std::size_t>(budget / static_cast<double>(work_per_repetition))) };
+      result best{ name, container, element, operation, size, ops_per_repetition * repetitions, 0.0, {} };
+      for (int measurement{ 0 }; measurement < 3; ++measurement) {
+        m_counters.start();
+        const clock::time_point start{ clock::now() };
+        body(repetitions);
+        const double elapsed{ std::chrono::duration<double, std::nano>(clock::now() - start).count() };
+        const ftl_bench::counter_values counters{ m_counters.stop() };
+        const double ns{ elapsed / static_cast<double>(best.ops) };
+        if (measurement == 0 || ns < best.ns_per_op) {
+          best.ns_per_op = ns;
+          best.counters = counters;
+        }
+      }
+      m_results.push_back(best);
+    }
+
+    void write() const {
+      switch (m_options.output) {
+      case options::format::json: write_json(); break;
+      case options::format::csv: write_csv(); break;
+      default: write_table(); break;
+      }
+    }
+
+  private:
+    static double per_op(const result &r, int c) {
+      return static_cast<double>(r.counters.value[c]) / static_cast<double>(r.ops);
+    }
+
+    void write_table() const {
+      std::printf("# hardware counters: %s\n", m_counters.any_available() ? "perf_event_open" : "unavailable, timing only");
+      std::printf("%-52s %10s", "case", "ns/op");
+      for (int c{ 0 }; c < ftl_bench::counter_count; ++c) std::printf(" %14s", ftl_bench::counter_name(c));
+      std::printf("\n");
+      for (const result &r : m_results) {
+        std::printf("%-52s %10.2f", r.name.c_str(), r.ns_per_op);
+        for (int c{ 0 }; c < ftl_bench::counter_count; ++c) {
+          if (r.counters.available[c]) std::printf(" %14.2f", per_op(r, c));
+          else std::printf(" %14s", "-");
+        }
+        std::printf("\n");
+      }
+    }
+
+    void write_json() const {
+      std::printf("[\n");
+      for (std::size_t i{ 0 }; i < m_results.size(); ++i) {
+        const result &r = m_results[i];
+        std::printf("  {\"container\":\"%s\",\"element\":\"%s\",\"operation\":\"%s\",\"size\":%zu,\"ops\":%llu,\"ns_per_op\":%.4f",
+          r.container, r.element, r.operation, r.size, static_cast<unsigned long long>(r.ops), r.ns_per_op);
+        for (int c{ 0 }; c < ftl_bench::counter_count; ++c) {
+          if (r.counters.available[c]) std::printf(",\"%s_per_op\":%.4f", ftl_bench::counter_name(c), per_op(r, c));
+          else std::printf(",\"%s_per_op\":null", ftl_bench::counter_name(c));
+        }
+        std::printf("}%s\n", i + 1 < m_results.size() ? "," : "");
+      }
+      std::printf("]\n");
+    }
+
+    void write_csv() const {
+      std::printf("container,element,operation,size,ops,ns_per_op");
+      for (int c{ 0 }; c < ftl_bench::counter_count; ++c) std::printf(",%s_per_op", ftl_bench::counter_name(c));
+      std::printf("\n");
+      for (const result &r : m_results) {
+        std::printf("%s,%s,%s,%zu,%llu,%.4f", r.container, r.element, r.operation, r.size, static_cast<unsigned long long>(r.ops), r.ns_per_op);
+        for (int c{ 0 }; c < ftl_bench::counter_count; ++c) {
+          if (r.counters.available[c]) std::printf(",%.4f", per_op(r, c));
+          else std::printf(",");
+        }
+        std::printf("\n");
+      }
+    }
+
+    options m_options;
+    ftl_bench::perf_counters m_counters;
+    std::vector<result> m_results;
+  };
+
+  template<typename Container>
+  void sink(const Container &c) {
+    g_sink = reinterpret_cast<std::uintptr_t>(c.data()) + c.size();
+  }
+
+  // Appends one element at a time to an empty container.
+  template<typename Container>
+  void bench_push_back(suite &s, const char *container, std::size_t n) {
+    using T = typename Container::value_type;
+    s.run(container, element<T>::name(), "push_back", n, n, n, [n](std::size_t repetitions) {
+      for (std::size_t r{ 0 }; r < repetitions; ++r) {
+        Container c{ container_factory<Container>::make() };
+        for (std::size_t i{ 0 }; i < n; ++i) c.push_back(element<T>::make(i));
+        sink(c);
+        c = container_factory<Container>::make();
+        container_factory<Container>::reset();
+      }
+    });
+  }
+
+  // Reserves the final size up front, then appends.
+  template<typename Container>
+  void bench_reserve(suite &s, const char *container, std::size_t n) {
+    using T = typename Container::value_type;
+    s.run(container, element<T>::name(), "reserve_push_back", n, n, n, [n](std::size_t repetitions) {
+      for (std::size_t r{ 0 }; r < repetitions; ++r) {
+        Container c{ container_factory<Container>::make() };
+        c.reserve(n);
+        for (std::size_t i{ 0 }; i < n; ++i) c.push_back(element<T>::make(i));
+        sink(c);
+        c = container_factory<Container>::make();
+        container_factory<Container>::reset();
+      }
+    });
+  }
+
+  // Builds the container by inserting every element at the front, the worst case of shifting.
+  template<typename Container>
+  void bench_insert_front(suite &s, const char *container, std::size_t n) {
+    using T = typename Container::value_type;
+    s.run(container, element<T>::name(), "insert_front", n, n, n * n / 2 + n, [n](std::size_t repetitions) {
+      for (std::size_t r{ 0 }; r < repetitions; ++r) {
+        Container c{ container_factory<Container>::make() };
+        for (std::size_t i{ 0 }; i < n; ++i) c.insert(c.begin(), element<T>::make(i));
+        sink(c);
+        c = container_factory<Container>::make();
+        container_factory<Container>::reset();
+      }
+    });
+  }
+
+  // Empties a full container by erasing its first element, which unordered_vector does in O(1).
+  template<typename Container>
+  void bench_erase_front(suite &s, const char *container, std::size_t n) {
+    using T = typename Container::value_type;
+    s.run(container, element<T>::name(), "erase_front", n, n, n * n / 2 + n, [n](std::size_t repetitions) {
+      for (std::size_t r{ 0 }; r < repetitions; ++r) {
+        Container c{ container_factory<Container>::make() };
+        for (std::size_t i{ 0 }; i < n; ++i) c.push_back(element<T>::make(i));
+        while (!c.empty()) c.erase(c.begin());
+        sink(c);
+        c = container_factory<Container>::make();
+        container_factory<Container>::reset();
+      }
+    });
+  }
+
+  template<typename Container>
+  void bench_container(suite &s, const char *container) {
+    for (std::size_t n : { std::size_t{ 16 }, std::size_t{ 1024 }, std::size_t{ 65536 } }) {
+      bench_push_back<Container>(s, container, n);
+      bench_reserve<Container>(s, container, n);
+    }
+    for (std::size_t n : { std::size_t{ 16 }, std::size_t{ 1024 } }) {
+      bench_insert_front<Container>(s, container, n);
+      bench_erase_front<Container>(s, container, n);
+    }
+  }
+
+  template<typename T>
+  void bench_element(suite &s) {
+    bench_container<std::vector<T>>(s, "std::vector");
+    bench_container<ftl::vector<T>>(s, "ftl::vector");
+    bench_container<ftl::inline_vector<T, 16>>(s, "ftl::inline_vector<16>");
+    bench_container<ftl::unordered_vector<T>>(s, "ftl::unordered_vector");
+    bench_container<ftl::vector<T, ftl::pool_allocator<T>>>(s, "ftl::vector+pool");
+    bench_container<ftl::vector<T, ftl::arena_allocator<T>>>(s, "ftl::vector+arena");
+    bench_container<ftl::aligned_vector<T>>(s, "ftl::vector+aligned");
+#if FTL_HAS_MMAP
+    bench_container<ftl::vector<T, ftl::mmap_allocator<T>>>(s, "ftl::vector+mmap");
+#endif
+  }
+} // namespace
+
+int main(int argc, char **argv) {
+  options opts;
+  for (int i{ 1 }; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--json")) opts.output = options::format::json;
+    else if (!std::strcmp(argv[i], "--csv")) opts.output = options::format::csv;
+    else if (!std::strncmp(argv[i], "--scale=", 8)) opts.scale = std::strtod(argv[i] + 8, nullptr);
+    else opts.filter = argv[i];
+  }
+  suite s{ opts };
+  bench_element<int>(s);
+  bench_element<blob64>(s);
+  bench_element<std::string>(s);
+  s.write();
+  return 0;
+}
@@ -0,0 +1,520 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "vector.hpp" // detail kernels, default_allocator, allocator_holder
+
+#include <atomic> // atomic
+#include <climits> // CHAR_BIT
+#include <cstddef> // size_t, ptrdiff_t
+#include <exception> // terminate
+#include <algorithm> // min
+#include <cassert> // assert
+#include <iterator> // random_access_iterator_tag, distance, reverse_iterator
+#include <type_traits> // is_nothrow_constructible
+#include <utility> // forward, move, swap
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h> // _BitScanReverse64
+#endif
+
+namespace ftl {
+
+  namespace detail {
+    // The index of the highest set bit. n must not be 0.
+    inline ::std::size_t floor_log2(::std::size_t n) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+      unsigned long index;
+      _BitScanReverse64(&index, n);
+      return index;
+#else
+      return sizeof(unsigned long long) * CHAR_BIT - 1 - static_cast<::std::size_t>(__builtin_clzll(n));
+#endif
+    }
+  } // namespace detail
+
+  // concurrent_vector is a vector which many threads can append to at once, while others read it.
+  // Elements live in segments which double in size, so growing allocates a new segment instead of relocating:
+  // an element never moves, and references and iterators to it stay valid until clear() or destruction.
+  // Appending reserves indices with a single atomic fetch_add, and a missing segment is installed with a
+  // compare-exchange, so no append ever waits on another thread.
+  //
+  // Thread safety:
+  // push_back, emplace_back, grow_by, grow_to_at_least, reserve, operator[], at, size and iteration may run concurrently.
+  // size() counts the indices handed out, so it can include elements which another thread is still constructing.
+  // Only read an element once the append that produced it happened-before the read, e.g. through a join or a flag.
+  // Every other member, including clear, assignment, swap and destruction, needs exclusive access.
+  // The allocator's allocate and deallocate must be thread safe.
+  //
+  // Exceptions:
+  // An element whose constructor can throw is constructed before its index is reserved, then moved into place,
+  // so a throwing constructor leaves the vector unchanged; such types must be nothrow move constructible.
+  // If a constructor throws part way through grow_by, the rest of the batch is value initialized before rethrowing,
+  // so grow_by requires a nothrow default constructor for types which can throw while being constructed.
+  template<typename T, typename Alloc = default_allocator<T>>
+  class concurrent_vector : private detail::allocator_holder<Alloc> {
+    using allocator_holder = detail::allocator_holder<Alloc>;
+    template<bool Const>
+    class iterator_base;
+  public:
+    using value_type = T;
+    using allocator_type = Alloc;
+    using size_type = ::std::size_t;
+    using difference_type = ::std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+    using reverse_iterator = ::std::reverse_iterator<iterator>;
+    using const_reverse_iterator = ::std::reverse_iterator<const_iterator>;
+
+    // The first segment holds 2^first_segment_log elements, and every later segment is as large as all before it.
+    static constexpr size_type first_segment_log{ 3 };
+    static constexpr size_type segment_count{ sizeof(size_type) * CHAR_BIT - first_segment_log };
+
+    concurrent_vector() = default;
+    explicit concurrent_vector(const allocator_type &alloc);
+    concurrent_vector(size_type n, const T &val, const allocator_type &alloc = allocator_type{});
+    concurrent_vector(::std::initializer_list<T> il, const allocator_type &alloc = allocator_type{});
+    concurrent_vector(const concurrent_vector &other);
+    concurrent_vector(concurrent_vector &&other) noexcept;
+    ~concurrent_vector();
+
+    concurrent_vector& operator=(const concurrent_vector &other);
+    concurrent_vector& operator=(concurrent_vector &&other) noexcept;
+
+    // iterators
+    iterator begin() noexcept { return iterator{ this, 0 }; }
+    iterator end() noexcept { return iterator{ this, size() }; }
+    const_iterator begin() const noexcept { return const_iterator{ this, 0 }; }
+    const_iterator end() const noexcept { return const_iterator{ this, size() }; }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator{ end() }; }
+    reverse_iterator rend() noexcept { return reverse_iterator{ begin() }; }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator{ end() }; }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator{ begin() }; }
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+    const_reverse_iterator crend() const noexcept { return rend(); }
+
+    // element access
+    reference operator[](size_type n) noexcept { return *element(n); }
+    const_reference operator[](size_type n) const noexcept { return *element(n); }
+    reference at(size_type n) noexcept;
+    const_reference at(size_type n) const noexcept;
+    reference front() noexcept { return (*this)[0]; }
+    const_reference front() const noexcept { return (*this)[0]; }
+    reference back() noexcept { return (*this)[size() - 1]; }
+    const_reference back() const noexcept { return (*this)[size() - 1]; }
+
+    // modifiers
+    // Each append returns an iterator to the first element it added.
+    iterator push_back(const T &val) { return emplace_back(val); }
+    iterator push_back(T &&val) { return emplace_back(::std::move(val)); }
+    template<typename... Args>
+    iterator emplace_back(Args&&... args);
+    // Appends n value initialized elements, or n copies of val, as one contiguous range of indices.
+    iterator grow_by(size_type n);
+    iterator grow_by(size_type n, const T &val);
+    template<typename ForwardIterator, typename = typename ::std::enable_if<!::std::is_integral<ForwardIterator>::value>::type>
+    iterator grow_by(ForwardIterator first, ForwardIterator last);
+    iterator grow_by(::std::initializer_list<T> il) { return grow_by(il.begin(), il.end()); }
+    // Appends value initialized elements until there are at least n. Returns an iterator to element n - 1.
+    iterator grow_to_at_least(size_type n);
+    void clear() noexcept;
+    void swap(concurrent_vector &other) noexcept;
+
+    // capacity
+    size_type size() const noexcept { return m_size.load(::std::memory_order_acquire); }
+    size_type max_size() const noexcept { return allocator_ref().max_size(); }
+    bool empty() const noexcept { return size() == 0; }
+    // The number of elements the installed segments can hold without allocating.
+    size_type capacity() const noexcept;
+    void reserve(size_type elements);
+    // Frees every segment past the ones holding elements. Needs exclusive access.
+    void shrink_to_fit();
+
+    allocator_type get_allocator() const noexcept { return allocator_ref(); }
+
+  private:
+    using allocator_holder::allocator_ref;
+
+    static constexpr size_type first_segment_size{ size_type{ 1 } << first_segment_log };
+    static size_type segment_of(size_type index) noexcept { return detail::floor_log2(index + first_segment_size) - first_segment_log; }
+    // The index of the first element in segment k, which is also the number of elements held by the segments before it.
+    static size_type segment_base(size_type k) noexcept { return (first_segment_size << k) - first_segment_size; }
+    static size_type segment_size(size_type k) noexcept { return first_segment_size << k; }
+
+    T* element(size_type index) const noexcept;
+    // Makes sure the segments holding [0, end) are installed. Safe to call from many threads at once.
+    void install_segments(size_type end);
+    // Reserves n indices and returns the first. The segments for them are installed before returning.
+    size_type reserve_indices(size_type n);
+    // Constructs [first, first + n) one segment at a time with fill(dest, count), which constructs a whole chunk or
+    // nothing. Nothrow says whether fill can throw; if it does, the rest of the batch is value initialized.
+    template<bool Nothrow, typename Fill>
+    void construct_range(size_type first, size_type n, Fill fill);
+    template<typename Fill>
+    void construct_chunks(size_type first, size_type n, size_type &done, Fill &fill);
+    void value_construct_rest(size_type first, size_type n, ::std::true_type) noexcept;
+    // Only reachable when a fill which cannot throw did.
+    void value_construct_rest(size_type, size_type, ::std::false_type) noexcept { ::std::terminate(); }
+    template<typename... Args>
+    iterator emplace_back(::std::true_type, Args&&... args);
+    template<typename... Args>
+    iterator emplace_back(::std::false_type, Args&&... args);
+    void destroy_all() noexcept;
+    void release_segments(size_type first_segment) noexcept;
+
+    ::std::atomic<T*> m_segments[segment_count]{};
+    ::std::atomic<size_type> m_size{ 0 };
+  };
+
+  // Iterators index into the vector, so they stay valid while it grows.
+  template<typename T, typename Alloc>
+  template<bool Const>
+  class concurrent_vector<T, Alloc>::iterator_base {
+    friend class concurrent_vector;
+    friend class iterator_base<!Const>;
+    using container = typename ::std::conditional<Const, const concurrent_vector, concurrent_vector>::type;
+  public:
+    using iterator_category = ::std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = ::std::ptrdiff_t;
+    using reference = typename ::std::conditional<Const, const T&, T&>::type;
+    using pointer = typename ::std::conditional<Const, const T*, T*>::type;
+
+    iterator_base() = default;
+    template<bool OtherConst, typename = typename ::std::enable_if<Const && !OtherConst>::type>
+    iterator_base(const iterator_base<OtherConst> &other) noexcept : m_vector(other.m_vector), m_index(other.m_index) {}
+
+    reference operator*() const noexcept { return (*m_vector)[m_index]; }
+    pointer operator->() const noexcept { return &(*m_vector)[m_index]; }
+    reference operator[](difference_type n) const noexcept { return (*m_vector)[m_index + n]; }
+
+    iterator_base& operator++() noexcept { ++m_index; return *this; }
+    iterator_base operator++(int) noexcept { iterator_base old{ *this }; ++m_index; return old; }
+    iterator_base& operator--() noexcept { --m_index; return *this; }
+    iterator_base operator--(int) noexcept { iterator_base old{ *this }; --m_index; return old; }
+    iterator_base& operator+=(difference_type n) noexcept { m_index += n; return *this; }
+    iterator_base& operator-=(difference_type n) noexcept { m_index -= n; return *this; }
+    friend iterator_base operator+(iterator_base it, difference_type n) noexcept { return it += n; }
+    friend iterator_base operator+(difference_type n, iterator_base it) noexcept { return it += n; }
+    friend iterator_base operator-(iterator_base it, difference_type n) noexcept { return it -= n; }
+    friend difference_type operator-(const iterator_base &lhs, const iterator_base &rhs) noexcept {
+      return static_cast<difference_type>(lhs.m_index - rhs.m_index);
+    }
+
+    friend bool operator==(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index == rhs.m_index; }
+    friend bool operator!=(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index != rhs.m_index; }
+    friend bool operator<(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index < rhs.m_index; }
+    friend bool operator>(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index > rhs.m_index; }
+    friend bool operator<=(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index <= rhs.m_index; }
+    friend bool operator>=(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index >= rhs.m_index; }
+
+  private:
+    iterator_base(container *vector, size_type index) noexcept : m_vector(vector), m_index(index) {}
+
+    container *m_vector{ nullptr };
+    size_type m_index{ 0 };
+  };
+
+  template<typename T, typename Alloc>
+  concurrent_vector<T, Alloc>::concurrent_vector(const allocator_type &alloc)
+    : allocator_holder(alloc) {
+  }
+
+  template<typename T, typename Alloc>
+  concurrent_vector<T, Alloc>::concurrent_vector(size_type n, const T &val, const allocator_type &alloc)
+    : allocator_holder(alloc) {
+    try {
+      grow_by(n, val);
+    }
+    catch (...) {
+      destroy_all();
+      release_segments(0);
+      throw;
+    }
+  }
+
+  template<typename T, typename Alloc>
+  concurrent_vector<T, Alloc>::concurrent_vector(::std::initializer_list<T> il, const allocator_type &alloc)
+    : allocator_holder(alloc) {
+    try {
+      grow_by(il);
+    }
+    catch (...) {
+      destroy_all();
+      release_segments(0);
+      throw;
+    }
+  }
+
+  template<typename T, typename Alloc>
+  concurrent_vector<T, Alloc>::concurrent_vector(const concurrent_vector &other)
+    : allocator_holder(other.get_allocator()) {
+    try {
+      grow_by(other.begin(), other.end());
+    }
+    catch (...) {
+      destroy_all();
+      release_segments(0);
+      throw;
+    }
+  }
+
+  template<typename T, typename Alloc>
+  concurrent_vector<T, Alloc>::concurrent_vector(concurrent_vector &&other) noexcept
+    : allocator_holder(other.get_allocator()) {
+    swap(other);
+  }
+
+  template<typename T, typename Alloc>
+  concurrent_vector<T, Alloc>::~concurrent_vector() {
+    destroy_all();
+    release_segments(0);
+  }
+
+  template<typename T, typename Alloc>
+  concurrent_vector<T, Alloc>& concurrent_vector<T, Alloc>::operator=(const concurrent_vector &other) {
+    if (this != &other) {
+      concurrent_vector copy{ other };
+      swap(copy);
+    }
+    return *this;
+  }
+
+  template<typename T, typename Alloc>
+  concurrent_vector<T, Alloc>& concurrent_vector<T, Alloc>::operator=(concurrent_vector &&other) noexcept {
+    if (this != &other) {
+      destroy_all();
+      release_segments(0);
+      swap(other);
+    }
+    return *this;
+  }
+
+  template<typename T, typename Alloc>
+  T* concurrent_vector<T, Alloc>::element(size_type index) const noexcept {
+    const size_type k{ segment_of(index) };
+    T *segment{ m_segments[k].load(::std::memory_order_acquire) };
+    assert(segment && "Element index is past the installed segments.");
+    return segment + (index - segment_base(k));
+  }
+
+  template<typename T, typename Alloc>
+  typename concurrent_vector<T, Alloc>::reference concurrent_vector<T, Alloc>::at(size_type n) noexcept {
+    assert(n < size());
+    return (*this)[n];
+  }
+
+  template<typename T, typename Alloc>
+  typename concurrent_vector<T, Alloc>::const_reference concurrent_vector<T, Alloc>::at(size_type n) const noexcept {
+    assert(n < size());
+    return (*this)[n];
+  }
+
+  template<typename T, typename Alloc>
+  void concurrent_vector<T, Alloc>::install_segments(size_type end) {
+    if (end == 0) return;
+    const size_type last{ segment_of(end - 1) };
+    for (size_type k{ 0 }; k <= last; ++k) {
+      if (m_segments[k].load(::std::memory_order_acquire)) continue;
+      T *segment{ allocator_ref().allocate(segment_size(k)) };
+      T *expected{ nullptr };
+      // Another thread may have installed the segment since the load above. Its allocation wins and ours is returned.
+      if (!m_segments[k].compare_exchange_strong(expected, segment, ::std::memory_order_acq_rel, ::std::memory_order_acquire)) {
+        allocator_ref().deallocate(segment, segment_size(k));
+      }
+    }
+  }
+
+  template<typename T, typename Alloc>
+  typename concurrent_vector<T, Alloc>::size_type concurrent_vector<T, Alloc>::reserve_indices(size_type n) {
+    // Install the segments before claiming the indices, so a failed allocation leaves the vector unchanged.
+    // Concurrent appends can push the claimed range past what was installed here, and covering that gap cannot be
+    // undone once the indices are claimed, so an allocation failure there terminates.
+    install_segments(m_size.load(::std::memory_order_relaxed) + n);
+    const size_type first{ m_size.fetch_add(n, ::std::memory_order_acq_rel) };
+    try {
+      install_segments(first + n);
+    }
+    catch (...) {
+      ::std::terminate();
+    }
+    return first;
+  }
+
+  template<typename T, typename Alloc>
+  template<typename Fill>
+  void concurrent_vector<T, Alloc>::construct_chunks(size_type first, size_type n, size_type &done, Fill &fill) {
+    while (done < n) {
+      const size_type index{ first + done };
+      const size_type k{ segment_of(index) };
+      const size_type offset{ index - segment_base(k) };
+      const size_type count{ ::std::min(n - done, segment_size(k) - offset) };
+      fill(m_segments[k].load(::std::memory_order_acquire) + offset, count);
+      done += count;
+    }
+  }
+
+  template<typename T, typename Alloc>
+  void concurrent_vector<T, Alloc>::value_construct_rest(size_type first, size_type n, ::std::true_type) noexcept {
+    for (size_type i{ 0 }; i < n; ++i) {
+      allocator_ref().construct(element(first + i));
+    }
+  }
+
+  template<typename T, typename Alloc>
+  template<bool Nothrow, typename Fill>
+  void concurrent_vector<T, Alloc>::construct_range(size_type first, size_type n, Fill fill) {
+    size_type done{ 0 };
+    if (Nothrow) {
+      construct_chunks(first, n, done, fill);
+      return;
+    }
+    try {
+      construct_chunks(first, n, done, fill);
+    }
+    catch (...) {
+      // The indices are already visible to other threads, so every one of them must hold an element.
+      static_assert(Nothrow || ::std::is_nothrow_default_constructible<T>::value,
+        "concurrent_vector needs a nothrow default constructor to fill a batch whose construction threw.");
+      value_construct_rest(first + done, n - done, ::std::is_nothrow_default_constructible<T>{});
+      throw;
+    }
+  }
+
+  template<typename T, typename Alloc>
+  template<typename... Args>
+  typename concurrent_vector<T, Alloc>::iterator concurrent_vector<T, Alloc>::emplace_back(Args&&... args) {
+    return emplace_back(::std::integral_constant<bool, ::std::is_nothrow_constructible<T, Args...>::value>{}, ::std::forward<Args>(args)...);
+  }
+
+  template<typename T, typename Alloc>
+  template<typename... Args>
+  typename concurrent_vector<T, Alloc>::iterator concurrent_vector<T, Alloc>::emplace_back(::std::true_type, Args&&... args) {
+    const size_type index{ reserve_indices(1) };
+    allocator_ref().construct(element(index), ::std::forward<Args>(args)...);
+    return iterator{ this, index };
+  }
+
+  template<typename T, typename Alloc>
+  template<typename... Args>
+  typename concurrent_vector<T, Alloc>::iterator concurrent_vector<T, Alloc>::emplace_back(::std::false_type, Args&&... args) {
+    static_assert(::std::is_nothrow_move_constructible<T>::value,
+      "concurrent_vector elements which may throw while being constructed must be nothrow move constructible.");
+    // Build the element before claiming an index, so a throwing constructor cannot leave a hole.
+    T temp(::std::forward<Args>(args)...);
+    const size_type index{ reserve_indices(1) };
+    allocator_ref().construct(element(index), ::std::move(temp));
+    return iterator{ this, index };
+  }
+
+  template<typename T, typename Alloc>
+  typename concurrent_vector<T, Alloc>::iterator concurrent_vector<T, Alloc>::grow_by(size_type n) {
+    const size_type first{ reserve_indices(n) };
+    construct_range<::std::is_nothrow_default_constructible<T>::value>(first, n, [this](T *dest, size_type count) {
+      detail::uninitialized_value_construct(allocator_ref(), dest, count);
+    });
+    return iterator{ this, first };
+  }
+
+  template<typename T, typename Alloc>
+  typename concurrent_vector<T, Alloc>::iterator concurrent_vector<T, Alloc>::grow_by(size_type n, const T &val) {
+    const size_type first{ reserve_indices(n) };
+    construct_range<::std::is_nothrow_copy_constructible<T>::value>(first, n, [this, &val](T *dest, size_type count) {
+      detail::uninitialized_fill(allocator_ref(), dest, count, val);
+    });
+    return iterator{ this, first };
+  }
+
+  template<typename T, typename Alloc>
+  template<typename ForwardIterator, typename>
+  typename concurrent_vector<T, Alloc>::iterator concurrent_vector<T, Alloc>::grow_by(ForwardIterator first, ForwardIterator last) {
+    const size_type n{ static_cast<size_type>(::std::distance(first, last)) };
+    const size_type index{ reserve_indices(n) };
+    constexpr bool nothrow{ ::std::is_nothrow_constructible<T, decltype(*first)>::value };
+    construct_range<nothrow>(index, n, [this, &first](T *dest, size_type count) {
+      ForwardIterator chunk_end{ ::std::next(first, static_cast<difference_type>(count)) };
+      detail::uninitialized_copy(allocator_ref(), first, chunk_end, dest);
+      first = chunk_end;
+    });
+    return iterator{ this, index };
+  }
+
+  template<typename T, typename Alloc>
+  typename concurrent_vector<T, Alloc>::iterator concurrent_vector<T, Alloc>::grow_to_at_least(size_type n) {
+    install_segments(n);
+    size_type current{ m_size.load(::std::memory_order_acquire) };
+    // Claim [current, n) only if nobody has grown past it in the meantime.
+    while (current < n && !m_size.compare_exchange_weak(current, n, ::std::memory_order_acq_rel, ::std::memory_order_acquire)) {}
+    if (current < n) {
+      construct_range<::std::is_nothrow_default_constructible<T>::value>(current, n - current, [this](T *dest, size_type count) {
+        detail::uninitialized_value_construct(allocator_ref(), dest, count);
+      });
+    }
+    return iterator{ this, n - 1 };
+  }
+
+  template<typename T, typename Alloc>
+  void concurrent_vector<T, Alloc>::clear() noexcept {
+    destroy_all();
+    m_size.store(0, ::std::memory_order_release);
+  }
+
+  template<typename T, typename Alloc>
+  void concurrent_vector<T, Alloc>::swap(concurrent_vector &other) noexcept {
+    using ::std::swap;
+    swap(allocator_ref(), other.allocator_ref());
+    for (size_type k{ 0 }; k < segment_count; ++k) {
+      T *mine{ m_segments[k].load(::std::memory_order_relaxed) };
+      m_segments[k].store(other.m_segments[k].load(::std::memory_order_relaxed), ::std::memory_order_relaxed);
+      other.m_segments[k].store(mine, ::std::memory_order_relaxed);
+    }
+    const size_type size{ m_size.load(::std::memory_order_relaxed) };
+    m_size.store(other.m_size.load(::std::memory_order_relaxed), ::std::memory_order_relaxed);
+    other.m_size.store(size, ::std::memory_order_relaxed);
+  }
+
+  template<typename T, typename Alloc>
+  typename concurrent_vector<T, Alloc>::size_type concurrent_vector<T, Alloc>::capacity() const noexcept {
+    size_type k{ 0 };
+    while (k < segment_count && m_segments[k].load(::std::memory_order_acquire)) ++k;
+    return segment_base(k);
+  }
+
+  template<typename T, typename Alloc>
+  void concurrent_vector<T, Alloc>::reserve(size_type elements) {
+    install_segments(elements);
+  }
+
+  template<typename T, typename Alloc>
+  void concurrent_vector<T, Alloc>::shrink_to_fit() {
+    const size_type used{ size() };
+    release_segments(used ? segment_of(used - 1) + 1 : 0);
+  }
+
+  template<typename T, typename Alloc>
+  void concurrent_vector<T, Alloc>::destroy_all() noexcept {
+    const size_type size{ m_size.load(::std::memory_order_relaxed) };
+    for (size_type k{ 0 }; k < segment_count && segment_base(k) < size; ++k) {
+      T *segment{ m_segments[k].load(::std::memory_order_relaxed) };
+      const size_type count{ ::std::min(segment_size(k), size - segment_base(k)) };
+      detail::destroy_range(allocator_ref(), segment, segment + count);
+    }
+    m_size.store(0, ::std::memory_order_relaxed);
+  }
+
+  template<typename T, typename Alloc>
+  void concurrent_vector<T, Alloc>::release_segments(size_type first_segment) noexcept {
+    for (size_type k{ first_segment }; k < segment_count; ++k) {
+      T *segment{ m_segments[k].exchange(nullptr, ::std::memory_order_relaxed) };
+      if (segment) {
+        allocator_ref().deallocate(segment, segment_size(k));
+      }
+    }
+  }
+
+} // namespace ftl
@@ -11,8 +11,8 @@ namespace ftl {
   struct has_begin {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::iterator{ std::declval<T>().begin() })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::iterator{ std::declval<const T>().begin() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::iterator{ std::declval<C>().begin() })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::const_iterator{ std::declval<const C>().begin() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -22,8 +22,8 @@ namespace ftl {
   struct has_end {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::iterator{ std::declval<T>().end() })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::iterator{ std::declval<const T>().end() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::iterator{ std::declval<C>().end() })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::const_iterator{ std::declval<const C>().end() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -33,8 +33,8 @@ namespace ftl {
   struct has_rbegin {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::reverse_iterator{ std::declval<T>().rbegin() })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::reverse_iterator{ std::declval<const T>().rbegin() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::reverse_iterator{ std::declval<C>().rbegin() })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::const_reverse_iterator{ std::declval<const C>().rbegin() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -44,8 +44,8 @@ namespace ftl {
   struct has_rend {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::reverse_iterator{ std::declval<T>().rend() })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::reverse_iterator{ std::declval<const T>().rend() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::reverse_iterator{ std::declval<C>().rend() })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::const_reverse_iterator{ std::declval<const C>().rend() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -55,8 +55,8 @@ namespace ftl {
   struct has_cbegin {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::const_iterator{ std::declval<T>().cbegin() })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::const_iterator{ std::declval<const T>().cbegin() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::const_iterator{ std::declval<C>().cbegin() })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::const_iterator{ std::declval<const C>().cbegin() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -66,8 +66,8 @@ namespace ftl {
   struct has_cend {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::const_iterator{ std::declval<T>().cend() })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::const_iterator{ std::declval<const T>().cend() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::const_iterator{ std::declval<C>().cend() })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::const_iterator{ std::declval<const C>().cend() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -77,8 +77,8 @@ namespace ftl {
   struct has_crbegin {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::const_reverse_iterator{ std::declval<T>().crbegin() })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::const_reverse_iterator{ std::declval<const T>().crbegin() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::const_reverse_iterator{ std::declval<C>().crbegin() })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::const_reverse_iterator{ std::declval<const C>().crbegin() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -88,8 +88,8 @@ namespace ftl {
   struct has_crend {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::const_reverse_iterator{ std::declval<T>().crend() })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::const_reverse_iterator{ std::declval<const T>().crend() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::const_reverse_iterator{ std::declval<C>().crend() })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::const_reverse_iterator{ std::declval<const C>().crend() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -100,8 +100,8 @@ namespace ftl {
   struct has_size {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::size_type{ std::declval<T>().size() })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::size_type{ std::declval<const T>().size() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::size_type{ std::declval<C>().size() })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::size_type{ std::declval<const C>().size() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -111,8 +111,8 @@ namespace ftl {
   struct has_max_size {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::size_type{ std::declval<T>().max_size() })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::size_type{ std::declval<const T>().max_size() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::size_type{ std::declval<C>().max_size() })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::size_type{ std::declval<const C>().max_size() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -122,8 +122,8 @@ namespace ftl {
   struct has_capacity {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::size_type{ std::declval<T>().capacity() })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::size_type{ std::declval<const T>().capacity() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::size_type{ std::declval<C>().capacity() })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::size_type{ std::declval<const C>().capacity() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -133,7 +133,7 @@ namespace ftl {
   struct has_resize {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(std::declval<T>().resize(std::declval<typename T::size_type>()))>;
+    template<typename C> static auto test(int)->check<decltype(std::declval<C>().resize(std::declval<typename C::size_type>()))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -144,7 +144,7 @@ namespace ftl {
   private:
     template<typename> struct check : std::true_type {};
     template<typename C> static auto test(int)
-      ->check<decltype(std::declval<C>().resize(std::declval<typename T::size_type>(), std::declval<typename T::value_type>()))>;
+      ->check<decltype(std::declval<C>().resize(std::declval<typename C::size_type>(), std::declval<typename C::value_type>()))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -154,8 +154,8 @@ namespace ftl {
   struct has_empty {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(bool{ std::declval<T>().empty() })>;
-    template<typename C> static auto test(void*)->check<decltype(bool{ std::declval<const T>().empty() })>;
+    template<typename C> static auto test(int)->check<decltype(bool{ std::declval<C>().empty() })>;
+    template<typename C> static auto test(void*)->check<decltype(bool{ std::declval<const C>().empty() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -165,8 +165,8 @@ namespace ftl {
   struct has_reserve {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(std::declval<C>().reserve(std::declval<typename T::size_type>()))>;
-    template<typename C> static auto test(void*)->check<decltype(std::declval<const C>().reserve(std::declval<typename T::size_type>()))>;
+    template<typename C> static auto test(int)->check<decltype(std::declval<C>().reserve(std::declval<typename C::size_type>()))>;
+    template<typename C> static auto test(void*)->check<decltype(std::declval<const C>().reserve(std::declval<typename C::size_type>()))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -188,8 +188,8 @@ namespace ftl {
   struct has_index_operator {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::reference{ std::declval<T>()[std::declval<typename T::size_type>()] })>;
-    //template<typename C> static auto test(void*)->check<decltype(typename T::const_reference{ std::declval<const T>()[std::declval<typename T::size_type>()] })>;
+    template<typename C> static auto test(int)->check<decltype(static_cast<typename C::reference>(std::declval<C>()[std::declval<typename C::size_type>()]))>;
+    //template<typename C> static auto test(void*)->check<decltype(static_cast<typename C::const_reference>(std::declval<const C>()[std::declval<typename C::size_type>()]))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -209,7 +209,7 @@ namespace ftl {
       using type = typename C::mapped_type;
     };
     template<typename C = T> static auto test(int)->check< std::enable_if_t<has_mapped_type<C>::value, void> >;
-    //template<typename C> static auto test(void*)->check<decltype(typename T::mapped_type{ std::declval<const T>()[std::declval<const typename T::key_type>()] })>;
+    //template<typename C> static auto test(void*)->check<decltype(typename C::mapped_type{ std::declval<const C>()[std::declval<const typename C::key_type>()] })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -219,8 +219,8 @@ namespace ftl {
   struct has_at {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::reference{ std::declval<T>().at(std::declval<typename T::size_type>()) })>;
-    //template<typename C> static auto test(void*)->check<decltype(typename T::const_reference{ std::declval<const T>().at(std::declval<typename T::size_type>()) })>;
+    template<typename C> static auto test(int)->check<decltype(static_cast<typename C::reference>(std::declval<C>().at(std::declval<typename C::size_type>())))>;
+    //template<typename C> static auto test(void*)->check<decltype(static_cast<typename C::const_reference>(std::declval<const C>().at(std::declval<typename C::size_type>())))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -230,8 +230,8 @@ namespace ftl {
   struct has_front {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::reference{ std::declval<T>().front() })>;
-    //template<typename C> static auto test(void*)->check<decltype(typename T::const_reference{ std::declval<const T>().front() })>;
+    template<typename C> static auto test(int)->check<decltype(static_cast<typename C::reference>(std::declval<C>().front()))>;
+    //template<typename C> static auto test(void*)->check<decltype(static_cast<typename C::const_reference>(std::declval<const C>().front()))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -241,8 +241,8 @@ namespace ftl {
   struct has_back {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::reference{ std::declval<T>().back() })>;
-    //template<typename C> static auto test(void*)->check<decltype(typename T::const_reference{ std::declval<const T>().back() })>;
+    template<typename C> static auto test(int)->check<decltype(static_cast<typename C::reference>(std::declval<C>().back()))>;
+    //template<typename C> static auto test(void*)->check<decltype(static_cast<typename C::const_reference>(std::declval<const C>().back()))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -252,7 +252,7 @@ namespace ftl {
   struct has_clear {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(std::declval<T>().clear())>;
+    template<typename C> static auto test(int)->check<decltype(std::declval<C>().clear())>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -262,7 +262,7 @@ namespace ftl {
   struct has_data {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::pointer{ std::declval<C>().data() })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::pointer{ std::declval<C>().data() })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -272,7 +272,7 @@ namespace ftl {
   struct has_assign_range {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(std::declval<C>().assign(std::declval<typename T::iterator>(), std::declval<typename T::iterator>()))>;
+    template<typename C> static auto test(int)->check<decltype(std::declval<C>().assign(std::declval<typename C::iterator>(), std::declval<typename C::iterator>()))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -282,7 +282,7 @@ namespace ftl {
   struct has_assign_fill {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(std::declval<C>().assign(typename T::size_type{}, std::declval<typename T::value_type>()))>;
+    template<typename C> static auto test(int)->check<decltype(std::declval<C>().assign(typename C::size_type{}, std::declval<typename C::value_type>()))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -292,7 +292,7 @@ namespace ftl {
   struct has_assign_il {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(std::declval<C>().assign(std::declval<std::initializer_list<typename T::value_type>>()))>;
+    template<typename C> static auto test(int)->check<decltype(std::declval<C>().assign(std::declval<std::initializer_list<typename C::value_type>>()))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -302,8 +302,8 @@ namespace ftl {
   struct has_push_back {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(std::declval<C>().push_back(std::declval<const typename T::value_type&>()))>;
-    template<typename C> static auto test(void *)->check<decltype(std::declval<C>().push_back(std::move(std::declval<typename T::value_type>())))>;
+    template<typename C> static auto test(int)->check<decltype(std::declval<C>().push_back(std::declval<const typename C::value_type&>()))>;
+    template<typename C> static auto test(void *)->check<decltype(std::declval<C>().push_back(std::move(std::declval<typename C::value_type>())))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -323,8 +323,8 @@ namespace ftl {
   struct has_insert {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::iterator{ std::declval<C>().insert(std::declval<typename T::const_iterator>(), std::declval<const typename T::value_type&>()) })>;
-    template<typename C> static auto test(void*)->check<decltype(typename T::iterator{ std::declval<C>().insert(std::declval<typename T::const_iterator>(), std::declval<typename T::value_type&&>()) })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::iterator{ std::declval<C>().insert(std::declval<typename C::const_iterator>(), std::declval<const typename C::value_type&>()) })>;
+    template<typename C> static auto test(void*)->check<decltype(typename C::iterator{ std::declval<C>().insert(std::declval<typename C::const_iterator>(), std::declval<typename C::value_type&&>()) })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -334,7 +334,7 @@ namespace ftl {
   struct has_insert_n {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::iterator{ std::declval<C>().insert(std::declval<typename T::const_iterator>(), std::declval<typename T::size_type>(), std::declval<const typename T::value_type&>()) })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::iterator{ std::declval<C>().insert(std::declval<typename C::const_iterator>(), std::declval<typename C::size_type>(), std::declval<const typename C::value_type&>()) })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -344,7 +344,7 @@ namespace ftl {
   struct has_insert_range {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::iterator{ std::declval<C>().insert(std::declval<typename T::const_iterator>(), std::declval<typename T::iterator>(), std::declval<typename T::iterator>()) })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::iterator{ std::declval<C>().insert(std::declval<typename C::const_iterator>(), std::declval<typename C::iterator>(), std::declval<typename C::iterator>()) })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -354,7 +354,7 @@ namespace ftl {
   struct has_insert_il {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::iterator{ std::declval<C>().insert(std::declval<typename T::const_iterator>(), std::initializer_list<typename T::value_type>()) })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::iterator{ std::declval<C>().insert(std::declval<typename C::const_iterator>(), std::initializer_list<typename C::value_type>()) })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -364,7 +364,7 @@ namespace ftl {
   struct has_erase {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::iterator{ std::declval<C>().erase(std::declval<typename T::iterator>()) })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::iterator{ std::declval<C>().erase(std::declval<typename C::iterator>()) })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -374,7 +374,7 @@ namespace ftl {
   struct has_erase_range {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(typename T::iterator{ std::declval<C>().erase(std::declval<typename T::iterator>(), std::declval<typename T::iterator>()) })>;
+    template<typename C> static auto test(int)->check<decltype(typename C::iterator{ std::declval<C>().erase(std::declval<typename C::iterator>(), std::declval<typename C::iterator>()) })>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
@@ -389,7 +389,7 @@ namespace ftl {
     template<typename> struct check : std::true_type {};
     template<typename C> static auto test(int)
       ->check<decltype(typename T::iterator{
-      std::declval<C>().emplace(std::declval<typename T::iterator>()
+      std::declval<C>().emplace(std::declval<typename C::iterator>()
       , std::declval<anonymous_1&&>()
         , std::declval<anonymous_2&&>()
         , std::declval<anonymous_3&&>())
@@ -408,7 +408,7 @@ namespace ftl {
     template<typename> struct check : std::true_type {};
     template<typename C> static auto test(int)
       ->check<decltype(typename T::iterator{
-      std::declval<C>().emplace_back(std::declval<typename T::iterator>()
+      std::declval<C>().emplace_back(std::declval<typename C::iterator>()
       , std::declval<anonymous_1&&>()
         , std::declval<anonymous_2&&>()
         , std::declval<anonymous_3&&>())
@@ -423,7 +423,7 @@ namespace ftl {
   struct has_swap {
   private:
     template<typename> struct check : std::true_type {};
-    template<typename C> static auto test(int)->check<decltype(std::declval<C>().swap(std::declval<T>()))>;
+    template<typename C> static auto test(int)->check<decltype(std::declval<C>().swap(std::declval<C>()))>;
     template<class> static auto test(long)->std::false_type;
     template<typename C> struct verify : decltype(test<C>(0)){};
   public:
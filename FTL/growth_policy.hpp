@@ -0,0 +1,83 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <type_traits> // enable_if
+
+namespace ftl {
+
+  // Growth policy interface:
+  // A growth policy decides how much capacity a vector asks for when it runs out of room.
+  // It must provide the following static member function, which returns a capacity of at least `required` elements:
+  //   static std::size_t next_capacity(std::size_t current, std::size_t required, std::size_t element_size) noexcept;
+  // `current` is the capacity being outgrown and `element_size` is sizeof(value_type).
+  // A policy may also opt in to shrinking by providing the members of auto_shrink below.
+
+  // Multiplies the capacity by Num / Den on every growth, starting from Initial elements.
+  template<std::size_t Num, std::size_t Den, std::size_t Initial = 10>
+  struct geometric_growth {
+    static_assert(Num > Den, "A geometric growth policy must increase the capacity.");
+    static std::size_t next_capacity(std::size_t current, std::size_t required, std::size_t) noexcept {
+      std::size_t grown{ current ? (current / Den) * Num + ((current % Den) * Num) / Den : Initial };
+      // Tiny capacities can round down to no growth at all with fractional factors.
+      if (grown <= current) grown = current + 1;
+      return grown < required ? required : grown;
+    }
+  };
+
+  // 10 elements, then double. Few reallocations, but up to half of a large buffer may be unused.
+  using doubling_growth = geometric_growth<2, 1>;
+  // Grows by 1.5x. Wastes at most a third of the buffer, and freed blocks can eventually be reused by later growth.
+  using three_halves_growth = geometric_growth<3, 2>;
+
+  // Grows by 1.5x, then rounds the request up to the size the system allocator would hand out anyway:
+  // a malloc style size class for small blocks, or a whole number of pages for large ones.
+  // The slack a general purpose allocator keeps at the end of a block becomes usable capacity instead.
+  template<std::size_t PageSize = 4096, std::size_t MinBytes = 64>
+  struct size_class_growth {
+    static std::size_t round_to_size_class(std::size_t bytes) noexcept {
+      if (bytes <= MinBytes) return MinBytes;
+      if (bytes >= PageSize) return (bytes + PageSize - 1) / PageSize * PageSize;
+      // Four classes per power of two, like jemalloc and tcmalloc use for their small bins.
+      std::size_t power{ MinBytes };
+      while (power < bytes) power <<= 1;
+      const std::size_t spacing{ power / 8 };
+      return (bytes + spacing - 1) / spacing * spacing;
+    }
+    static std::size_t next_capacity(std::size_t current, std::size_t required, std::size_t element_size) noexcept {
+      std::size_t target{ three_halves_growth::next_capacity(current, required, element_size) };
+      const std::size_t rounded{ round_to_size_class(target * element_size) / element_size };
+      return rounded > target ? rounded : target;
+    }
+  };
+
+  using default_growth = doubling_growth;
+
+  // Wraps a growth policy to also give memory back as a vector empties out.
+  // Once fewer than Num / Den of the capacity is in use after an erase or pop_back, the vector reallocates to the
+  // capacity one growth step from its size would produce. The gap between the shrink threshold and the new capacity
+  // is the hysteresis that keeps a vector oscillating around one size from reallocating on every push/pop.
+  // Capacities of MinCapacity elements or fewer are never trimmed.
+  // Shrinking reallocates, so with this policy erase and pop_back invalidate every iterator.
+  template<typename Growth = default_growth, std::size_t Num = 1, std::size_t Den = 4, std::size_t MinCapacity = 16>
+  struct auto_shrink : Growth {
+    static_assert(Num < Den, "The shrink threshold must be a fraction of the capacity.");
+    static constexpr bool shrinks{ true };
+    static bool should_shrink(std::size_t size, std::size_t capacity) noexcept {
+      return capacity > MinCapacity && size * Den < capacity * Num;
+    }
+    static std::size_t shrunk_capacity(std::size_t size, std::size_t element_size) noexcept {
+      const std::size_t target{ Growth::next_capacity(size, size, element_size) };
+      return target < MinCapacity ? MinCapacity : target;
+    }
+  };
+
+  namespace detail {
+    template<typename Growth, typename = void>
+    struct is_auto_shrinking : std::false_type {};
+    template<typename Growth>
+    struct is_auto_shrinking<Growth, typename std::enable_if<Growth::shrinks>::type> : std::true_type {};
+  } // namespace detail
+
+} // namespace ftl
@@ -0,0 +1,541 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "mmap_allocator.hpp" // FTL_HAS_MMAP, detail::page_size
+
+#include <algorithm> // copy_backward, copy, fill_n, max
+#include <cassert> // assert
+#include <cerrno> // errno
+#include <cstddef> // size_t, ptrdiff_t
+#include <cstdint> // uint32_t, uint64_t
+#include <cstring> // memcmp, memcpy
+#include <initializer_list> // initializer_list
+#include <iterator> // reverse_iterator, iterator_traits, distance
+#include <stdexcept> // runtime_error
+#include <system_error> // system_error, generic_category
+#include <type_traits> // is_trivially_copyable
+#include <utility> // forward, swap
+
+#if FTL_HAS_MMAP
+#include <fcntl.h> // open
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close, ftruncate
+
+namespace ftl {
+
+  namespace detail {
+    // The file header of a mapped_vector. The elements start at data_offset, which is a multiple of 64.
+    struct mapped_vector_header {
+      char magic[8];
+      ::std::uint32_t version;
+      ::std::uint32_t byte_order;
+      ::std::uint32_t type_size;
+      ::std::uint32_t type_alignment;
+      ::std::uint64_t data_offset;
+      ::std::uint64_t count;
+    };
+
+    constexpr char mapped_vector_magic[8]{ 'F', 'T', 'L', 'M', 'V', 'E', 'C', 0 };
+    constexpr ::std::uint32_t mapped_vector_version{ 1 };
+    // Reads back as a different value on a machine of the other byte order.
+    constexpr ::std::uint32_t mapped_vector_byte_order{ 0x01020304 };
+
+    [[noreturn]] inline void throw_file_error(const char *what) {
+      throw ::std::system_error{ errno, ::std::generic_category(), what };
+    }
+  } // namespace detail
+
+  // How a mapped_vector opens its file.
+  enum class map_mode {
+    // The file must exist. Its pages are shared with every other process mapping it, and nothing is copied or
+    // parsed on open, so opening is instant however large the file is. The contents must not be modified.
+    read_only,
+    // The file is created if it doesn't exist. Changes are written back to it by the kernel, or by flush.
+    read_write
+  };
+
+  // The expected access pattern for mapped_vector::advise.
+  enum class access_pattern { normal, sequential, random, will_need, dont_need };
+
+  // mapped_vector presents the ftl::vector interface over a memory-mapped file, so a table built once can be
+  // opened again without parsing or copying it. T must be trivially copyable, since the elements are stored as they
+  // are in memory; the file can only be read back by a build with the same T layout and byte order, which the header
+  // records along with the element count.
+  // The file holds the header, then the elements, then spare capacity. Growing extends the file with ftruncate and
+  // remaps it, so growth invalidates pointers and iterators like ftl::vector does; close trims the spare capacity.
+  // Errors from the system calls are thrown as std::system_error, and files which don't match T as std::runtime_error.
+  template<typename T>
+  class mapped_vector {
+    static_assert(::std::is_trivially_copyable<T>::value, "mapped_vector stores its elements in a file as they are in memory.");
+  public:
+    using value_type = T;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using reference = T&;
+    using const_reference = const T&;
+    using size_type = ::std::size_t;
+    using difference_type = ::std::ptrdiff_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = ::std::reverse_iterator<iterator>;
+    using const_reverse_iterator = ::std::reverse_iterator<const_iterator>;
+
+    mapped_vector() noexcept = default;
+    explicit mapped_vector(const char *path, map_mode mode = map_mode::read_write);
+    mapped_vector(const mapped_vector &) = delete;
+    mapped_vector(mapped_vector &&other) noexcept;
+    ~mapped_vector();
+
+    mapped_vector& operator=(const mapped_vector &) = delete;
+    mapped_vector& operator=(mapped_vector &&other) noexcept;
+
+    void open(const char *path, map_mode mode = map_mode::read_write);
+    // Unmaps the file, trimming it to the elements in read_write mode. The vector is left closed and empty.
+    void close() noexcept;
+    bool is_open() const noexcept { return m_map != nullptr; }
+    bool read_only() const noexcept { return m_mode == map_mode::read_only; }
+
+    // Writes dirty pages back to the file; synchronously unless async is set.
+    void flush(bool async = false);
+    // Tells the kernel how the elements will be accessed, to tune read-ahead and page reclaim.
+    void advise(access_pattern pattern) noexcept;
+
+    iterator begin() noexcept { return data(); }
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator cbegin() const noexcept { return data(); }
+    iterator end() noexcept { return data() + size(); }
+    const_iterator end() const noexcept { return data() + size(); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator{ end() }; }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator{ end() }; }
+    reverse_iterator rend() noexcept { return reverse_iterator{ begin() }; }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator{ begin() }; }
+
+    reference operator[](size_type n) noexcept { return data()[n]; }
+    const_reference operator[](size_type n) const noexcept { return data()[n]; }
+    reference at(size_type n) noexcept;
+    const_reference at(size_type n) const noexcept;
+    reference front() noexcept { return *begin(); }
+    const_reference front() const noexcept { return *begin(); }
+    reference back() noexcept { return *(end() - 1); }
+    const_reference back() const noexcept { return *(end() - 1); }
+    pointer data() noexcept { return m_data; }
+    const_pointer data() const noexcept { return m_data; }
+
+    bool empty() const noexcept { return size() == 0; }
+    size_type size() const noexcept { return m_map ? static_cast<size_type>(header().count) : 0; }
+    size_type capacity() const noexcept { return m_capacity; }
+    size_type max_size() const noexcept { return (::std::size_t(-1) - data_offset) / sizeof(T); }
+
+    void assign(size_type n, const T &val);
+    template<typename InputIterator, typename = decltype(*::std::declval<InputIterator&>(), void(), ++::std::declval<InputIterator&>(), void())>
+    void assign(InputIterator first, InputIterator last);
+    void assign(::std::initializer_list<T> il);
+
+    void push_back(const T &val);
+    template<typename... Args>
+    reference emplace_back(Args&&... args);
+    void pop_back() noexcept;
+    template<typename... Args>
+    iterator emplace(const_iterator position, Args&&... args);
+    iterator insert(const_iterator position, const T &val);
+    iterator insert(const_iterator position, size_type n, const T &val);
+    template<typename InputIterator, typename = decltype(*::std::declval<InputIterator&>(), void(), ++::std::declval<InputIterator&>(), void())>
+    iterator insert(const_iterator position, InputIterator first, InputIterator last);
+    iterator insert(const_iterator position, ::std::initializer_list<T> il);
+    iterator erase(const_iterator position) noexcept;
+    iterator erase(const_iterator first, const_iterator last) noexcept;
+    void clear() noexcept;
+    void resize(size_type elements);
+    void resize(size_type elements, const T &val);
+    void reserve(size_type elements);
+    void shrink_to_fit();
+    void swap(mapped_vector &other) noexcept;
+
+  private:
+    using header_type = detail::mapped_vector_header;
+    static constexpr size_type data_offset{ alignof(T) > 64 ? alignof(T) : 64 };
+    static_assert(sizeof(header_type) <= 64, "The mapped_vector header must fit before the elements.");
+
+    header_type& header() noexcept { return *static_cast<header_type*>(m_map); }
+    const header_type& header() const noexcept { return *static_cast<const header_type*>(m_map); }
+    void set_size(size_type elements) noexcept { header().count = elements; }
+    // Resizes the file to hold capacity elements and maps it again.
+    void remap(size_type capacity);
+    void grow(size_type required);
+    void check_header(size_type file_bytes) const;
+    // Opens a gap of n elements at index, growing if needed, and returns a pointer to it.
+    pointer open_gap(size_type index, size_type n);
+    template<typename InputIterator>
+    iterator insert_range(size_type index, InputIterator first, InputIterator last, ::std::input_iterator_tag);
+    template<typename ForwardIterator>
+    iterator insert_range(size_type index, ForwardIterator first, ForwardIterator last, ::std::forward_iterator_tag);
+
+    int m_fd{ -1 };
+    map_mode m_mode{ map_mode::read_write };
+    void *m_map{ nullptr };
+    size_type m_map_bytes{ 0 };
+    pointer m_data{ nullptr };
+    size_type m_capacity{ 0 };
+  };
+
+  template<typename T>
+  mapped_vector<T>::mapped_vector(const char *path, map_mode mode) {
+    open(path, mode);
+  }
+
+  template<typename T>
+  mapped_vector<T>::mapped_vector(mapped_vector &&other) noexcept {
+    swap(other);
+  }
+
+  template<typename T>
+  mapped_vector<T>::~mapped_vector() {
+    close();
+  }
+
+  template<typename T>
+  mapped_vector<T>& mapped_vector<T>::operator=(mapped_vector &&other) noexcept {
+    if (this != &other) {
+      close();
+      swap(other);
+    }
+    return *this;
+  }
+
+  template<typename T>
+  void mapped_vector<T>::open(const char *path, map_mode mode) {
+    close();
+    const bool writable{ mode == map_mode::read_write };
+    const int fd{ ::open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644) };
+    if (fd < 0) detail::throw_file_error("mapped_vector: cannot open file");
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+      const int error{ errno };
+      ::close(fd);
+      errno = error;
+      detail::throw_file_error("mapped_vector: cannot stat file");
+    }
+    size_type file_bytes{ static_cast<size_type>(info.st_size) };
+    m_fd = fd;
+    m_mode = mode;
+    try {
+      if (file_bytes == 0 && writable) {
+        remap(0);
+        header_type &h = header();
+        ::std::memcpy(h.magic, detail::mapped_vector_magic, sizeof(h.magic));
+        h.version = detail::mapped_vector_version;
+        h.byte_order = detail::mapped_vector_byte_order;
+        h.type_size = static_cast<::std::uint32_t>(sizeof(T));
+        h.type_alignment = static_cast<::std::uint32_t>(alignof(T));
+        h.data_offset = data_offset;
+        h.count = 0;
+        return;
+      }
+      if (file_bytes < data_offset) throw ::std::runtime_error{ "mapped_vector: the file is too small to hold a header" };
+      void *map{ ::mmap(nullptr, file_bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0) };
+      if (map == MAP_FAILED) detail::throw_file_error("mapped_vector: cannot map file");
+      m_map = map;
+      m_map_bytes = file_bytes;
+      check_header(file_bytes);
+      m_data = reinterpret_cast<pointer>(static_cast<char*>(m_map) + data_offset);
+      m_capacity = (file_bytes - data_offset) / sizeof(T);
+    }
+    catch (...) {
+      // Closing would trim the file to a header which was never validated.
+      if (m_map) ::munmap(m_map, m_map_bytes);
+      ::close(m_fd);
+      m_fd = -1;
+      m_map = nullptr;
+      m_map_bytes = 0;
+      m_data = nullptr;
+      m_capacity = 0;
+      throw;
+    }
+  }
+
+  template<typename T>
+  void mapped_vector<T>::check_header(size_type file_bytes) const {
+    const header_type &h = header();
+    if (::std::memcmp(h.magic, detail::mapped_vector_magic, sizeof(h.magic)) != 0) {
+      throw ::std::runtime_error{ "mapped_vector: the file is not a mapped_vector" };
+    }
+    if (h.version != detail::mapped_vector_version) throw ::std::runtime_error{ "mapped_vector: unsupported file version" };
+    if (h.byte_order != detail::mapped_vector_byte_order) throw ::std::runtime_error{ "mapped_vector: the file has the wrong byte order" };
+    if (h.type_size != sizeof(T) || h.type_alignment != alignof(T) || h.data_offset != data_offset) {
+      throw ::std::runtime_error{ "mapped_vector: the file holds a different element type" };
+    }
+    if (h.count > (file_bytes - data_offset) / sizeof(T)) throw ::std::runtime_error{ "mapped_vector: the file is truncated" };
+  }
+
+  template<typename T>
+  void mapped_vector<T>::close() noexcept {
+    if (!m_map) return;
+    const size_type bytes{ data_offset + size() * sizeof(T) };
+    ::munmap(m_map, m_map_bytes);
+    if (!read_only() && bytes != m_map_bytes) {
+      (void)::ftruncate(m_fd, static_cast<off_t>(bytes));
+    }
+    ::close(m_fd);
+    m_fd = -1;
+    m_map = nullptr;
+    m_map_bytes = 0;
+    m_data = nullptr;
+    m_capacity = 0;
+  }
+
+  template<typename T>
+  void mapped_vector<T>::flush(bool async) {
+    if (!m_map || read_only()) return;
+    if (::msync(m_map, m_map_bytes, async ? MS_ASYNC : MS_SYNC) != 0) detail::throw_file_error("mapped_vector: cannot flush file");
+  }
+
+  template<typename T>
+  void mapped_vector<T>::advise(access_pattern pattern) noexcept {
+    if (!m_map) return;
+    int advice{ MADV_NORMAL };
+    switch (pattern) {
+    case access_pattern::normal: advice = MADV_NORMAL; break;
+    case access_pattern::sequential: advice = MADV_SEQUENTIAL; break;
+    case access_pattern::random: advice = MADV_RANDOM; break;
+    case access_pattern::will_need: advice = MADV_WILLNEED; break;
+    case access_pattern::dont_need: advice = MADV_DONTNEED; break;
+    }
+    // Only a hint, so failures are ignored.
+    (void)::madvise(m_map, m_map_bytes, advice);
+  }
+
+  template<typename T>
+  void mapped_vector<T>::remap(size_type capacity) {
+    assert(!read_only());
+    const size_type bytes{ data_offset + capacity * sizeof(T) };
+    if (::ftruncate(m_fd, static_cast<off_t>(bytes)) != 0) detail::throw_file_error("mapped_vector: cannot resize file");
+    void *map;
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+    if (m_map) {
+      map = ::mremap(m_map, m_map_bytes, bytes, MREMAP_MAYMOVE);
+    }
+    else {
+      map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    }
+#else
+    // The old mapping stays valid until the new one exists; both see the same file pages.
+    map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (map != MAP_FAILED && m_map) ::munmap(m_map, m_map_bytes);
+#endif
+    if (map == MAP_FAILED) {
+      const int error{ errno };
+      // Restore the old length so the mapping still covers the whole file.
+      if (m_map) (void)::ftruncate(m_fd, static_cast<off_t>(m_map_bytes));
+      errno = error;
+      detail::throw_file_error("mapped_vector: cannot map file");
+    }
+    m_map = map;
+    m_map_bytes = bytes;
+    m_data = reinterpret_cast<pointer>(static_cast<char*>(m_map) + data_offset);
+    m_capacity = capacity;
+  }
+
+  template<typename T>
+  void mapped_vector<T>::grow(size_type required) {
+    // Grow geometrically, and by at least a page, so appends amortize the ftruncate and remap.
+    const size_type page_elements{ ::std::max<size_type>(detail::page_size() / sizeof(T), 1) };
+    reserve(::std::max(::std::max(required, m_capacity + m_capacity / 2), m_capacity + page_elements));
+  }
+
+  template<typename T>
+  typename mapped_vector<T>::reference mapped_vector<T>::at(size_type n) noexcept {
+    assert(n < size());
+    return (*this)[n];
+  }
+
+  template<typename T>
+  typename mapped_vector<T>::const_reference mapped_vector<T>::at(size_type n) const noexcept {
+    assert(n < size());
+    return (*this)[n];
+  }
+
+  template<typename T>
+  void mapped_vector<T>::assign(size_type n, const T &val) {
+    assert(is_open() && !read_only());
+    // resize copies val before growing, so it may be one of the elements.
+    set_size(0);
+    resize(n, val);
+  }
+
+  template<typename T>
+  template<typename InputIterator, typename>
+  void mapped_vector<T>::assign(InputIterator first, InputIterator last) {
+    assert(is_open() && !read_only());
+    // Inserting into an empty vector shifts nothing, so this writes each element once.
+    set_size(0);
+    insert_range(0, first, last, typename ::std::iterator_traits<InputIterator>::iterator_category{});
+  }
+
+  template<typename T>
+  void mapped_vector<T>::assign(::std::initializer_list<T> il) {
+    assign(il.begin(), il.end());
+  }
+
+  template<typename T>
+  void mapped_vector<T>::push_back(const T &val) {
+    emplace_back(val);
+  }
+
+  template<typename T>
+  template<typename... Args>
+  typename mapped_vector<T>::reference mapped_vector<T>::emplace_back(Args&&... args) {
+    assert(is_open() && !read_only());
+    // Built first, since growing may unmap an element the arguments refer to.
+    const T val(::std::forward<Args>(args)...);
+    const size_type count{ size() };
+    if (count == m_capacity) grow(count + 1);
+    m_data[count] = val;
+    set_size(count + 1);
+    return m_data[count];
+  }
+
+  template<typename T>
+  void mapped_vector<T>::pop_back() noexcept {
+    assert(!empty() && !read_only());
+    set_size(size() - 1);
+  }
+
+  template<typename T>
+  typename mapped_vector<T>::pointer mapped_vector<T>::open_gap(size_type index, size_type n) {
+    assert(is_open() && !read_only() && index <= size());
+    const size_type count{ size() };
+    if (n > m_capacity - count) grow(count + n);
+    ::std::copy_backward(m_data + index, m_data + count, m_data + count + n);
+    set_size(count + n);
+    return m_data + index;
+  }
+
+  template<typename T>
+  template<typename... Args>
+  typename mapped_vector<T>::iterator mapped_vector<T>::emplace(const_iterator position, Args&&... args) {
+    // Built first, like emplace_back, since opening the gap may move an element the arguments refer to.
+    const T val(::std::forward<Args>(args)...);
+    pointer gap{ open_gap(static_cast<size_type>(position - m_data), 1) };
+    *gap = val;
+    return gap;
+  }
+
+  template<typename T>
+  typename mapped_vector<T>::iterator mapped_vector<T>::insert(const_iterator position, const T &val) {
+    return insert(position, 1, val);
+  }
+
+  template<typename T>
+  typename mapped_vector<T>::iterator mapped_vector<T>::insert(const_iterator position, size_type n, const T &val) {
+    const T copy(val);
+    pointer gap{ open_gap(static_cast<size_type>(position - m_data), n) };
+    ::std::fill_n(gap, n, copy);
+    return gap;
+  }
+
+  template<typename T>
+  template<typename InputIterator, typename>
+  typename mapped_vector<T>::iterator mapped_vector<T>::insert(const_iterator position, InputIterator first, InputIterator last) {
+    return insert_range(static_cast<size_type>(position - m_data), first, last, typename ::std::iterator_traits<InputIterator>::iterator_category{});
+  }
+
+  template<typename T>
+  template<typename InputIterator>
+  typename mapped_vector<T>::iterator mapped_vector<T>::insert_range(size_type index, InputIterator first, InputIterator last, ::std::input_iterator_tag) {
+    const size_type start{ index };
+    // Input iterators can only be walked once, so the elements go in one at a time.
+    for (; first != last; ++first, ++index) {
+      const T val(*first);
+      *open_gap(index, 1) = val;
+    }
+    return m_data + start;
+  }
+
+  template<typename T>
+  template<typename ForwardIterator>
+  typename mapped_vector<T>::iterator mapped_vector<T>::insert_range(size_type index, ForwardIterator first, ForwardIterator last, ::std::forward_iterator_tag) {
+    // The range is measured first, so the tail is shifted once for all of it.
+    pointer gap{ open_gap(index, static_cast<size_type>(::std::distance(first, last))) };
+    ::std::copy(first, last, gap);
+    return gap;
+  }
+
+  template<typename T>
+  typename mapped_vector<T>::iterator mapped_vector<T>::insert(const_iterator position, ::std::initializer_list<T> il) {
+    pointer gap{ open_gap(static_cast<size_type>(position - m_data), il.size()) };
+    ::std::copy(il.begin(), il.end(), gap);
+    return gap;
+  }
+
+  template<typename T>
+  typename mapped_vector<T>::iterator mapped_vector<T>::erase(const_iterator position) noexcept {
+    return erase(position, position + 1);
+  }
+
+  template<typename T>
+  typename mapped_vector<T>::iterator mapped_vector<T>::erase(const_iterator first, const_iterator last) noexcept {
+    assert(!read_only() && begin() <= first && first <= last && last <= end());
+    pointer dest{ m_data + (first - m_data) };
+    ::std::copy(last, const_iterator{ end() }, dest);
+    set_size(size() - static_cast<size_type>(last - first));
+    return dest;
+  }
+
+  template<typename T>
+  void mapped_vector<T>::clear() noexcept {
+    if (!m_map) return;
+    assert(!read_only());
+    set_size(0);
+  }
+
+  template<typename T>
+  void mapped_vector<T>::resize(size_type elements) {
+    resize(elements, T{});
+  }
+
+  template<typename T>
+  void mapped_vector<T>::resize(size_type elements, const T &val) {
+    assert(is_open() && !read_only());
+    const size_type count{ size() };
+    if (elements > count) {
+      const T copy(val);
+      if (elements > m_capacity) reserve(elements);
+      ::std::fill_n(m_data + count, elements - count, copy);
+    }
+    set_size(elements);
+  }
+
+  template<typename T>
+  void mapped_vector<T>::reserve(size_type elements) {
+    assert(is_open() && !read_only());
+    if (elements <= m_capacity) return;
+    remap(elements);
+  }
+
+  template<typename T>
+  void mapped_vector<T>::shrink_to_fit() {
+    assert(is_open() && !read_only());
+    if (size() != m_capacity) remap(size());
+  }
+
+  template<typename T>
+  void mapped_vector<T>::swap(mapped_vector &other) noexcept {
+    using ::std::swap;
+    swap(m_fd, other.m_fd);
+    swap(m_mode, other.m_mode);
+    swap(m_map, other.m_map);
+    swap(m_map_bytes, other.m_map_bytes);
+    swap(m_data, other.m_data);
+    swap(m_capacity, other.m_capacity);
+  }
+
+  template<typename T>
+  void swap(mapped_vector<T> &lhs, mapped_vector<T> &rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+} // namespace ftl
+
+#endif // FTL_HAS_MMAP
@@ -0,0 +1,196 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "allocator.hpp" // allocation_result
+
+#include <cstddef> // size_t, ptrdiff_t
+#include <cstdlib> // malloc, realloc, free
+#include <cstring> // memcpy
+#include <limits> // numeric_limits
+#include <new> // bad_alloc
+#include <type_traits> // false_type
+#include <utility> // forward
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h> // mmap, munmap, mremap, madvise
+#include <unistd.h> // sysconf
+#define FTL_HAS_MMAP 1
+#else
+#define FTL_HAS_MMAP 0
+#endif
+
+namespace ftl {
+
+  namespace detail {
+#if FTL_HAS_MMAP
+    inline ::std::size_t page_size() noexcept {
+      static const ::std::size_t size{ static_cast<::std::size_t>(::sysconf(_SC_PAGESIZE)) };
+      return size;
+    }
+
+    inline ::std::size_t round_to_pages(::std::size_t bytes) noexcept {
+      const ::std::size_t page{ page_size() };
+      return (bytes + page - 1) / page * page;
+    }
+
+    inline void advise_huge_pages(void *p, ::std::size_t bytes) noexcept {
+#ifdef MADV_HUGEPAGE
+      // Only a hint: it fails harmlessly where transparent huge pages are disabled.
+      (void)::madvise(p, bytes, MADV_HUGEPAGE);
+#else
+      (void)p;
+      (void)bytes;
+#endif
+    }
+
+    inline void *map_pages(::std::size_t bytes) {
+      void *p{ ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+      if (p == MAP_FAILED) throw ::std::bad_alloc{};
+      advise_huge_pages(p, bytes);
+      return p;
+    }
+
+    // Moves a mapping of old_bytes to one of new_bytes. Both are multiples of the page size.
+    inline void *remap_pages(void *p, ::std::size_t old_bytes, ::std::size_t new_bytes) {
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+      // The kernel moves the page table entries, so no byte is copied however large the block.
+      void *result{ ::mremap(p, old_bytes, new_bytes, MREMAP_MAYMOVE) };
+      if (result == MAP_FAILED) throw ::std::bad_alloc{};
+      advise_huge_pages(result, new_bytes);
+      return result;
+#else
+      void *result{ map_pages(new_bytes) };
+      ::std::memcpy(result, p, old_bytes < new_bytes ? old_bytes : new_bytes);
+      ::munmap(p, old_bytes);
+      return result;
+#endif
+    }
+#endif
+  } // namespace detail
+
+  // mmap_allocator maps blocks of ThresholdBytes or more directly from the kernel as anonymous memory, and asks for
+  // transparent huge pages on them. Smaller blocks come from malloc.
+  // Its reallocate grows mapped blocks with mremap, which moves pages rather than bytes: an ftl::vector of trivially
+  // relocatable elements using it never copies its elements when it grows past the threshold, so push_back has no
+  // latency spikes proportional to the size. Pages are only touched when written, so large reserves are cheap too.
+  // Mapped blocks are rounded up to whole pages, and allocate_at_least reports the slack.
+  // Where mmap is not available, every block comes from malloc.
+  template<typename T, ::std::size_t ThresholdBytes = ::std::size_t{ 1 } << 20>
+  class mmap_allocator {
+  public:
+    using value_type = T;
+    using pointer = T*;
+    using reference = T&;
+    using const_pointer = const T *;
+    using const_reference = const T&;
+    using size_type = ::std::size_t;
+    using difference_type = ::std::ptrdiff_t;
+    template<typename Type>
+    using rebind = mmap_allocator<Type, ThresholdBytes>;
+    using propagate_on_container_move_assignment = ::std::false_type;
+
+    static constexpr size_type threshold_bytes{ ThresholdBytes };
+
+    mmap_allocator() noexcept = default;
+    template<class U>
+    mmap_allocator(const mmap_allocator<U, ThresholdBytes> &) noexcept {}
+
+    pointer allocate(size_type n) {
+      return allocate_at_least(n).ptr;
+    }
+    allocation_result<pointer, size_type> allocate_at_least(size_type n);
+    void deallocate(pointer p, size_type n) noexcept;
+    allocation_result<pointer, size_type> reallocate(pointer p, size_type old_count, size_type n);
+
+    size_type max_size() const noexcept { return ::std::numeric_limits<size_type>::max() / sizeof(T); }
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+      ::new ((void*)p) U(::std::forward<Args>(args)...);
+    }
+    template<class U>
+    void destroy(U* p) {
+      p->~U();
+    }
+
+  private:
+    static bool is_mapped(size_type n) noexcept { return FTL_HAS_MMAP && n * sizeof(T) >= ThresholdBytes; }
+    // The element count a block for n elements really holds. Mapped blocks hold whole pages, as long as that
+    // maps back to the same number of bytes, which deallocate relies on.
+    static size_type usable_count(size_type n) noexcept;
+    static pointer small_allocate(size_type n);
+  };
+
+  template<typename T, ::std::size_t ThresholdBytes>
+  typename mmap_allocator<T, ThresholdBytes>::size_type mmap_allocator<T, ThresholdBytes>::usable_count(size_type n) noexcept {
+#if FTL_HAS_MMAP
+    if (is_mapped(n)) {
+      const size_type bytes{ detail::round_to_pages(n * sizeof(T)) };
+      const size_type count{ bytes / sizeof(T) };
+      if (detail::round_to_pages(count * sizeof(T)) == bytes) return count;
+    }
+#endif
+    return n;
+  }
+
+  template<typename T, ::std::size_t ThresholdBytes>
+  typename mmap_allocator<T, ThresholdBytes>::pointer mmap_allocator<T, ThresholdBytes>::small_allocate(size_type n) {
+    void *p{ ::std::malloc(n ? n * sizeof(T) : 1) };
+    if (!p) throw ::std::bad_alloc{};
+    return static_cast<pointer>(p);
+  }
+
+  template<typename T, ::std::size_t ThresholdBytes>
+  allocation_result<typename mmap_allocator<T, ThresholdBytes>::pointer, typename mmap_allocator<T, ThresholdBytes>::size_type>
+    mmap_allocator<T, ThresholdBytes>::allocate_at_least(size_type n) {
+    if (n > max_size()) throw ::std::bad_alloc{};
+#if FTL_HAS_MMAP
+    if (is_mapped(n)) {
+      return { static_cast<pointer>(detail::map_pages(detail::round_to_pages(n * sizeof(T)))), usable_count(n) };
+    }
+#endif
+    return { small_allocate(n), n };
+  }
+
+  template<typename T, ::std::size_t ThresholdBytes>
+  void mmap_allocator<T, ThresholdBytes>::deallocate(pointer p, size_type n) noexcept {
+#if FTL_HAS_MMAP
+    if (is_mapped(n)) {
+      ::munmap(p, detail::round_to_pages(n * sizeof(T)));
+      return;
+    }
+#endif
+    (void)n;
+    ::std::free(p);
+  }
+
+  template<typename T, ::std::size_t ThresholdBytes>
+  allocation_result<typename mmap_allocator<T, ThresholdBytes>::pointer, typename mmap_allocator<T, ThresholdBytes>::size_type>
+    mmap_allocator<T, ThresholdBytes>::reallocate(pointer p, size_type old_count, size_type n) {
+    if (n > max_size()) throw ::std::bad_alloc{};
+    const bool old_mapped{ is_mapped(old_count) };
+    const bool new_mapped{ is_mapped(n) };
+#if FTL_HAS_MMAP
+    if (old_mapped && new_mapped) {
+      void *result{ detail::remap_pages(p, detail::round_to_pages(old_count * sizeof(T)), detail::round_to_pages(n * sizeof(T))) };
+      return { static_cast<pointer>(result), usable_count(n) };
+    }
+#endif
+    if (!old_mapped && !new_mapped) {
+      void *result{ ::std::realloc(p, n ? n * sizeof(T) : 1) };
+      if (!result) throw ::std::bad_alloc{};
+      return { static_cast<pointer>(result), n };
+    }
+    // Crossing the threshold: the bytes are copied once, into or out of the mapping.
+    auto result = allocate_at_least(n);
+    ::std::memcpy(static_cast<void*>(result.ptr), static_cast<const void*>(p), (old_count < n ? old_count : n) * sizeof(T));
+    deallocate(p, old_count);
+    return result;
+  }
+
+  template<typename T, typename U, ::std::size_t ThresholdBytes>
+  bool operator==(const mmap_allocator<T, ThresholdBytes> &, const mmap_allocator<U, ThresholdBytes> &) noexcept { return true; }
+  template<typename T, typename U, ::std::size_t ThresholdBytes>
+  bool operator!=(const mmap_allocator<T, ThresholdBytes> &, const mmap_allocator<U, ThresholdBytes> &) noexcept { return false; }
+
+} // namespace ftl
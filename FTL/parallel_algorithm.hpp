@@ -0,0 +1,232 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "thread_pool.hpp" // thread_pool
+#include "allocator.hpp" // default_allocator
+#include "vector.hpp" // detail kernels
+
+#include <algorithm> // sort, fill, transform, merge, lower_bound, upper_bound
+#include <cassert> // assert
+#include <cstddef> // size_t
+#include <functional> // less, plus
+#include <iterator> // make_move_iterator
+#include <type_traits> // remove_cv, remove_reference, aligned_storage
+#include <new> // placement new
+#include <utility> // move
+
+namespace ftl {
+
+  // Parallel algorithms over contiguous containers: anything with data() and size(), such as ftl::vector and
+  // ftl::inline_vector. They run on a thread_pool, thread_pool::default_pool() unless one is passed.
+  // Ranges are split in halves recursively, fork_join style, until a piece is no larger than the grain.
+  // Split points are rounded to whole cache lines of elements, so two workers never write to the same line when the
+  // buffer starts on a line boundary. The splits only depend on the element count, the element size and the grain,
+  // never on the buffer's address, the thread count or timing, so parallel_reduce combines partial results in the
+  // same order on every run.
+  // Exceptions thrown by the callables are rethrown to the caller, except in parallel_sort (see there).
+
+  namespace detail {
+    constexpr ::std::size_t cache_line_size{ 64 };
+
+    template<typename Container>
+    using parallel_value_t = typename ::std::remove_cv<typename ::std::remove_reference<decltype(*::std::declval<Container&>().data())>::type>::type;
+
+    // The default number of elements below which a range is not split any further: 16 KiB worth of elements.
+    template<typename T>
+    constexpr ::std::size_t default_grain() noexcept {
+      return sizeof(T) >= 16384 ? 1 : 16384 / sizeof(T);
+    }
+
+    // A split point near the middle of [first, last), moved down to a multiple of a cache line's worth of elements
+    // when possible. It is computed from the indices alone, so it lands on a line boundary when the buffer starts on one,
+    // and never depends on where the buffer is.
+    template<typename T>
+    constexpr ::std::size_t split_point(::std::size_t first, ::std::size_t last) noexcept {
+      const ::std::size_t mid{ first + (last - first) / 2 };
+      const ::std::size_t per_line{ sizeof(T) >= cache_line_size ? 1 : cache_line_size / sizeof(T) };
+      const ::std::size_t back{ mid % per_line };
+      return mid - back > first ? mid - back : mid;
+    }
+
+    // Calls chunk(first, last) on pieces of [first, last) covering it, in parallel.
+    template<typename T, typename Chunk>
+    void parallel_chunks(thread_pool &pool, T *base, ::std::size_t first, ::std::size_t last, ::std::size_t grain, Chunk &chunk) {
+      if (last - first <= grain) {
+        chunk(base + first, base + last);
+        return;
+      }
+      const ::std::size_t mid{ split_point<T>(first, last) };
+      pool.fork_join([&] { parallel_chunks(pool, base, first, mid, grain, chunk); },
+        [&] { parallel_chunks(pool, base, mid, last, grain, chunk); });
+    }
+
+    template<typename R, typename T, typename BinaryOp>
+    R parallel_reduce(thread_pool &pool, const T *base, ::std::size_t first, ::std::size_t last, ::std::size_t grain, BinaryOp &op) {
+      if (last - first <= grain) {
+        R result(base[first]);
+        for (::std::size_t i{ first + 1 }; i < last; ++i) {
+          result = op(::std::move(result), base[i]);
+        }
+        return result;
+      }
+      const ::std::size_t mid{ split_point<T>(first, last) };
+      // Both halves are non-empty, so each produces a value. R need not be default constructible,
+      // so the results are built in raw storage.
+      typename ::std::aligned_storage<sizeof(R), alignof(R)>::type left_storage, right_storage;
+      R *left{ nullptr };
+      R *right{ nullptr };
+      try {
+        pool.fork_join([&] { left = ::new (&left_storage) R(parallel_reduce<R>(pool, base, first, mid, grain, op)); },
+          [&] { right = ::new (&right_storage) R(parallel_reduce<R>(pool, base, mid, last, grain, op)); });
+      }
+      catch (...) {
+        if (left) left->~R();
+        if (right) right->~R();
+        throw;
+      }
+      struct destroyer {
+        R *value;
+        ~destroyer() { value->~R(); }
+      } destroy_left{ left }, destroy_right{ right };
+      return op(::std::move(*left), ::std::move(*right));
+    }
+
+    // Merges the sorted ranges [first1, last1) and [first2, last2) into dest by move assignment, in parallel.
+    template<typename T, typename Compare>
+    void parallel_merge(thread_pool &pool, T *first1, T *last1, T *first2, T *last2, T *dest, ::std::size_t grain, Compare &comp) {
+      const ::std::size_t size1{ static_cast<::std::size_t>(last1 - first1) };
+      const ::std::size_t size2{ static_cast<::std::size_t>(last2 - first2) };
+      // Two single elements can't be split any further: the split below could put both on the same side.
+      if (size1 + size2 <= grain || size1 + size2 <= 2) {
+        ::std::merge(::std::make_move_iterator(first1), ::std::make_move_iterator(last1),
+          ::std::make_move_iterator(first2), ::std::make_move_iterator(last2), dest, comp);
+        return;
+      }
+      // Split the larger range in the middle, and the other where its elements stop ordering before that middle.
+      // Equal elements from the first range stay ahead of those from the second.
+      T *mid1;
+      T *mid2;
+      if (size1 >= size2) {
+        mid1 = first1 + size1 / 2;
+        mid2 = ::std::lower_bound(first2, last2, *mid1, comp);
+      }
+      else {
+        mid2 = first2 + size2 / 2;
+        mid1 = ::std::upper_bound(first1, last1, *mid2, comp);
+      }
+      T *dest_mid{ dest + (mid1 - first1) + (mid2 - first2) };
+      pool.fork_join([&] { parallel_merge(pool, first1, mid1, first2, mid2, dest, grain, comp); },
+        [&] { parallel_merge(pool, mid1, last1, mid2, last2, dest_mid, grain, comp); });
+    }
+
+    // Sorts [data, data + n) with a parallel merge sort over two buffers of live elements.
+    // The sorted result lands in data if in_place, otherwise in scratch.
+    template<typename T, typename Compare>
+    void parallel_merge_sort(thread_pool &pool, T *data, T *scratch, ::std::size_t n, bool in_place, ::std::size_t grain, Compare &comp) {
+      if (n <= grain) {
+        ::std::sort(data, data + n, comp);
+        if (!in_place) {
+          ::std::move(data, data + n, scratch);
+        }
+        return;
+      }
+      const ::std::size_t mid{ split_point<T>(0, n) };
+      // The halves are sorted into the other buffer, then merged back into the one the result belongs in.
+      pool.fork_join([&] { parallel_merge_sort(pool, data, scratch, mid, !in_place, grain, comp); },
+        [&] { parallel_merge_sort(pool, data + mid, scratch + mid, n - mid, !in_place, grain, comp); });
+      T *from{ in_place ? scratch : data };
+      T *to{ in_place ? data : scratch };
+      parallel_merge(pool, from, from + mid, from + mid, from + n, to, grain, comp);
+    }
+  } // namespace detail
+
+  // Calls function(element) for every element of c.
+  template<typename Container, typename Function>
+  void parallel_for(Container &c, Function function, thread_pool &pool = thread_pool::default_pool()) {
+    using pointer = decltype(c.data());
+    if (c.size() == 0) return;
+    auto chunk = [&function](pointer first, pointer last) {
+      for (; first != last; ++first) function(*first);
+    };
+    detail::parallel_chunks(pool, c.data(), 0, c.size(), detail::default_grain<detail::parallel_value_t<Container>>(), chunk);
+  }
+
+  // Calls function(first, last) on contiguous pieces covering c, at most grain elements each.
+  // The loop over a piece is visible to the optimizer, so it can be vectorized.
+  template<typename Container, typename Function>
+  void parallel_for_chunks(Container &c, Function function, ::std::size_t grain = 0, thread_pool &pool = thread_pool::default_pool()) {
+    using T = detail::parallel_value_t<Container>;
+    if (c.size() == 0) return;
+    detail::parallel_chunks(pool, c.data(), 0, c.size(), grain ? grain : detail::default_grain<T>(), function);
+  }
+
+  // Assigns op(in[i]) to out[i] for every element of in. out must be at least as large as in.
+  template<typename Input, typename Output, typename UnaryOp>
+  void parallel_transform(const Input &in, Output &out, UnaryOp op, thread_pool &pool = thread_pool::default_pool()) {
+    using T = detail::parallel_value_t<Output>;
+    assert(out.size() >= in.size());
+    if (in.size() == 0) return;
+    const auto *source = in.data();
+    T *base{ out.data() };
+    // Chunks are cut along the output, as that is where workers would otherwise share cache lines.
+    auto chunk = [&](T *first, T *last) {
+      ::std::transform(source + (first - base), source + (last - base), first, op);
+    };
+    detail::parallel_chunks(pool, base, 0, in.size(), detail::default_grain<T>(), chunk);
+  }
+
+  // Combines init and every element of c with op, which must be associative; the grouping is unspecified,
+  // but the same for every run over the same number of elements.
+  template<typename Container, typename T, typename BinaryOp>
+  T parallel_reduce(const Container &c, T init, BinaryOp op, thread_pool &pool = thread_pool::default_pool()) {
+    using V = detail::parallel_value_t<const Container>;
+    if (c.size() == 0) return init;
+    T total(init);
+    pool.run([&] { total = op(::std::move(total), detail::parallel_reduce<T>(pool, c.data(), 0, c.size(), detail::default_grain<V>(), op)); });
+    return total;
+  }
+
+  // Sums the elements of c onto init.
+  template<typename Container, typename T>
+  T parallel_reduce(const Container &c, T init, thread_pool &pool = thread_pool::default_pool()) {
+    return parallel_reduce(c, init, ::std::plus<T>{}, pool);
+  }
+
+  // Assigns val to every element of c.
+  template<typename Container, typename T>
+  void parallel_fill(Container &c, const T &val, thread_pool &pool = thread_pool::default_pool()) {
+    using V = detail::parallel_value_t<Container>;
+    if (c.size() == 0) return;
+    auto chunk = [&val](V *first, V *last) { ::std::fill(first, last, val); };
+    detail::parallel_chunks(pool, c.data(), 0, c.size(), detail::default_grain<V>(), chunk);
+  }
+
+  // Sorts c with a parallel merge sort. Like std::sort it is not stable.
+  // It needs a scratch buffer as large as c, whose elements are move constructed from c's.
+  // As with the standard parallel execution policies, an exception thrown by comp or by moving an element
+  // calls std::terminate, since the elements are spread over two buffers at that point.
+  template<typename Container, typename Compare = ::std::less<detail::parallel_value_t<Container>>>
+  void parallel_sort(Container &c, Compare comp = Compare{}, thread_pool &pool = thread_pool::default_pool()) {
+    using T = detail::parallel_value_t<Container>;
+    const ::std::size_t n{ c.size() };
+    const ::std::size_t grain{ detail::default_grain<T>() };
+    if (n <= grain) {
+      ::std::sort(c.data(), c.data() + n, comp);
+      return;
+    }
+    default_allocator<T> alloc;
+    T *scratch{ alloc.allocate(n) };
+    T *data{ c.data() };
+    [&]() noexcept {
+      // The scratch buffer starts out holding the elements, and the sort moves them back into c.
+      auto move_out = [&](T *first, T *last) { detail::uninitialized_move(alloc, first, last, scratch + (first - data)); };
+      detail::parallel_chunks(pool, data, 0, n, grain, move_out);
+      pool.run([&] { detail::parallel_merge_sort(pool, scratch, data, n, false, grain, comp); });
+      auto destroy = [&](T *first, T *last) { detail::destroy_range(alloc, first, last); };
+      detail::parallel_chunks(pool, scratch, 0, n, grain, destroy);
+    }();
+    alloc.deallocate(scratch, n);
+  }
+
+} // namespace ftl
@@ -0,0 +1,281 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "allocator.hpp" // allocation_result
+
+#include <cassert> // assert
+#include <cstddef> // size_t, ptrdiff_t
+#include <cstdint> // uintptr_t, uint32_t
+#include <cstdlib> // posix_memalign, free
+#include <limits> // numeric_limits
+#include <new> // bad_alloc
+#include <type_traits> // false_type
+#include <utility> // forward
+
+#ifdef _WIN32
+#include <malloc.h> // _aligned_malloc, _aligned_free
+#endif
+
+namespace ftl {
+
+  // What a block_pool holds.
+  struct block_pool_stats {
+    ::std::size_t slabs;
+    ::std::size_t live_blocks;
+  };
+
+  // block_pool serves small blocks, up to max_block_bytes, from segregated size classes: multiples of 16 bytes up to
+  // 128, then 256 and 512. Each class has an intrusive free list threaded through its free blocks, so allocating
+  // and deallocating are a pop and a push which touch nothing but the block and the list head. When its list is
+  // empty, a class carves blocks from its current slab, a page sized chunk, lazily so fresh slabs aren't touched
+  // until they are used.
+  // release_unused gives slabs whose blocks are all free back to the heap, in one pass over the free lists; slabs
+  // are aligned to their size, so the slab of a block is found by masking its address. The destructor frees every slab.
+  // A block_pool is not thread safe: blocks must be allocated and deallocated by the thread owning the pool.
+  class block_pool {
+  public:
+    static constexpr ::std::size_t slab_bytes{ 4096 };
+    static constexpr ::std::size_t max_block_bytes{ 512 };
+    static constexpr ::std::size_t block_alignment{ 16 };
+    static constexpr ::std::size_t class_count{ 10 };
+
+    block_pool() noexcept = default;
+    block_pool(const block_pool &) = delete;
+    block_pool& operator=(const block_pool &) = delete;
+    ~block_pool();
+
+    // bytes must be at most max_block_bytes. Blocks are aligned to block_alignment.
+    void* allocate(::std::size_t bytes);
+    // bytes must be the size the block was allocated with, or anything else in the same size class.
+    void deallocate(void *p, ::std::size_t bytes) noexcept;
+    // Gives every slab whose blocks are all free back to the heap.
+    void release_unused() noexcept;
+
+    block_pool_stats stats() const noexcept { return { m_slabs, m_live_blocks }; }
+
+    // The size of the blocks serving a request of the given size.
+    static ::std::size_t block_size(::std::size_t bytes) noexcept { return class_bytes(size_class(bytes)); }
+
+    // The pool default constructed pool_allocators use, one per thread.
+    static block_pool& thread_default();
+
+  private:
+    struct free_node {
+      free_node *next;
+    };
+    struct slab {
+      slab *next;
+      ::std::uint32_t size_class;
+      // Blocks handed out from the slab at least once.
+      ::std::uint32_t carved;
+      // Only used by release_unused.
+      ::std::uint32_t free_blocks;
+    };
+    struct size_class_state {
+      free_node *free{ nullptr };
+      // The part of the current slab not carved yet.
+      char *cursor{ nullptr };
+      char *limit{ nullptr };
+    };
+    static constexpr ::std::size_t header_bytes{ (sizeof(slab) + 63) / 64 * 64 };
+
+    static ::std::size_t size_class(::std::size_t bytes) noexcept {
+      if (bytes <= 128) return bytes ? (bytes - 1) / 16 : 0;
+      return bytes <= 256 ? 8 : 9;
+    }
+    static ::std::size_t class_bytes(::std::size_t size_class) noexcept {
+      return size_class < 8 ? (size_class + 1) * 16 : ::std::size_t{ 256 } << (size_class - 8);
+    }
+    static slab* slab_of(void *p) noexcept {
+      return reinterpret_cast<slab*>(reinterpret_cast<::std::uintptr_t>(p) & ~(::std::uintptr_t{ slab_bytes } - 1));
+    }
+
+    void* carve(::std::size_t size_class);
+    static void free_slab(slab *s) noexcept;
+
+    size_class_state m_classes[class_count];
+    slab *m_slabs_list{ nullptr };
+    ::std::size_t m_slabs{ 0 };
+    ::std::size_t m_live_blocks{ 0 };
+  };
+
+  inline block_pool::~block_pool() {
+    while (m_slabs_list) {
+      slab *next{ m_slabs_list->next };
+      free_slab(m_slabs_list);
+      m_slabs_list = next;
+    }
+  }
+
+  inline void* block_pool::allocate(::std::size_t bytes) {
+    assert(bytes <= max_block_bytes);
+    size_class_state &state = m_classes[size_class(bytes)];
+    ++m_live_blocks;
+    if (free_node *node = state.free) {
+      state.free = node->next;
+      return node;
+    }
+    return carve(size_class(bytes));
+  }
+
+  inline void block_pool::deallocate(void *p, ::std::size_t bytes) noexcept {
+    if (!p) return;
+    assert(slab_of(p)->size_class == size_class(bytes));
+    size_class_state &state = m_classes[size_class(bytes)];
+    free_node *node{ static_cast<free_node*>(p) };
+    node->next = state.free;
+    state.free = node;
+    --m_live_blocks;
+  }
+
+  inline void* block_pool::carve(::std::size_t size_class) {
+    size_class_state &state = m_classes[size_class];
+    const ::std::size_t size{ class_bytes(size_class) };
+    if (static_cast<::std::size_t>(state.limit - state.cursor) < size) {
+      void *memory{ nullptr };
+#ifdef _WIN32
+      memory = ::_aligned_malloc(slab_bytes, slab_bytes);
+#else
+      if (::posix_memalign(&memory, slab_bytes, slab_bytes) != 0) memory = nullptr;
+#endif
+      if (!memory) {
+        --m_live_blocks;
+        throw ::std::bad_alloc{};
+      }
+      slab *s{ static_cast<slab*>(memory) };
+      s->next = m_slabs_list;
+      s->size_class = static_cast<::std::uint32_t>(size_class);
+      s->carved = 0;
+      s->free_blocks = 0;
+      m_slabs_list = s;
+      ++m_slabs;
+      state.cursor = reinterpret_cast<char*>(s) + header_bytes;
+      state.limit = reinterpret_cast<char*>(s) + slab_bytes;
+    }
+    void *block{ state.cursor };
+    state.cursor += size;
+    ++slab_of(block)->carved;
+    return block;
+  }
+
+  inline void block_pool::release_unused() noexcept {
+    // Count the free blocks of every slab, then drop the free blocks of slabs which turn out entirely free from the
+    // lists before freeing the slabs.
+    for (slab *s{ m_slabs_list }; s; s = s->next) s->free_blocks = 0;
+    for (size_class_state &state : m_classes) {
+      for (free_node *node{ state.free }; node; node = node->next) ++slab_of(node)->free_blocks;
+    }
+    auto unused = [](const slab *s) { return s->free_blocks == s->carved; };
+    for (size_class_state &state : m_classes) {
+      free_node **link{ &state.free };
+      while (*link) {
+        if (unused(slab_of(*link))) *link = (*link)->next;
+        else link = &(*link)->next;
+      }
+      if (state.cursor && unused(slab_of(state.limit - 1))) {
+        state.cursor = state.limit = nullptr;
+      }
+    }
+    slab **link{ &m_slabs_list };
+    while (*link) {
+      slab *s{ *link };
+      if (unused(s)) {
+        *link = s->next;
+        free_slab(s);
+        --m_slabs;
+      }
+      else {
+        link = &s->next;
+      }
+    }
+  }
+
+  inline void block_pool::free_slab(slab *s) noexcept {
+#ifdef _WIN32
+    ::_aligned_free(s);
+#else
+    ::std::free(s);
+#endif
+  }
+
+  inline block_pool& block_pool::thread_default() {
+    struct holder {
+      block_pool *pool{ new block_pool{} };
+      ~holder() {
+        // Containers may outlive the thread (statics do), so the pool is only freed when none of its blocks are live.
+        pool->release_unused();
+        if (pool->stats().slabs == 0) delete pool;
+      }
+    };
+    static thread_local holder instance;
+    return *instance.pool;
+  }
+
+  // pool_allocator serves allocations of up to BlockElems elements from a block_pool, and larger ones from new like
+  // default_allocator. It suits vectors which stay small, and inline_vectors which spill over their inline buffer,
+  // where most allocations come in a few sizes. Default constructed allocators use the calling thread's
+  // block_pool::thread_default(), so containers using them must release their memory on the same thread; pass a
+  // block_pool to share one explicitly. Allocators compare equal when they share a pool.
+  template<typename T, ::std::size_t BlockElems = 16>
+  class pool_allocator {
+    static_assert(alignof(T) <= block_pool::block_alignment, "pool_allocator blocks are only aligned to 16 bytes.");
+  public:
+    using value_type = T;
+    using pointer = T*;
+    using reference = T&;
+    using const_pointer = const T *;
+    using const_reference = const T&;
+    using size_type = ::std::size_t;
+    using difference_type = ::std::ptrdiff_t;
+    template<typename Type>
+    using rebind = pool_allocator<Type, BlockElems>;
+    using propagate_on_container_move_assignment = ::std::false_type;
+
+    pool_allocator() : m_pool{ &block_pool::thread_default() } {}
+    explicit pool_allocator(block_pool &pool) noexcept : m_pool{ &pool } {}
+    template<class U>
+    pool_allocator(const pool_allocator<U, BlockElems> &other) noexcept : m_pool{ &other.resource() } {}
+
+    block_pool& resource() const noexcept { return *m_pool; }
+
+    pointer allocate(size_type n) {
+      if (is_pooled(n)) return static_cast<pointer>(m_pool->allocate(n * sizeof(T)));
+      if (n > max_size()) throw ::std::bad_alloc{};
+      return reinterpret_cast<pointer>(::new char[n * sizeof(value_type)]);
+    }
+    // Pooled blocks are reported with the room of their size class, up to BlockElems.
+    allocation_result<pointer, size_type> allocate_at_least(size_type n) {
+      if (!is_pooled(n)) return { allocate(n), n };
+      const size_type room{ block_pool::block_size(n * sizeof(T)) / sizeof(T) };
+      return { static_cast<pointer>(m_pool->allocate(n * sizeof(T))), room < BlockElems ? room : BlockElems };
+    }
+    void deallocate(pointer p, size_type n) noexcept {
+      if (is_pooled(n)) {
+        m_pool->deallocate(p, n * sizeof(T));
+        return;
+      }
+      ::delete[] reinterpret_cast<char*>(p);
+    }
+    size_type max_size() const noexcept { return ::std::numeric_limits<size_type>::max() / sizeof(T); }
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+      ::new ((void*)p) U(::std::forward<Args>(args)...);
+    }
+    template<class U>
+    void destroy(U* p) {
+      p->~U();
+    }
+
+  private:
+    static bool is_pooled(size_type n) noexcept { return n <= BlockElems && n * sizeof(T) <= block_pool::max_block_bytes; }
+
+    block_pool *m_pool;
+  };
+
+  template<typename T, typename U, ::std::size_t BlockElems>
+  bool operator==(const pool_allocator<T, BlockElems> &lhs, const pool_allocator<U, BlockElems> &rhs) noexcept { return &lhs.resource() == &rhs.resource(); }
+  template<typename T, typename U, ::std::size_t BlockElems>
+  bool operator!=(const pool_allocator<T, BlockElems> &lhs, const pool_allocator<U, BlockElems> &rhs) noexcept { return !(lhs == rhs); }
+
+} // namespace ftl
@@ -0,0 +1,112 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include <type_traits> // is_trivially_copyable
+#include <utility> // move_if_noexcept
+#include <cstring> // memcpy
+#include <memory> // unique_ptr
+
+namespace ftl {
+
+  // A type is trivially relocatable if moving an object to a new address and ending the lifetime
+  // of the original is equivalent to copying its bytes. Every trivially copyable type qualifies.
+  // Types which own resources through a pointer (handles, unique_ptr-like types) usually qualify as well,
+  // and may opt in by specializing this trait:
+  //   template<> struct ftl::is_trivially_relocatable<my_handle> : ::std::true_type {};
+  template<typename T>
+  struct is_trivially_relocatable : ::std::is_trivially_copyable<T> {};
+
+  template<typename T>
+  struct is_trivially_relocatable<::std::unique_ptr<T>> : ::std::true_type {};
+
+  namespace detail {
+    template<typename Alloc, typename T>
+    T* relocate(Alloc &, T *first, T *last, T *dest, ::std::true_type) noexcept {
+      const auto count{ static_cast<std::size_t>(last - first) };
+      if (count) {
+        ::std::memcpy(static_cast<void*>(dest), static_cast<const void*>(first), count * sizeof(T));
+      }
+      return dest + count;
+    }
+
+    template<typename Alloc, typename T>
+    T* relocate(Alloc &alloc, T *first, T *last, T *dest, ::std::false_type) {
+      T *out{ dest };
+      try {
+        for (T *it{ first }; it != last; ++it, ++out) {
+          alloc.construct(out, ::std::move_if_noexcept(*it));
+        }
+      }
+      catch (...) {
+        // The source range is left intact when copying, so only the partial destination must be undone.
+        for (; out != dest; --out) {
+          alloc.destroy(out - 1);
+        }
+        throw;
+      }
+      for (T *it{ first }; it != last; ++it) {
+        alloc.destroy(it);
+      }
+      return out;
+    }
+
+    template<typename Alloc, typename T>
+    T* relocate_with_gap(Alloc &, T *first, T *position, T *last, T *dest, ::std::size_t gap, ::std::true_type) noexcept {
+      const auto prefix{ static_cast<std::size_t>(position - first) };
+      const auto suffix{ static_cast<std::size_t>(last - position) };
+      if (prefix) {
+        ::std::memcpy(static_cast<void*>(dest), static_cast<const void*>(first), prefix * sizeof(T));
+      }
+      if (suffix) {
+        ::std::memcpy(static_cast<void*>(dest + prefix + gap), static_cast<const void*>(position), suffix * sizeof(T));
+      }
+      return dest + prefix + gap + suffix;
+    }
+
+    template<typename Alloc, typename T>
+    T* relocate_with_gap(Alloc &alloc, T *first, T *position, T *last, T *dest, ::std::size_t gap, ::std::false_type) {
+      T *prefix_end{ dest };
+      T *suffix_begin{ dest + (position - first) + gap };
+      T *out{ suffix_begin };
+      try {
+        for (T *it{ first }; it != position; ++it, ++prefix_end) {
+          alloc.construct(prefix_end, ::std::move_if_noexcept(*it));
+        }
+        for (T *it{ position }; it != last; ++it, ++out) {
+          alloc.construct(out, ::std::move_if_noexcept(*it));
+        }
+      }
+      catch (...) {
+        for (; out != suffix_begin; --out) {
+          alloc.destroy(out - 1);
+        }
+        for (; prefix_end != dest; --prefix_end) {
+          alloc.destroy(prefix_end - 1);
+        }
+        throw;
+      }
+      for (T *it{ first }; it != last; ++it) {
+        alloc.destroy(it);
+      }
+      return out;
+    }
+  } // namespace detail
+
+  // Moves the elements of [first, last) into the uninitialized storage at dest, which must not overlap the source.
+  // The source objects are destroyed afterwards, so [first, last) is raw storage once this returns.
+  // Returns the end of the relocated range.
+  template<typename Alloc, typename T>
+  T* relocate(Alloc &alloc, T *first, T *last, T *dest) {
+    return detail::relocate(alloc, first, last, dest, ::std::integral_constant<bool, is_trivially_relocatable<T>::value>{});
+  }
+
+  // Relocates [first, last) like relocate, but leaves `gap` uninitialized elements at dest + (position - first),
+  // so a container can grow and open a hole for new elements with a single pass over the old ones.
+  // Returns the end of the relocated range, gap included.
+  template<typename Alloc, typename T>
+  T* relocate_with_gap(Alloc &alloc, T *first, T *position, T *last, T *dest, ::std::size_t gap) {
+    return detail::relocate_with_gap(alloc, first, position, last, dest, gap, ::std::integral_constant<bool, is_trivially_relocatable<T>::value>{});
+  }
+
+} // namespace ftl
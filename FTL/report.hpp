@@ -0,0 +1,27 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include <ostream> // ostream
+
+namespace ftl {
+
+  // The formats the statistics reports (write_allocation_report, write_vector_event_summary) are written in.
+  enum class report_format { text, json };
+
+  namespace detail {
+    // Writes s as a quoted JSON string.
+    inline void write_json_string(::std::ostream &out, const char *s) {
+      static const char hex[]{ "0123456789abcdef" };
+      out << '"';
+      for (; *s; ++s) {
+        const unsigned char c{ static_cast<unsigned char>(*s) };
+        if (c == '"' || c == '\\') out << '\\' << *s;
+        else if (c < 0x20) out << "\\u00" << hex[c >> 4] << hex[c & 0xF];
+        else out << *s;
+      }
+      out << '"';
+    }
+  } // namespace detail
+
+} // namespace ftl
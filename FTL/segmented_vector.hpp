@@ -0,0 +1,505 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "vector.hpp" // ftl::vector for the block table, detail kernels, allocator_holder
+#include "span.hpp" // ftl::span
+
+#include <algorithm> // rotate, move, equal
+#include <cassert> // assert
+#include <cstddef> // size_t, ptrdiff_t
+#include <initializer_list> // initializer_list
+#include <iterator> // random_access_iterator_tag, reverse_iterator, iterator_traits
+#include <type_traits> // conditional, enable_if
+#include <utility> // forward, move, swap
+
+namespace ftl {
+
+  namespace detail {
+    // The largest power of two number of T which fits in Bytes, and at least 1.
+    template<typename T, ::std::size_t Bytes = 4096>
+    struct default_block_size {
+      static constexpr ::std::size_t compute() noexcept {
+        ::std::size_t size{ 1 };
+        while (size * 2 * sizeof(T) <= Bytes) size *= 2;
+        return size;
+      }
+      static constexpr ::std::size_t value{ compute() };
+    };
+  } // namespace detail
+
+  // segmented_vector stores its elements in fixed size blocks of BlockSize elements, and a table of block pointers.
+  // Growing allocates one more block and appends a pointer to the table, so an element is never relocated:
+  // push_back costs the same at 100M elements as at 10, peak memory never doubles, and references to elements
+  // stay valid until they are erased. BlockSize is a power of two, so indexing is a shift and a mask.
+  // Iterators hold the container and an index, so they also survive push_back. Loops which should vectorize can
+  // walk the contiguous blocks with for_each_block or block(k) instead of the iterators.
+  // Blocks are obtained from Alloc one at a time, and the block table uses Alloc rebound to T*.
+  // The interface mirrors ftl::vector, except for data() since the elements are not contiguous.
+  template<typename T, typename Alloc = default_allocator<T>, ::std::size_t BlockSize = detail::default_block_size<T>::value>
+  class segmented_vector : private detail::allocator_holder<Alloc> {
+    static_assert(BlockSize && (BlockSize & (BlockSize - 1)) == 0, "The block size of a segmented_vector must be a power of two.");
+    using allocator_holder = detail::allocator_holder<Alloc>;
+    template<bool Const>
+    class iterator_base;
+  public:
+    using value_type = T;
+    using allocator_type = Alloc;
+    using size_type = ::std::size_t;
+    using difference_type = ::std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+    using reverse_iterator = ::std::reverse_iterator<iterator>;
+    using const_reverse_iterator = ::std::reverse_iterator<const_iterator>;
+    static constexpr size_type block_size{ BlockSize };
+
+    segmented_vector() = default;
+    explicit segmented_vector(const allocator_type &alloc);
+    segmented_vector(size_type n, const T &val = T{}, const allocator_type &alloc = allocator_type{});
+    template<typename InputIterator, typename = typename ::std::enable_if<!::std::is_integral<InputIterator>::value>::type>
+    segmented_vector(InputIterator first, InputIterator last, const allocator_type &alloc = allocator_type{});
+    segmented_vector(::std::initializer_list<T> il, const allocator_type &alloc = allocator_type{});
+    segmented_vector(const segmented_vector &other);
+    segmented_vector(segmented_vector &&other) noexcept;
+    ~segmented_vector();
+
+    segmented_vector& operator=(const segmented_vector &other);
+    segmented_vector& operator=(segmented_vector &&other) noexcept;
+    segmented_vector& operator=(::std::initializer_list<T> il);
+
+    template<typename InputIterator, typename = typename ::std::enable_if<!::std::is_integral<InputIterator>::value>::type>
+    void assign(InputIterator first, InputIterator last);
+    void assign(size_type n, const T &val);
+    void assign(::std::initializer_list<T> il) { assign(il.begin(), il.end()); }
+
+    // iterators
+    iterator begin() noexcept { return iterator{ this, 0 }; }
+    iterator end() noexcept { return iterator{ this, m_size }; }
+    const_iterator begin() const noexcept { return const_iterator{ this, 0 }; }
+    const_iterator end() const noexcept { return const_iterator{ this, m_size }; }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator{ end() }; }
+    reverse_iterator rend() noexcept { return reverse_iterator{ begin() }; }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator{ end() }; }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator{ begin() }; }
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+    const_reverse_iterator crend() const noexcept { return rend(); }
+
+    // element access
+    reference operator[](size_type n) noexcept { return m_blocks[n / block_size][n % block_size]; }
+    const_reference operator[](size_type n) const noexcept { return m_blocks[n / block_size][n % block_size]; }
+    reference at(size_type n) noexcept;
+    const_reference at(size_type n) const noexcept;
+    reference front() noexcept { return (*this)[0]; }
+    const_reference front() const noexcept { return (*this)[0]; }
+    reference back() noexcept { return (*this)[m_size - 1]; }
+    const_reference back() const noexcept { return (*this)[m_size - 1]; }
+
+    // block access
+    // The number of blocks holding elements. Every one is full except possibly the last.
+    size_type block_count() const noexcept { return (m_size + block_size - 1) / block_size; }
+    span<T> block(size_type k) noexcept;
+    span<const T> block(size_type k) const noexcept;
+    // Calls function(first, last) with the bounds of every block's elements, in order.
+    template<typename Function>
+    void for_each_block(Function function);
+    template<typename Function>
+    void for_each_block(Function function) const;
+
+    // modifiers
+    void push_back(const T &val) { emplace_back(val); }
+    void push_back(T &&val) { emplace_back(::std::move(val)); }
+    template<typename... Args>
+    reference emplace_back(Args&&... args);
+    void pop_back();
+    template<typename... Args>
+    iterator emplace(const_iterator position, Args&&... args);
+    iterator insert(const_iterator position, const T &val);
+    iterator insert(const_iterator position, T &&val);
+    iterator insert(const_iterator position, size_type n, const T &val);
+    template<typename InputIterator, typename = typename ::std::enable_if<!::std::is_integral<InputIterator>::value>::type>
+    iterator insert(const_iterator position, InputIterator first, InputIterator last);
+    iterator insert(const_iterator position, ::std::initializer_list<T> il) { return insert(position, il.begin(), il.end()); }
+    iterator erase(const_iterator position);
+    iterator erase(const_iterator first, const_iterator last);
+    void clear() noexcept;
+    void swap(segmented_vector &other) noexcept;
+
+    // capacity
+    size_type size() const noexcept { return m_size; }
+    size_type max_size() const noexcept { return allocator_ref().max_size(); }
+    bool empty() const noexcept { return m_size == 0; }
+    size_type capacity() const noexcept { return m_blocks.size() * block_size; }
+    void resize(size_type elements);
+    void resize(size_type elements, const T &val);
+    void reserve(size_type elements);
+    // Frees the blocks past the last element, and trims the block table.
+    void shrink_to_fit();
+
+    allocator_type get_allocator() const noexcept { return allocator_ref(); }
+
+  private:
+    using allocator_holder::allocator_ref;
+    using block_table = vector<T*, typename Alloc::template rebind<T*>>;
+
+    // Constructs elements [m_size, m_size + n) one block at a time with fill(dest, count), which constructs a whole
+    // chunk or nothing. The size is updated after every chunk, so a throw keeps the elements already built.
+    template<typename Fill>
+    void append_chunks(size_type n, Fill fill);
+    // Appends, then rotates the appended elements into place at index.
+    template<typename Append>
+    iterator insert_by_rotation(size_type index, Append append);
+    void destroy_from(size_type first) noexcept;
+    void release_blocks(size_type first_block) noexcept;
+
+    block_table m_blocks;
+    size_type m_size{ 0 };
+  };
+
+  template<typename T>
+  using stable_vector = segmented_vector<T>;
+
+  // Iterators address elements by index through the container, so growing the block table does not invalidate them.
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  template<bool Const>
+  class segmented_vector<T, Alloc, BlockSize>::iterator_base {
+    friend class segmented_vector;
+    friend class iterator_base<!Const>;
+    using container = typename ::std::conditional<Const, const segmented_vector, segmented_vector>::type;
+  public:
+    using iterator_category = ::std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = ::std::ptrdiff_t;
+    using reference = typename ::std::conditional<Const, const T&, T&>::type;
+    using pointer = typename ::std::conditional<Const, const T*, T*>::type;
+
+    iterator_base() = default;
+    template<bool OtherConst, typename = typename ::std::enable_if<Const && !OtherConst>::type>
+    iterator_base(const iterator_base<OtherConst> &other) noexcept : m_vector(other.m_vector), m_index(other.m_index) {}
+
+    reference operator*() const noexcept { return (*m_vector)[m_index]; }
+    pointer operator->() const noexcept { return &(*m_vector)[m_index]; }
+    reference operator[](difference_type n) const noexcept { return (*m_vector)[m_index + n]; }
+
+    iterator_base& operator++() noexcept { ++m_index; return *this; }
+    iterator_base operator++(int) noexcept { iterator_base old{ *this }; ++m_index; return old; }
+    iterator_base& operator--() noexcept { --m_index; return *this; }
+    iterator_base operator--(int) noexcept { iterator_base old{ *this }; --m_index; return old; }
+    iterator_base& operator+=(difference_type n) noexcept { m_index += n; return *this; }
+    iterator_base& operator-=(difference_type n) noexcept { m_index -= n; return *this; }
+    friend iterator_base operator+(iterator_base it, difference_type n) noexcept { return it += n; }
+    friend iterator_base operator+(difference_type n, iterator_base it) noexcept { return it += n; }
+    friend iterator_base operator-(iterator_base it, difference_type n) noexcept { return it -= n; }
+    friend difference_type operator-(const iterator_base &lhs, const iterator_base &rhs) noexcept {
+      return static_cast<difference_type>(lhs.m_index - rhs.m_index);
+    }
+
+    friend bool operator==(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index == rhs.m_index; }
+    friend bool operator!=(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index != rhs.m_index; }
+    friend bool operator<(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index < rhs.m_index; }
+    friend bool operator>(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index > rhs.m_index; }
+    friend bool operator<=(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index <= rhs.m_index; }
+    friend bool operator>=(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index >= rhs.m_index; }
+
+  private:
+    iterator_base(container *vector, size_type index) noexcept : m_vector(vector), m_index(index) {}
+
+    container *m_vector{ nullptr };
+    size_type m_index{ 0 };
+  };
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  segmented_vector<T, Alloc, BlockSize>::segmented_vector(const allocator_type &alloc)
+    : allocator_holder(alloc), m_blocks(typename Alloc::template rebind<T*>(alloc)) {
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  segmented_vector<T, Alloc, BlockSize>::segmented_vector(size_type n, const T &val, const allocator_type &alloc)
+    : segmented_vector(alloc) {
+    assign(n, val);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  template<typename InputIterator, typename>
+  segmented_vector<T, Alloc, BlockSize>::segmented_vector(InputIterator first, InputIterator last, const allocator_type &alloc)
+    : segmented_vector(alloc) {
+    assign(first, last);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  segmented_vector<T, Alloc, BlockSize>::segmented_vector(::std::initializer_list<T> il, const allocator_type &alloc)
+    : segmented_vector(alloc) {
+    assign(il);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  segmented_vector<T, Alloc, BlockSize>::segmented_vector(const segmented_vector &other)
+    : segmented_vector(other.get_allocator()) {
+    assign(other.begin(), other.end());
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  segmented_vector<T, Alloc, BlockSize>::segmented_vector(segmented_vector &&other) noexcept
+    : segmented_vector(other.get_allocator()) {
+    swap(other);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  segmented_vector<T, Alloc, BlockSize>::~segmented_vector() {
+    destroy_from(0);
+    release_blocks(0);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  segmented_vector<T, Alloc, BlockSize>& segmented_vector<T, Alloc, BlockSize>::operator=(const segmented_vector &other) {
+    if (this != &other) {
+      assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  segmented_vector<T, Alloc, BlockSize>& segmented_vector<T, Alloc, BlockSize>::operator=(segmented_vector &&other) noexcept {
+    if (this != &other) {
+      destroy_from(0);
+      release_blocks(0);
+      swap(other);
+    }
+    return *this;
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  segmented_vector<T, Alloc, BlockSize>& segmented_vector<T, Alloc, BlockSize>::operator=(::std::initializer_list<T> il) {
+    assign(il);
+    return *this;
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  template<typename InputIterator, typename>
+  void segmented_vector<T, Alloc, BlockSize>::assign(InputIterator first, InputIterator last) {
+    clear();
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  void segmented_vector<T, Alloc, BlockSize>::assign(size_type n, const T &val) {
+    clear();
+    resize(n, val);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  typename segmented_vector<T, Alloc, BlockSize>::reference segmented_vector<T, Alloc, BlockSize>::at(size_type n) noexcept {
+    assert(n < size());
+    return (*this)[n];
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  typename segmented_vector<T, Alloc, BlockSize>::const_reference segmented_vector<T, Alloc, BlockSize>::at(size_type n) const noexcept {
+    assert(n < size());
+    return (*this)[n];
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  span<T> segmented_vector<T, Alloc, BlockSize>::block(size_type k) noexcept {
+    assert(k < block_count());
+    const size_type count{ k + 1 < block_count() ? block_size : m_size - k * block_size };
+    return span<T>{ m_blocks[k], count };
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  span<const T> segmented_vector<T, Alloc, BlockSize>::block(size_type k) const noexcept {
+    assert(k < block_count());
+    const size_type count{ k + 1 < block_count() ? block_size : m_size - k * block_size };
+    return span<const T>{ m_blocks[k], count };
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  template<typename Function>
+  void segmented_vector<T, Alloc, BlockSize>::for_each_block(Function function) {
+    const size_type blocks{ block_count() };
+    for (size_type k{ 0 }; k < blocks; ++k) {
+      span<T> elements{ block(k) };
+      function(elements.begin(), elements.end());
+    }
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  template<typename Function>
+  void segmented_vector<T, Alloc, BlockSize>::for_each_block(Function function) const {
+    const size_type blocks{ block_count() };
+    for (size_type k{ 0 }; k < blocks; ++k) {
+      span<const T> elements{ block(k) };
+      function(elements.begin(), elements.end());
+    }
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  template<typename... Args>
+  typename segmented_vector<T, Alloc, BlockSize>::reference segmented_vector<T, Alloc, BlockSize>::emplace_back(Args&&... args) {
+    if (m_size == capacity()) {
+      reserve(m_size + 1);
+    }
+    T *dest{ m_blocks[m_size / block_size] + m_size % block_size };
+    allocator_ref().construct(dest, ::std::forward<Args>(args)...);
+    ++m_size;
+    return *dest;
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  void segmented_vector<T, Alloc, BlockSize>::pop_back() {
+    assert(!empty());
+    destroy_from(m_size - 1);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  template<typename Append>
+  typename segmented_vector<T, Alloc, BlockSize>::iterator segmented_vector<T, Alloc, BlockSize>::insert_by_rotation(size_type index, Append append) {
+    const size_type old_size{ m_size };
+    // Building the new elements at the back first keeps arguments which alias elements valid until they are copied.
+    try {
+      append();
+    }
+    catch (...) {
+      destroy_from(old_size);
+      throw;
+    }
+    ::std::rotate(begin() + static_cast<difference_type>(index), begin() + static_cast<difference_type>(old_size), end());
+    return begin() + static_cast<difference_type>(index);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  template<typename... Args>
+  typename segmented_vector<T, Alloc, BlockSize>::iterator segmented_vector<T, Alloc, BlockSize>::emplace(const_iterator position, Args&&... args) {
+    return insert_by_rotation(position.m_index, [&] { emplace_back(::std::forward<Args>(args)...); });
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  typename segmented_vector<T, Alloc, BlockSize>::iterator segmented_vector<T, Alloc, BlockSize>::insert(const_iterator position, const T &val) {
+    return emplace(position, val);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  typename segmented_vector<T, Alloc, BlockSize>::iterator segmented_vector<T, Alloc, BlockSize>::insert(const_iterator position, T &&val) {
+    return emplace(position, ::std::move(val));
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  typename segmented_vector<T, Alloc, BlockSize>::iterator segmented_vector<T, Alloc, BlockSize>::insert(const_iterator position, size_type n, const T &val) {
+    return insert_by_rotation(position.m_index, [&] {
+      append_chunks(n, [&](T *dest, size_type count) { detail::uninitialized_fill(allocator_ref(), dest, count, val); });
+    });
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  template<typename InputIterator, typename>
+  typename segmented_vector<T, Alloc, BlockSize>::iterator segmented_vector<T, Alloc, BlockSize>::insert(const_iterator position, InputIterator first, InputIterator last) {
+    return insert_by_rotation(position.m_index, [&] {
+      for (; first != last; ++first) {
+        emplace_back(*first);
+      }
+    });
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  typename segmented_vector<T, Alloc, BlockSize>::iterator segmented_vector<T, Alloc, BlockSize>::erase(const_iterator position) {
+    return erase(position, position + 1);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  typename segmented_vector<T, Alloc, BlockSize>::iterator segmented_vector<T, Alloc, BlockSize>::erase(const_iterator first, const_iterator last) {
+    const iterator dest{ this, first.m_index };
+    if (first != last) {
+      const iterator tail{ ::std::move(iterator{ this, last.m_index }, end(), dest) };
+      destroy_from(tail.m_index);
+    }
+    return dest;
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  void segmented_vector<T, Alloc, BlockSize>::clear() noexcept {
+    destroy_from(0);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  void segmented_vector<T, Alloc, BlockSize>::swap(segmented_vector &other) noexcept {
+    using ::std::swap;
+    swap(allocator_ref(), other.allocator_ref());
+    m_blocks.swap(other.m_blocks);
+    swap(m_size, other.m_size);
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  void segmented_vector<T, Alloc, BlockSize>::resize(size_type elements) {
+    if (elements <= m_size) {
+      destroy_from(elements);
+      return;
+    }
+    append_chunks(elements - m_size, [this](T *dest, size_type count) { detail::uninitialized_value_construct(allocator_ref(), dest, count); });
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  void segmented_vector<T, Alloc, BlockSize>::resize(size_type elements, const T &val) {
+    if (elements <= m_size) {
+      destroy_from(elements);
+      return;
+    }
+    append_chunks(elements - m_size, [&](T *dest, size_type count) { detail::uninitialized_fill(allocator_ref(), dest, count, val); });
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  void segmented_vector<T, Alloc, BlockSize>::reserve(size_type elements) {
+    const size_type blocks{ (elements + block_size - 1) / block_size };
+    if (blocks <= m_blocks.size()) return;
+    // Grow the table first, so pushing the pointers below cannot throw and leak a block.
+    m_blocks.reserve(blocks);
+    while (m_blocks.size() < blocks) {
+      m_blocks.push_back(allocator_ref().allocate(block_size));
+    }
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  void segmented_vector<T, Alloc, BlockSize>::shrink_to_fit() {
+    release_blocks(block_count());
+    m_blocks.shrink_to_fit();
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  template<typename Fill>
+  void segmented_vector<T, Alloc, BlockSize>::append_chunks(size_type n, Fill fill) {
+    reserve(m_size + n);
+    const size_type end{ m_size + n };
+    while (m_size < end) {
+      const size_type offset{ m_size % block_size };
+      const size_type count{ ::std::min(end - m_size, block_size - offset) };
+      fill(m_blocks[m_size / block_size] + offset, count);
+      m_size += count;
+    }
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  void segmented_vector<T, Alloc, BlockSize>::destroy_from(size_type first) noexcept {
+    while (m_size > first) {
+      const size_type last_block{ (m_size - 1) / block_size };
+      const size_type block_first{ ::std::max(first, last_block * block_size) };
+      T *block{ m_blocks[last_block] };
+      detail::destroy_range(allocator_ref(), block + block_first % block_size, block + (m_size - 1) % block_size + 1);
+      m_size = block_first;
+    }
+  }
+
+  template<typename T, typename Alloc, ::std::size_t BlockSize>
+  void segmented_vector<T, Alloc, BlockSize>::release_blocks(size_type first_block) noexcept {
+    while (m_blocks.size() > first_block) {
+      allocator_ref().deallocate(m_blocks.back(), block_size);
+      m_blocks.pop_back();
+    }
+  }
+
+} // namespace ftl
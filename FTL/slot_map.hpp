@@ -0,0 +1,229 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "vector.hpp" // ftl::vector, ftl::unordered_vector
+
+#include <cstdint> // uint32_t
+#include <cassert> // assert
+#include <utility> // forward, move
+
+namespace ftl {
+
+  // slot_map stores its values densely in an unordered_vector and hands out keys which stay valid until the value
+  // they refer to is erased, however many other values are inserted or erased in the meantime.
+  // A key names a slot, and the slot holds the current position of its value in the dense storage.
+  // Erased slots go on a free list for reuse, and every reuse bumps the slot's generation,
+  // so a key to an erased value is detected as stale rather than silently aliasing the new value.
+  // Insertion, erasure and lookup are all O(1), and iterating visits the values in contiguous memory.
+  // Generations are 32 bit, so a key can only alias a new value after one slot has been reused 2^32 times.
+  template<typename T, typename Alloc = default_allocator<T>>
+  class slot_map {
+  public:
+    struct key {
+      ::std::uint32_t index;
+      ::std::uint32_t generation;
+      friend bool operator==(const key &lhs, const key &rhs) noexcept { return lhs.index == rhs.index && lhs.generation == rhs.generation; }
+      friend bool operator!=(const key &lhs, const key &rhs) noexcept { return !(lhs == rhs); }
+    };
+
+    using value_type = T;
+    using allocator_type = Alloc;
+    using size_type = ::std::size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reference = T&;
+    using const_reference = const T&;
+
+    slot_map() = default;
+    explicit slot_map(const allocator_type &alloc);
+
+    // Inserts a value and returns the key to it.
+    key insert(const value_type &val);
+    key insert(value_type &&val);
+    template<typename... Args>
+    key emplace(Args&&... args);
+
+    // Erases the value k refers to. Returns false, and does nothing, if k is stale.
+    // The last value in the dense storage moves into the hole, so erasing invalidates iterators but never keys.
+    bool erase(key k);
+    // Erases every value and invalidates every key, keeping the storage.
+    void clear() noexcept;
+
+    // Returns the value k refers to, or nullptr if k is stale.
+    T* find(key k) noexcept;
+    const T* find(key k) const noexcept;
+    bool contains(key k) const noexcept;
+    // k must not be stale.
+    reference operator[](key k) noexcept;
+    const_reference operator[](key k) const noexcept;
+    // The key of a value found by iterating.
+    key key_of(const_iterator position) const noexcept;
+
+    iterator begin() noexcept { return m_values.begin(); }
+    iterator end() noexcept { return m_values.end(); }
+    const_iterator begin() const noexcept { return m_values.begin(); }
+    const_iterator end() const noexcept { return m_values.end(); }
+    const_iterator cbegin() const noexcept { return m_values.cbegin(); }
+    const_iterator cend() const noexcept { return m_values.cend(); }
+    T* data() noexcept { return m_values.data(); }
+    const T* data() const noexcept { return m_values.data(); }
+
+    size_type size() const noexcept { return m_values.size(); }
+    bool empty() const noexcept { return m_values.empty(); }
+    // Makes room for n values, so inserting up to n values allocates nothing.
+    void reserve(size_type n);
+    allocator_type get_allocator() const noexcept { return m_values.get_allocator(); }
+
+  private:
+    // An occupied slot holds the dense position of its value. A free slot holds the next free slot instead.
+    struct slot {
+      ::std::uint32_t index;
+      ::std::uint32_t generation;
+    };
+    static constexpr ::std::uint32_t end_of_free_list{ 0xFFFFFFFFu };
+
+    using slot_allocator = typename Alloc::template rebind<slot>;
+    using index_allocator = typename Alloc::template rebind<::std::uint32_t>;
+
+    // Takes a slot for the value just appended to the dense storage. Nothing changes if this throws.
+    key claim_slot();
+    bool is_live(key k) const noexcept;
+
+    unordered_vector<T, Alloc> m_values;
+    // The slot of every value, in dense order.
+    vector<::std::uint32_t, index_allocator> m_value_slots;
+    vector<slot, slot_allocator> m_slots;
+    ::std::uint32_t m_free_head{ end_of_free_list };
+  };
+
+  template<typename T, typename Alloc>
+  slot_map<T, Alloc>::slot_map(const allocator_type &alloc)
+    : m_values(alloc)
+    , m_value_slots(index_allocator(alloc))
+    , m_slots(slot_allocator(alloc)) {
+  }
+
+  template<typename T, typename Alloc>
+  typename slot_map<T, Alloc>::key slot_map<T, Alloc>::insert(const value_type &val) {
+    return emplace(val);
+  }
+
+  template<typename T, typename Alloc>
+  typename slot_map<T, Alloc>::key slot_map<T, Alloc>::insert(value_type &&val) {
+    return emplace(::std::move(val));
+  }
+
+  template<typename T, typename Alloc>
+  template<typename... Args>
+  typename slot_map<T, Alloc>::key slot_map<T, Alloc>::emplace(Args&&... args) {
+    m_values.emplace_back(::std::forward<Args>(args)...);
+    try {
+      return claim_slot();
+    }
+    catch (...) {
+      m_values.pop_back();
+      throw;
+    }
+  }
+
+  template<typename T, typename Alloc>
+  typename slot_map<T, Alloc>::key slot_map<T, Alloc>::claim_slot() {
+    const bool reuse{ m_free_head != end_of_free_list };
+    const ::std::uint32_t slot_index{ reuse ? m_free_head : static_cast<::std::uint32_t>(m_slots.size()) };
+    assert(slot_index != end_of_free_list && "slot_map is out of slots.");
+    m_value_slots.push_back(slot_index);
+    if (reuse) {
+      m_free_head = m_slots[slot_index].index;
+    }
+    else {
+      try {
+        // Generations start at 1, so a zeroed key never refers to anything.
+        m_slots.push_back(slot{ 0, 1 });
+      }
+      catch (...) {
+        m_value_slots.pop_back();
+        throw;
+      }
+    }
+    m_slots[slot_index].index = static_cast<::std::uint32_t>(m_values.size() - 1);
+    return key{ slot_index, m_slots[slot_index].generation };
+  }
+
+  template<typename T, typename Alloc>
+  bool slot_map<T, Alloc>::erase(key k) {
+    if (!is_live(k)) return false;
+    slot &erased{ m_slots[k.index] };
+    const ::std::uint32_t position{ erased.index };
+    // Mirror the unordered_vector erase: the last value moves into the hole, so its slot must follow it.
+    const ::std::uint32_t moved_slot{ m_value_slots.back() };
+    m_values.erase(m_values.begin() + position);
+    m_value_slots[position] = moved_slot;
+    m_slots[moved_slot].index = position;
+    m_value_slots.pop_back();
+    ++erased.generation;
+    erased.index = m_free_head;
+    m_free_head = k.index;
+    return true;
+  }
+
+  template<typename T, typename Alloc>
+  void slot_map<T, Alloc>::clear() noexcept {
+    for (::std::uint32_t slot_index : m_value_slots) {
+      slot &cleared{ m_slots[slot_index] };
+      ++cleared.generation;
+      cleared.index = m_free_head;
+      m_free_head = slot_index;
+    }
+    m_values.clear();
+    m_value_slots.clear();
+  }
+
+  template<typename T, typename Alloc>
+  bool slot_map<T, Alloc>::is_live(key k) const noexcept {
+    // A free slot's generation was bumped when it was freed and hasn't been handed out since,
+    // so matching the generation is enough to know the slot is occupied by the value the key was made for.
+    return k.index < m_slots.size() && m_slots[k.index].generation == k.generation;
+  }
+
+  template<typename T, typename Alloc>
+  T* slot_map<T, Alloc>::find(key k) noexcept {
+    return is_live(k) ? m_values.data() + m_slots[k.index].index : nullptr;
+  }
+
+  template<typename T, typename Alloc>
+  const T* slot_map<T, Alloc>::find(key k) const noexcept {
+    return is_live(k) ? m_values.data() + m_slots[k.index].index : nullptr;
+  }
+
+  template<typename T, typename Alloc>
+  bool slot_map<T, Alloc>::contains(key k) const noexcept {
+    return is_live(k);
+  }
+
+  template<typename T, typename Alloc>
+  typename slot_map<T, Alloc>::reference slot_map<T, Alloc>::operator[](key k) noexcept {
+    assert(is_live(k) && "Stale slot_map key.");
+    return m_values[m_slots[k.index].index];
+  }
+
+  template<typename T, typename Alloc>
+  typename slot_map<T, Alloc>::const_reference slot_map<T, Alloc>::operator[](key k) const noexcept {
+    assert(is_live(k) && "Stale slot_map key.");
+    return m_values[m_slots[k.index].index];
+  }
+
+  template<typename T, typename Alloc>
+  typename slot_map<T, Alloc>::key slot_map<T, Alloc>::key_of(const_iterator position) const noexcept {
+    const ::std::uint32_t slot_index{ m_value_slots[static_cast<size_type>(position - m_values.cbegin())] };
+    return key{ slot_index, m_slots[slot_index].generation };
+  }
+
+  template<typename T, typename Alloc>
+  void slot_map<T, Alloc>::reserve(size_type n) {
+    m_values.reserve(n);
+    m_value_slots.reserve(n);
+    m_slots.reserve(n);
+  }
+
+} // namespace ftl
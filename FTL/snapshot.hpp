@@ -0,0 +1,503 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "vector.hpp" // ftl::vector, append_uninitialized
+
+#include <cassert> // assert
+#include <cerrno> // errno, EINTR
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t, uint64_t, int64_t
+#include <cstring> // memcpy, memcmp
+#include <stdexcept> // runtime_error
+#include <string> // basic_string
+#include <system_error> // system_error, generic_category
+#include <type_traits> // is_trivially_copyable, is_trivially_default_constructible, aligned_storage
+
+// Snapshots are written and read through POSIX file descriptors, so they are only available where those are.
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h> // off_t, ssize_t
+#include <sys/uio.h> // writev, iovec
+#include <unistd.h> // read, write, pread, pwrite
+#define FTL_HAS_SNAPSHOT 1
+#else
+#define FTL_HAS_SNAPSHOT 0
+#endif
+
+#if FTL_HAS_SNAPSHOT
+namespace ftl {
+
+  // Binary snapshots of vectors, for checkpoints on disk or through pipes.
+  // A snapshot is a 32 byte header followed by the elements. The header holds a magic number, the format version,
+  // a byte order tag, sizeof the element type, how the elements are encoded and their count.
+  // Elements which are trivially copyable and trivially default constructible are stored as their raw bytes: saving
+  // hands data() to writev along with the header, and loading reads straight into the vector's reserved capacity,
+  // so neither touches the elements one by one. The snapshot can only be loaded by a build with the same layout of
+  // T and byte order, which loading checks.
+  // Other element types are encoded one by one through snapshot_traits<T> (see below), into frames of at most
+  // the buffer size, each preceded by its length. Frames let a reader stop exactly at the end of a snapshot, so
+  // several snapshots can follow each other in one pipe.
+  // snapshot_writer and snapshot_reader also work a chunk at a time, for data sets larger than memory.
+  // I/O errors are thrown as std::system_error, and malformed or mismatched snapshots as std::runtime_error.
+
+  class snapshot_writer;
+  class snapshot_reader;
+
+  // The per-element customization point. Specializations provide
+  //   static void write(snapshot_writer &out, const T &value);
+  //   static T read(snapshot_reader &in);
+  // writing the value with out.write_bytes or out.write, and reading it back in the same order.
+  // The primary template copies the bytes of trivially copyable types.
+  template<typename T, typename = void>
+  struct snapshot_traits {
+    static_assert(::std::is_trivially_copyable<T>::value, "Specialize ftl::snapshot_traits to snapshot this type.");
+    static void write(snapshot_writer &out, const T &value);
+    static T read(snapshot_reader &in);
+  };
+
+  namespace detail {
+    struct snapshot_header {
+      char magic[8];
+      ::std::uint32_t version;
+      ::std::uint32_t byte_order;
+      ::std::uint32_t element_size;
+      ::std::uint32_t encoding;
+      ::std::uint64_t count;
+    };
+    static_assert(sizeof(snapshot_header) == 32, "The snapshot header must not have padding.");
+
+    constexpr char snapshot_magic[8]{ 'F', 'T', 'L', 'S', 'N', 'A', 'P', 0 };
+    constexpr ::std::uint32_t snapshot_version{ 1 };
+    // Reads back as a different value on a machine of the other byte order.
+    constexpr ::std::uint32_t snapshot_byte_order{ 0x01020304 };
+    enum snapshot_encoding : ::std::uint32_t { raw_encoding = 1, element_encoding = 2 };
+
+    template<typename T>
+    struct is_raw_snapshot : ::std::integral_constant<bool, ::std::is_trivially_copyable<T>::value
+      && ::std::is_trivially_default_constructible<T>::value> {};
+
+    [[noreturn]] inline void throw_io_error(const char *what) {
+      throw ::std::system_error{ errno, ::std::generic_category(), what };
+    }
+
+    // Reads and writes whole byte ranges on a file descriptor, retrying partial transfers and EINTR.
+    // With a negative offset it uses the file position, which works on pipes; otherwise it uses pread and pwrite
+    // from offset on, leaving the file position alone.
+    class fd_channel {
+    public:
+      fd_channel(int fd, ::std::int64_t offset) noexcept : m_fd{ fd }, m_offset{ offset } {}
+
+      ::std::int64_t offset() const noexcept { return m_offset; }
+
+      void write(iovec *iov, int count) {
+        while (count > 0) {
+          const ssize_t written{ write_some(iov, count) };
+          if (written < 0) {
+            if (errno == EINTR) continue;
+            throw_io_error("snapshot: write failed");
+          }
+          if (m_offset >= 0) m_offset += written;
+          // Skip the fully written buffers and trim the first partial one.
+          ::std::size_t left{ static_cast<::std::size_t>(written) };
+          while (count > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            ++iov;
+            --count;
+          }
+          if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+            iov->iov_len -= left;
+          }
+        }
+      }
+
+      void read(void *dest, ::std::size_t bytes) {
+        char *out{ static_cast<char*>(dest) };
+        while (bytes > 0) {
+          const ssize_t got{ m_offset >= 0 ? ::pread(m_fd, out, bytes, static_cast<off_t>(m_offset)) : ::read(m_fd, out, bytes) };
+          if (got < 0) {
+            if (errno == EINTR) continue;
+            throw_io_error("snapshot: read failed");
+          }
+          if (got == 0) throw ::std::runtime_error{ "snapshot: unexpected end of data" };
+          if (m_offset >= 0) m_offset += got;
+          out += got;
+          bytes -= static_cast<::std::size_t>(got);
+        }
+      }
+
+    private:
+      ssize_t write_some(const iovec *iov, int count) noexcept {
+        if (m_offset < 0) return ::writev(m_fd, iov, count);
+        // Positional writes go one buffer at a time; the loop above picks up where this stopped.
+        const ssize_t written{ ::pwrite(m_fd, iov->iov_base, iov->iov_len, static_cast<off_t>(m_offset)) };
+        return written;
+      }
+
+      int m_fd;
+      ::std::int64_t m_offset;
+    };
+  } // namespace detail
+
+  // Writes snapshots to a file descriptor. Several snapshots may be written one after the other.
+  class snapshot_writer {
+  public:
+    static constexpr ::std::size_t default_buffer_size{ ::std::size_t{ 1 } << 20 };
+
+    // With a negative offset the writer writes at the file position, which also works on pipes and sockets.
+    // Otherwise it writes from offset on with pwrite, without moving the file position.
+    // buffer_size bounds the frames of elements encoded one by one.
+    explicit snapshot_writer(int fd, ::std::int64_t offset = -1, ::std::size_t buffer_size = default_buffer_size)
+      : m_channel{ fd, offset }, m_buffer_size{ buffer_size } {
+      assert(buffer_size > 0 && buffer_size <= ::std::uint32_t(-1));
+    }
+
+    // Writes c as one snapshot.
+    template<typename Container>
+    void save(const Container &c);
+
+    // Starts a snapshot of count elements of type T, which append must then supply in total before finish.
+    template<typename T>
+    void begin(::std::size_t count);
+    template<typename T>
+    void append(const T *first, ::std::size_t n);
+    void finish();
+
+    // For snapshot_traits: encodes the bytes of the current element.
+    void write_bytes(const void *p, ::std::size_t bytes);
+    template<typename T>
+    void write(const T &value) { snapshot_traits<T>::write(*this, value); }
+
+    // The offset the next snapshot will be written at, for a positional writer.
+    ::std::int64_t offset() const noexcept { return m_channel.offset(); }
+
+  private:
+    template<typename T>
+    void append(const T *first, ::std::size_t n, ::std::true_type);
+    template<typename T>
+    void append(const T *first, ::std::size_t n, ::std::false_type);
+    // Writes out the buffer, closing the open frame first if there is one.
+    void flush();
+
+    detail::fd_channel m_channel;
+    ::std::size_t m_buffer_size;
+    vector<char> m_buffer;
+    // Where the length of the open frame goes in the buffer, or npos.
+    ::std::size_t m_frame{ npos };
+    ::std::uint64_t m_remaining{ 0 };
+    bool m_elementwise{ false };
+    static constexpr ::std::size_t npos{ ::std::size_t(-1) };
+  };
+
+  // Reads snapshots from a file descriptor, never past the end of the snapshot being read.
+  class snapshot_reader {
+  public:
+    // Reads at the file position with a negative offset, and from offset on with pread otherwise.
+    explicit snapshot_reader(int fd, ::std::int64_t offset = -1) : m_channel{ fd, offset } {}
+
+    // Replaces the contents of c with the next snapshot.
+    template<typename Container>
+    void load(Container &c);
+
+    // Reads the header of a snapshot of T and returns its element count.
+    template<typename T>
+    ::std::size_t begin();
+    // Appends up to n more elements of the snapshot to c and returns how many.
+    template<typename Container>
+    ::std::size_t read(Container &c, ::std::size_t n);
+    ::std::size_t remaining() const noexcept { return static_cast<::std::size_t>(m_remaining); }
+    // Checks the snapshot ended where its header said it would.
+    void finish();
+
+    // For snapshot_traits: decodes the bytes of the current element.
+    void read_bytes(void *dest, ::std::size_t bytes);
+    template<typename T>
+    T read() { return snapshot_traits<T>::read(*this); }
+
+    ::std::int64_t offset() const noexcept { return m_channel.offset(); }
+
+  private:
+    template<typename Container>
+    ::std::size_t read(Container &c, ::std::size_t n, ::std::true_type);
+    template<typename Container>
+    ::std::size_t read(Container &c, ::std::size_t n, ::std::false_type);
+    ::std::uint32_t read_frame_length();
+
+    detail::fd_channel m_channel;
+    vector<char> m_buffer;
+    ::std::size_t m_position{ 0 };
+    ::std::uint64_t m_remaining{ 0 };
+    bool m_elementwise{ false };
+  };
+
+  template<typename T, typename Enable>
+  void snapshot_traits<T, Enable>::write(snapshot_writer &out, const T &value) {
+    out.write_bytes(&value, sizeof(T));
+  }
+
+  template<typename T, typename Enable>
+  T snapshot_traits<T, Enable>::read(snapshot_reader &in) {
+    typename ::std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    in.read_bytes(&storage, sizeof(T));
+    return *reinterpret_cast<T*>(&storage);
+  }
+
+  // Strings are stored as their length and characters.
+  template<typename Char, typename Traits, typename Alloc>
+  struct snapshot_traits<::std::basic_string<Char, Traits, Alloc>> {
+    static void write(snapshot_writer &out, const ::std::basic_string<Char, Traits, Alloc> &value) {
+      out.write(static_cast<::std::uint64_t>(value.size()));
+      out.write_bytes(value.data(), value.size() * sizeof(Char));
+    }
+    static ::std::basic_string<Char, Traits, Alloc> read(snapshot_reader &in) {
+      ::std::basic_string<Char, Traits, Alloc> value(static_cast<::std::size_t>(in.read<::std::uint64_t>()), Char{});
+      in.read_bytes(&value[0], value.size() * sizeof(Char));
+      return value;
+    }
+  };
+
+  // Nested vectors are stored as their size and elements.
+  template<typename T, typename Alloc, typename Growth>
+  struct snapshot_traits<vector<T, Alloc, Growth>> {
+    static void write(snapshot_writer &out, const vector<T, Alloc, Growth> &value) {
+      out.write(static_cast<::std::uint64_t>(value.size()));
+      for (const T &element : value) out.write(element);
+    }
+    static vector<T, Alloc, Growth> read(snapshot_reader &in) {
+      vector<T, Alloc, Growth> value;
+      const ::std::size_t count{ static_cast<::std::size_t>(in.read<::std::uint64_t>()) };
+      value.reserve(count);
+      for (::std::size_t i{ 0 }; i < count; ++i) value.push_back(in.read<T>());
+      return value;
+    }
+  };
+
+  template<typename Container>
+  void snapshot_writer::save(const Container &c) {
+    using T = typename Container::value_type;
+    begin<T>(c.size());
+    append(c.data(), c.size());
+    finish();
+  }
+
+  template<typename T>
+  void snapshot_writer::begin(::std::size_t count) {
+    assert(m_remaining == 0 && m_buffer.empty());
+    detail::snapshot_header header;
+    ::std::memcpy(header.magic, detail::snapshot_magic, sizeof(header.magic));
+    header.version = detail::snapshot_version;
+    header.byte_order = detail::snapshot_byte_order;
+    header.element_size = static_cast<::std::uint32_t>(sizeof(T));
+    m_elementwise = !detail::is_raw_snapshot<T>::value;
+    header.encoding = m_elementwise ? detail::element_encoding : detail::raw_encoding;
+    header.count = count;
+    // The header waits in the buffer, to go out with the first elements.
+    const char *bytes{ reinterpret_cast<const char*>(&header) };
+    m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(header));
+    m_remaining = count;
+  }
+
+  template<typename T>
+  void snapshot_writer::append(const T *first, ::std::size_t n) {
+    assert(n <= m_remaining && m_elementwise == !detail::is_raw_snapshot<T>::value);
+    append(first, n, detail::is_raw_snapshot<T>{});
+    m_remaining -= n;
+  }
+
+  template<typename T>
+  void snapshot_writer::append(const T *first, ::std::size_t n, ::std::true_type) {
+    // Whatever is buffered and the elements go out in one writev, without copying the elements.
+    iovec iov[2];
+    int count{ 0 };
+    if (!m_buffer.empty()) {
+      iov[count++] = iovec{ m_buffer.data(), m_buffer.size() };
+    }
+    if (n) {
+      iov[count++] = iovec{ const_cast<T*>(first), n * sizeof(T) };
+    }
+    m_channel.write(iov, count);
+    m_buffer.clear();
+  }
+
+  template<typename T>
+  void snapshot_writer::append(const T *first, ::std::size_t n, ::std::false_type) {
+    for (const T *last{ first + n }; first != last; ++first) {
+      write(*first);
+    }
+  }
+
+  inline void snapshot_writer::write_bytes(const void *p, ::std::size_t bytes) {
+    assert(m_elementwise);
+    const char *in{ static_cast<const char*>(p) };
+    while (bytes > 0) {
+      if (m_frame == npos) {
+        m_frame = m_buffer.size();
+        m_buffer.insert(m_buffer.end(), sizeof(::std::uint32_t), 0);
+      }
+      const ::std::size_t frame_bytes{ m_buffer.size() - m_frame - sizeof(::std::uint32_t) };
+      const ::std::size_t limit{ m_buffer_size > frame_bytes ? m_buffer_size - frame_bytes : 0 };
+      const ::std::size_t n{ bytes < limit ? bytes : limit };
+      m_buffer.insert(m_buffer.end(), in, in + n);
+      in += n;
+      bytes -= n;
+      if (bytes > 0) flush();
+    }
+  }
+
+  inline void snapshot_writer::flush() {
+    if (m_frame != npos) {
+      const ::std::uint32_t length{ static_cast<::std::uint32_t>(m_buffer.size() - m_frame - sizeof(::std::uint32_t)) };
+      ::std::memcpy(m_buffer.data() + m_frame, &length, sizeof(length));
+      m_frame = npos;
+    }
+    if (m_buffer.empty()) return;
+    iovec iov{ m_buffer.data(), m_buffer.size() };
+    m_channel.write(&iov, 1);
+    m_buffer.clear();
+  }
+
+  inline void snapshot_writer::finish() {
+    assert(m_remaining == 0);
+    if (m_elementwise) {
+      flush();
+      // An empty frame ends the elements.
+      m_buffer.insert(m_buffer.end(), sizeof(::std::uint32_t), 0);
+    }
+    flush();
+    m_elementwise = false;
+  }
+
+  template<typename Container>
+  void snapshot_reader::load(Container &c) {
+    using T = typename Container::value_type;
+    const ::std::size_t count{ begin<T>() };
+    c.clear();
+    c.reserve(count);
+    read(c, count);
+    finish();
+  }
+
+  template<typename T>
+  ::std::size_t snapshot_reader::begin() {
+    assert(m_remaining == 0);
+    detail::snapshot_header header;
+    m_channel.read(&header, sizeof(header));
+    if (::std::memcmp(header.magic, detail::snapshot_magic, sizeof(header.magic)) != 0) {
+      throw ::std::runtime_error{ "snapshot: the data is not a snapshot" };
+    }
+    if (header.byte_order != detail::snapshot_byte_order) throw ::std::runtime_error{ "snapshot: the snapshot has the wrong byte order" };
+    if (header.version != detail::snapshot_version) throw ::std::runtime_error{ "snapshot: unsupported snapshot version" };
+    m_elementwise = !detail::is_raw_snapshot<T>::value;
+    const ::std::uint32_t encoding{ m_elementwise ? detail::element_encoding : detail::raw_encoding };
+    if (header.element_size != sizeof(T) || header.encoding != encoding) {
+      throw ::std::runtime_error{ "snapshot: the snapshot holds a different element type" };
+    }
+    m_remaining = header.count;
+    m_buffer.clear();
+    m_position = 0;
+    return static_cast<::std::size_t>(header.count);
+  }
+
+  template<typename Container>
+  ::std::size_t snapshot_reader::read(Container &c, ::std::size_t n) {
+    using T = typename Container::value_type;
+    assert(m_elementwise == !detail::is_raw_snapshot<T>::value);
+    if (n > m_remaining) n = static_cast<::std::size_t>(m_remaining);
+    read(c, n, detail::is_raw_snapshot<T>{});
+    m_remaining -= n;
+    return n;
+  }
+
+  template<typename Container>
+  ::std::size_t snapshot_reader::read(Container &c, ::std::size_t n, ::std::true_type) {
+    using T = typename Container::value_type;
+    if (n == 0) return 0;
+    T *dest{ c.append_uninitialized(n) };
+    try {
+      m_channel.read(dest, n * sizeof(T));
+    }
+    catch (...) {
+      c.resize(c.size() - n);
+      throw;
+    }
+    return n;
+  }
+
+  template<typename Container>
+  ::std::size_t snapshot_reader::read(Container &c, ::std::size_t n, ::std::false_type) {
+    using T = typename Container::value_type;
+    for (::std::size_t i{ 0 }; i < n; ++i) {
+      c.push_back(read<T>());
+    }
+    return n;
+  }
+
+  inline ::std::uint32_t snapshot_reader::read_frame_length() {
+    ::std::uint32_t length;
+    m_channel.read(&length, sizeof(length));
+    return length;
+  }
+
+  inline void snapshot_reader::read_bytes(void *dest, ::std::size_t bytes) {
+    assert(m_elementwise);
+    char *out{ static_cast<char*>(dest) };
+    while (bytes > 0) {
+      if (m_position == m_buffer.size()) {
+        const ::std::uint32_t length{ read_frame_length() };
+        if (length == 0) throw ::std::runtime_error{ "snapshot: the elements end early" };
+        m_buffer.clear();
+        m_channel.read(m_buffer.append_uninitialized(length), length);
+        m_position = 0;
+      }
+      const ::std::size_t available{ m_buffer.size() - m_position };
+      const ::std::size_t n{ bytes < available ? bytes : available };
+      ::std::memcpy(out, m_buffer.data() + m_position, n);
+      m_position += n;
+      out += n;
+      bytes -= n;
+    }
+  }
+
+  inline void snapshot_reader::finish() {
+    assert(m_remaining == 0);
+    if (m_elementwise) {
+      if (m_position != m_buffer.size() || read_frame_length() != 0) {
+        throw ::std::runtime_error{ "snapshot: the elements run past their count" };
+      }
+      m_buffer.clear();
+      m_position = 0;
+    }
+    m_elementwise = false;
+  }
+
+  // Writes c to fd as one snapshot, at the file position.
+  template<typename Container>
+  void save(int fd, const Container &c) {
+    snapshot_writer{ fd }.save(c);
+  }
+
+  // Writes c to fd as one snapshot at offset, and returns the offset just past it.
+  template<typename Container>
+  ::std::int64_t save_at(int fd, ::std::int64_t offset, const Container &c) {
+    snapshot_writer out{ fd, offset };
+    out.save(c);
+    return out.offset();
+  }
+
+  // Replaces the contents of c with the snapshot at the file position of fd.
+  template<typename Container>
+  void load(int fd, Container &c) {
+    snapshot_reader{ fd }.load(c);
+  }
+
+  // Replaces the contents of c with the snapshot at offset in fd, and returns the offset just past it.
+  template<typename Container>
+  ::std::int64_t load_at(int fd, ::std::int64_t offset, Container &c) {
+    snapshot_reader in{ fd, offset };
+    in.load(c);
+    return in.offset();
+  }
+
+} // namespace ftl
+
+#endif // FTL_HAS_SNAPSHOT
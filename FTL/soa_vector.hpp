@@ -0,0 +1,775 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "vector.hpp" // detail kernels, default_allocator, default_growth
+#include "span.hpp" // ftl::span
+
+#include <algorithm> // rotate
+#include <tuple> // tuple, get
+#include <utility> // index_sequence, swap
+#include <iterator> // random_access_iterator_tag, reverse_iterator, iterator_traits, distance
+#include <cstdint> // uintptr_t
+#include <initializer_list> // initializer_list
+
+namespace ftl {
+
+  // The reference type of a soa_vector iterator: a tuple of references to the fields of one element.
+  // Assigning to it assigns through to the fields, and swapping two of them swaps the elements they refer to,
+  // which is what lets std::sort and the other mutating algorithms work on the zipped iterators.
+  // It compares like the tuple of its fields, so the default ordering is lexicographic over the fields.
+  template<typename... Ts>
+  class soa_reference : public ::std::tuple<Ts&...> {
+    using base = ::std::tuple<Ts&...>;
+  public:
+    using value_type = ::std::tuple<Ts...>;
+
+    using base::base;
+    soa_reference(const soa_reference &) = default;
+
+    soa_reference& operator=(const soa_reference &other) {
+      base::operator=(other);
+      return *this;
+    }
+    soa_reference& operator=(soa_reference &&other) {
+      move_from(other, ::std::index_sequence_for<Ts...>{});
+      return *this;
+    }
+    soa_reference& operator=(const value_type &val) {
+      base::operator=(val);
+      return *this;
+    }
+    soa_reference& operator=(value_type &&val) {
+      base::operator=(::std::move(val));
+      return *this;
+    }
+
+    // Proxies are passed by value, as the algorithms swap the temporaries they get from dereferencing.
+    friend void swap(soa_reference lhs, soa_reference rhs) {
+      lhs.swap_with(rhs, ::std::index_sequence_for<Ts...>{});
+    }
+
+  private:
+    template<::std::size_t... I>
+    void move_from(soa_reference &other, ::std::index_sequence<I...>) {
+      int expand[] = { 0, (::std::get<I>(*this) = ::std::move(::std::get<I>(other)), 0)... };
+      (void)expand;
+    }
+    template<::std::size_t... I>
+    void swap_with(soa_reference &other, ::std::index_sequence<I...>) {
+      using ::std::swap;
+      int expand[] = { 0, (swap(::std::get<I>(*this), ::std::get<I>(other)), 0)... };
+      (void)expand;
+    }
+  };
+
+  // soa_vector stores a sequence of tuples as one array per field (structure of arrays), so a loop which reads only
+  // some of the fields only pulls those fields through the cache. All of the arrays share a single allocation,
+  // and each one starts on a cache line boundary, so the spans returned by get<I>() are ready for aligned SIMD loads.
+  // Elements are accessed through zipped iterators whose reference is a soa_reference proxy.
+  // It otherwise behaves like ftl::vector, reallocating through the growth policy and relocating each field, and
+  // propagating its allocator on copy, move and swap as the allocator's traits ask.
+  // Alloc is rebound to char for the shared buffer, and constructs and destroys the fields through its construct/destroy.
+  template<typename Alloc, typename Growth, typename... Ts>
+  class basic_soa_vector : private detail::allocator_holder<typename Alloc::template rebind<char>> {
+    static_assert(sizeof...(Ts) > 0, "A soa_vector needs at least one field.");
+    using allocator_holder = detail::allocator_holder<typename Alloc::template rebind<char>>;
+    template<bool Const>
+    class iterator_base;
+  public:
+    using value_type = ::std::tuple<Ts...>;
+    using allocator_type = typename Alloc::template rebind<char>;
+    using growth_policy = Growth;
+    using size_type = ::std::size_t;
+    using difference_type = ::std::ptrdiff_t;
+    using reference = soa_reference<Ts...>;
+    using const_reference = ::std::tuple<const Ts&...>;
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+    using reverse_iterator = ::std::reverse_iterator<iterator>;
+    using const_reverse_iterator = ::std::reverse_iterator<const_iterator>;
+    template<::std::size_t I>
+    using field_type = typename ::std::tuple_element<I, value_type>::type;
+    // Every field array starts on a boundary of this many bytes.
+    static constexpr size_type field_alignment{ 64 };
+
+    basic_soa_vector() = default;
+    explicit basic_soa_vector(const allocator_type &alloc);
+    basic_soa_vector(::std::initializer_list<value_type> il, const allocator_type &alloc = allocator_type{});
+    basic_soa_vector(const basic_soa_vector &other);
+    basic_soa_vector(basic_soa_vector &&other);
+    ~basic_soa_vector();
+
+    basic_soa_vector& operator=(const basic_soa_vector &other);
+    basic_soa_vector& operator=(basic_soa_vector &&other);
+
+    // iterators
+    iterator begin() noexcept { return iterator{ m_fields, 0 }; }
+    iterator end() noexcept { return iterator{ m_fields, static_cast<difference_type>(m_size) }; }
+    const_iterator begin() const noexcept { return const_iterator{ m_fields, 0 }; }
+    const_iterator end() const noexcept { return const_iterator{ m_fields, static_cast<difference_type>(m_size) }; }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() noexcept { return reverse_iterator{ end() }; }
+    reverse_iterator rend() noexcept { return reverse_iterator{ begin() }; }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator{ end() }; }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator{ begin() }; }
+    const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+    const_reverse_iterator crend() const noexcept { return rend(); }
+
+    // field access
+    // The array of field I, e.g. positions.get<0>() for every x coordinate.
+    template<::std::size_t I>
+    span<field_type<I>> get() noexcept { return span<field_type<I>>{ ::std::get<I>(m_fields), m_size }; }
+    template<::std::size_t I>
+    span<const field_type<I>> get() const noexcept { return span<const field_type<I>>{ ::std::get<I>(m_fields), m_size }; }
+    template<::std::size_t I>
+    field_type<I>* data() noexcept { return ::std::get<I>(m_fields); }
+    template<::std::size_t I>
+    const field_type<I>* data() const noexcept { return ::std::get<I>(m_fields); }
+
+    // element access
+    reference operator[](size_type n) noexcept { return begin()[n]; }
+    const_reference operator[](size_type n) const noexcept { return begin()[n]; }
+    reference at(size_type n) noexcept;
+    const_reference at(size_type n) const noexcept;
+    reference front() noexcept { return (*this)[0]; }
+    const_reference front() const noexcept { return (*this)[0]; }
+    reference back() noexcept { return (*this)[m_size - 1]; }
+    const_reference back() const noexcept { return (*this)[m_size - 1]; }
+
+    // modifiers
+    void assign(size_type n, const value_type &val);
+    template<typename InputIterator, typename = decltype(*::std::declval<InputIterator&>(), void(), ++::std::declval<InputIterator&>(), void())>
+    void assign(InputIterator first, InputIterator last);
+    void assign(::std::initializer_list<value_type> il);
+    void push_back(const value_type &val);
+    void push_back(value_type &&val);
+    // Constructs the fields of the new element from one argument each.
+    template<typename... Args>
+    void emplace_back(Args&&... args);
+    void pop_back();
+    iterator insert(const_iterator position, const value_type &val);
+    iterator insert(const_iterator position, size_type n, const value_type &val);
+    template<typename InputIterator, typename = decltype(*::std::declval<InputIterator&>(), void(), ++::std::declval<InputIterator&>(), void())>
+    iterator insert(const_iterator position, InputIterator first, InputIterator last);
+    iterator insert(const_iterator position, ::std::initializer_list<value_type> il);
+    // Constructs the fields of the new element from one argument each.
+    template<typename... Args>
+    iterator emplace(const_iterator position, Args&&... args);
+    iterator erase(const_iterator position);
+    iterator erase(const_iterator first, const_iterator last);
+    void clear() noexcept;
+    void swap(basic_soa_vector &other);
+
+    // capacity
+    size_type size() const noexcept { return m_size; }
+    size_type capacity() const noexcept { return m_capacity; }
+    size_type max_size() const noexcept;
+    bool empty() const noexcept { return m_size == 0; }
+    void resize(size_type elements);
+    void resize(size_type elements, const value_type &val);
+    void reserve(size_type elements);
+    void shrink_to_fit();
+
+    allocator_type get_allocator() const noexcept { return allocator_ref(); }
+
+  private:
+    using field_pointers = ::std::tuple<Ts*...>;
+    using indices = ::std::index_sequence_for<Ts...>;
+    using allocator_holder::allocator_ref;
+
+    // Calls function(std::integral_constant<size_t, I>{}) for every field I, in order.
+    template<typename Function, ::std::size_t... I>
+    static void for_each_field(Function &&function, ::std::index_sequence<I...>);
+    template<typename Function>
+    static void for_each_field(Function &&function) { for_each_field(::std::forward<Function>(function), indices{}); }
+
+    // The combined size of one element's fields.
+    static constexpr size_type row_bytes() noexcept { return sum_of({ sizeof(Ts)... }); }
+    static constexpr size_type sum_of(::std::initializer_list<size_type> sizes) noexcept {
+      size_type sum{ 0 };
+      for (size_type size : sizes) sum += size;
+      return sum;
+    }
+    static constexpr bool all_of(::std::initializer_list<bool> values) noexcept {
+      for (bool value : values) {
+        if (!value) return false;
+      }
+      return true;
+    }
+    // Reallocation moves the fields only if none of their moves can throw, and copies every copyable field
+    // otherwise: a field moved before another one's copy throws couldn't be restored.
+    static constexpr bool relocate_by_move{ all_of({ (::std::is_nothrow_move_constructible<Ts>::value || !::std::is_copy_constructible<Ts>::value)... }) };
+    // The size of the allocation holding `elements` of every field, including the slack for aligning the first array.
+    static size_type allocation_bytes(size_type elements) noexcept;
+    // Points every field at its array in the buffer.
+    static field_pointers carve(char *buffer, size_type elements) noexcept;
+    // Constructs the fields of a new element at index m_size with construct(field, destination), one field at a time.
+    template<typename Construct>
+    void construct_back(Construct construct);
+    template<typename Tuple>
+    void construct_back_from(Tuple &&args);
+    // Appends a copy of row, a tuple (of references) of the fields.
+    template<typename Row>
+    void append_row(const Row &row);
+    // Reserves room for n more elements through the growth policy, if they don't fit.
+    void reserve_more(size_type n);
+    template<typename InputIterator>
+    void reserve_range(InputIterator, InputIterator, ::std::input_iterator_tag) noexcept {}
+    template<typename ForwardIterator>
+    void reserve_range(ForwardIterator first, ForwardIterator last, ::std::forward_iterator_tag);
+    // Moves the elements appended after old_size to index, shifting the ones in between behind them.
+    void rotate_into_place(size_type index, size_type old_size);
+    void destroy_from(size_type first) noexcept;
+    void release() noexcept;
+    void reallocate(size_type elements);
+    // Constructs count elements of every field at dest from those at source, with construct(field, first, last, dest)
+    // for each field. If a field throws, the fields already constructed are destroyed again.
+    template<typename Construct>
+    void construct_fields(const field_pointers &source, size_type count, const field_pointers &dest, Construct construct);
+    // Moves or copies the elements for a reallocation, leaving the sources to be destroyed by the caller.
+    void relocate_fields(const field_pointers &source, size_type count, const field_pointers &dest);
+    // Replaces the elements with copies of other's.
+    void copy_elements(const basic_soa_vector &other);
+    // Takes the elements of other, which is left empty. Its buffer is taken over when this vector's allocator can
+    // free it, and otherwise the elements are relocated into a buffer from this vector's allocator.
+    // This vector must hold no buffer.
+    void take_elements(basic_soa_vector &other);
+
+    // Replaces the allocator with alloc, if the allocator propagates.
+    void propagate_allocator(const allocator_type &alloc, ::std::true_type) { allocator_ref() = alloc; }
+    void propagate_allocator(const allocator_type &, ::std::false_type) noexcept {}
+    void swap_allocators(basic_soa_vector &other, ::std::true_type) {
+      using ::std::swap;
+      swap(allocator_ref(), other.allocator_ref());
+    }
+    void swap_allocators(basic_soa_vector &, ::std::false_type) noexcept {}
+    using propagate_copy_tag = ::std::integral_constant<bool, detail::propagate_on_copy_assignment<allocator_type>::value>;
+    using propagate_move_tag = ::std::integral_constant<bool, detail::propagate_on_move_assignment<allocator_type>::value>;
+    using propagate_swap_tag = ::std::integral_constant<bool, detail::propagate_on_swap<allocator_type>::value>;
+
+    char *m_buffer{ nullptr };
+    field_pointers m_fields{};
+    size_type m_size{ 0 };
+    size_type m_capacity{ 0 };
+  };
+
+  template<typename... Ts>
+  using soa_vector = basic_soa_vector<default_allocator<char>, default_growth, Ts...>;
+
+  // The zipped iterator. It holds the field arrays and an index, so every field is addressed from one counter.
+  template<typename Alloc, typename Growth, typename... Ts>
+  template<bool Const>
+  class basic_soa_vector<Alloc, Growth, Ts...>::iterator_base {
+    friend class basic_soa_vector;
+    friend class iterator_base<!Const>;
+    using pointers = typename ::std::conditional<Const, ::std::tuple<const Ts*...>, ::std::tuple<Ts*...>>::type;
+  public:
+    using iterator_category = ::std::random_access_iterator_tag;
+    using value_type = ::std::tuple<Ts...>;
+    using difference_type = ::std::ptrdiff_t;
+    using reference = typename ::std::conditional<Const, ::std::tuple<const Ts&...>, soa_reference<Ts...>>::type;
+    // Elements are proxies, so there is nothing for operator-> to point to.
+    using pointer = void;
+
+    iterator_base() = default;
+    // iterator converts to const_iterator.
+    template<bool OtherConst, typename = typename ::std::enable_if<Const && !OtherConst>::type>
+    iterator_base(const iterator_base<OtherConst> &other) noexcept : m_fields(other.m_fields), m_index(other.m_index) {}
+
+    reference operator*() const noexcept { return dereference(m_index, indices{}); }
+    reference operator[](difference_type n) const noexcept { return dereference(m_index + n, indices{}); }
+
+    iterator_base& operator++() noexcept { ++m_index; return *this; }
+    iterator_base operator++(int) noexcept { iterator_base old{ *this }; ++m_index; return old; }
+    iterator_base& operator--() noexcept { --m_index; return *this; }
+    iterator_base operator--(int) noexcept { iterator_base old{ *this }; --m_index; return old; }
+    iterator_base& operator+=(difference_type n) noexcept { m_index += n; return *this; }
+    iterator_base& operator-=(difference_type n) noexcept { m_index -= n; return *this; }
+    friend iterator_base operator+(iterator_base it, difference_type n) noexcept { return it += n; }
+    friend iterator_base operator+(difference_type n, iterator_base it) noexcept { return it += n; }
+    friend iterator_base operator-(iterator_base it, difference_type n) noexcept { return it -= n; }
+    friend difference_type operator-(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index - rhs.m_index; }
+
+    friend bool operator==(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index == rhs.m_index; }
+    friend bool operator!=(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index != rhs.m_index; }
+    friend bool operator<(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index < rhs.m_index; }
+    friend bool operator>(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index > rhs.m_index; }
+    friend bool operator<=(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index <= rhs.m_index; }
+    friend bool operator>=(const iterator_base &lhs, const iterator_base &rhs) noexcept { return lhs.m_index >= rhs.m_index; }
+
+  private:
+    iterator_base(const pointers &fields, difference_type index) noexcept : m_fields(fields), m_index(index) {}
+    template<::std::size_t... I>
+    reference dereference(difference_type index, ::std::index_sequence<I...>) const noexcept {
+      return reference{ ::std::get<I>(m_fields)[index]... };
+    }
+
+    pointers m_fields{};
+    difference_type m_index{ 0 };
+  };
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  basic_soa_vector<Alloc, Growth, Ts...>::basic_soa_vector(const allocator_type &alloc)
+    : allocator_holder(alloc) {
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  basic_soa_vector<Alloc, Growth, Ts...>::basic_soa_vector(::std::initializer_list<value_type> il, const allocator_type &alloc)
+    : allocator_holder(alloc) {
+    reserve(il.size());
+    for (const value_type &val : il) {
+      push_back(val);
+    }
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  basic_soa_vector<Alloc, Growth, Ts...>::basic_soa_vector(const basic_soa_vector &other)
+    : allocator_holder(select_on_container_copy_construction(other.allocator_ref())) {
+    copy_elements(other);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  basic_soa_vector<Alloc, Growth, Ts...>::basic_soa_vector(basic_soa_vector &&other)
+    : allocator_holder(other.allocator_ref()) {
+    take_elements(other);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  basic_soa_vector<Alloc, Growth, Ts...>::~basic_soa_vector() {
+    release();
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  basic_soa_vector<Alloc, Growth, Ts...>& basic_soa_vector<Alloc, Growth, Ts...>::operator=(const basic_soa_vector &other) {
+    if (this != &other) {
+      // The buffer has to go before a propagating allocator which couldn't free it replaces the current one.
+      if (propagate_copy_tag::value && !allocators_equal(allocator_ref(), other.allocator_ref())) {
+        release();
+      }
+      propagate_allocator(other.allocator_ref(), propagate_copy_tag{});
+      copy_elements(other);
+    }
+    return *this;
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  basic_soa_vector<Alloc, Growth, Ts...>& basic_soa_vector<Alloc, Growth, Ts...>::operator=(basic_soa_vector &&other) {
+    if (this != &other) {
+      release();
+      propagate_allocator(other.allocator_ref(), propagate_move_tag{});
+      take_elements(other);
+    }
+    return *this;
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::copy_elements(const basic_soa_vector &other) {
+    clear();
+    reserve(other.m_size);
+    construct_fields(other.m_fields, other.m_size, m_fields, [&](auto, auto *first, auto *last, auto *dest) {
+      detail::uninitialized_copy(allocator_ref(), first, last, dest);
+    });
+    m_size = other.m_size;
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::take_elements(basic_soa_vector &other) {
+    assert(m_buffer == nullptr && m_capacity == 0);
+    if (allocators_equal(allocator_ref(), other.allocator_ref())) {
+      m_buffer = other.m_buffer;
+      m_fields = other.m_fields;
+      m_size = other.m_size;
+      m_capacity = other.m_capacity;
+      other.m_buffer = nullptr;
+      other.m_fields = field_pointers{};
+      other.m_size = 0;
+      other.m_capacity = 0;
+      return;
+    }
+    reserve(other.m_size);
+    relocate_fields(other.m_fields, other.m_size, m_fields);
+    m_size = other.m_size;
+    other.clear();
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  template<typename Function, ::std::size_t... I>
+  void basic_soa_vector<Alloc, Growth, Ts...>::for_each_field(Function &&function, ::std::index_sequence<I...>) {
+    int expand[] = { 0, (function(::std::integral_constant<::std::size_t, I>{}), 0)... };
+    (void)expand;
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::size_type basic_soa_vector<Alloc, Growth, Ts...>::allocation_bytes(size_type elements) noexcept {
+    const size_type sizes[] = { sizeof(Ts)... };
+    size_type bytes{ 0 };
+    for (size_type size : sizes) {
+      bytes = (bytes + field_alignment - 1) / field_alignment * field_alignment + size * elements;
+    }
+    // The allocator only guarantees fundamental alignment, so leave room to align the first array.
+    return bytes + field_alignment - 1;
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::field_pointers basic_soa_vector<Alloc, Growth, Ts...>::carve(char *buffer, size_type elements) noexcept {
+    field_pointers fields;
+    ::std::uintptr_t address{ reinterpret_cast<::std::uintptr_t>(buffer) };
+    for_each_field([&](auto field) {
+      constexpr ::std::size_t I{ decltype(field)::value };
+      static_assert(alignof(field_type<I>) <= field_alignment, "soa_vector fields must not be over-aligned.");
+      address = (address + field_alignment - 1) / field_alignment * field_alignment;
+      ::std::get<I>(fields) = reinterpret_cast<field_type<I>*>(address);
+      address += sizeof(field_type<I>) * elements;
+    });
+    return fields;
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  template<typename Construct>
+  void basic_soa_vector<Alloc, Growth, Ts...>::construct_back(Construct construct) {
+    if (m_size == m_capacity) {
+      size_type new_capacity{ growth_policy::next_capacity(m_capacity, m_size + 1, row_bytes()) };
+      if (new_capacity > max_size()) new_capacity = max_size();
+      reallocate(new_capacity);
+    }
+    size_type constructed_fields{ 0 };
+    try {
+      for_each_field([&](auto field) {
+        construct(field, ::std::get<decltype(field)::value>(m_fields) + m_size);
+        ++constructed_fields;
+      });
+    }
+    catch (...) {
+      for_each_field([&](auto field) {
+        if (decltype(field)::value < constructed_fields) {
+          allocator_ref().destroy(::std::get<decltype(field)::value>(m_fields) + m_size);
+        }
+      });
+      throw;
+    }
+    ++m_size;
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::assign(size_type n, const value_type &val) {
+    clear();
+    reserve(n);
+    for (size_type i{ 0 }; i < n; ++i) {
+      push_back(val);
+    }
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  template<typename InputIterator, typename>
+  void basic_soa_vector<Alloc, Growth, Ts...>::assign(InputIterator first, InputIterator last) {
+    clear();
+    reserve_range(first, last, typename ::std::iterator_traits<InputIterator>::iterator_category{});
+    for (; first != last; ++first) {
+      append_row(*first);
+    }
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::assign(::std::initializer_list<value_type> il) {
+    assign(il.begin(), il.end());
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::push_back(const value_type &val) {
+    construct_back([&](auto field, auto *dest) {
+      allocator_ref().construct(dest, ::std::get<decltype(field)::value>(val));
+    });
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::push_back(value_type &&val) {
+    construct_back([&](auto field, auto *dest) {
+      allocator_ref().construct(dest, ::std::get<decltype(field)::value>(::std::move(val)));
+    });
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  template<typename... Args>
+  void basic_soa_vector<Alloc, Growth, Ts...>::emplace_back(Args&&... args) {
+    static_assert(sizeof...(Args) == sizeof...(Ts), "soa_vector::emplace_back takes one argument per field.");
+    construct_back_from(::std::forward_as_tuple(::std::forward<Args>(args)...));
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  template<typename Tuple>
+  void basic_soa_vector<Alloc, Growth, Ts...>::construct_back_from(Tuple &&args) {
+    construct_back([&](auto field, auto *dest) {
+      allocator_ref().construct(dest, ::std::get<decltype(field)::value>(::std::move(args)));
+    });
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  template<typename Row>
+  void basic_soa_vector<Alloc, Growth, Ts...>::append_row(const Row &row) {
+    construct_back([&](auto field, auto *dest) {
+      allocator_ref().construct(dest, ::std::get<decltype(field)::value>(row));
+    });
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::reserve_more(size_type n) {
+    if (m_size + n > m_capacity) {
+      reserve(growth_policy::next_capacity(m_capacity, m_size + n, row_bytes()));
+    }
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  template<typename ForwardIterator>
+  void basic_soa_vector<Alloc, Growth, Ts...>::reserve_range(ForwardIterator first, ForwardIterator last, ::std::forward_iterator_tag) {
+    reserve_more(static_cast<size_type>(::std::distance(first, last)));
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::rotate_into_place(size_type index, size_type old_size) {
+    for_each_field([&](auto field) {
+      auto *array = ::std::get<decltype(field)::value>(m_fields);
+      ::std::rotate(array + index, array + old_size, array + m_size);
+    });
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::pop_back() {
+    destroy_from(m_size - 1);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::iterator basic_soa_vector<Alloc, Growth, Ts...>::insert(const_iterator position, const value_type &val) {
+    return insert(position, 1, val);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::iterator basic_soa_vector<Alloc, Growth, Ts...>::insert(const_iterator position, size_type n, const value_type &val) {
+    const size_type index{ static_cast<size_type>(position - cbegin()) };
+    const size_type old_size{ m_size };
+    reserve_more(n);
+    // The copies are appended before anything moves, then rotated into place per field.
+    try {
+      for (size_type i{ 0 }; i < n; ++i) {
+        push_back(val);
+      }
+    }
+    catch (...) {
+      destroy_from(old_size);
+      throw;
+    }
+    rotate_into_place(index, old_size);
+    return begin() + static_cast<difference_type>(index);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  template<typename InputIterator, typename>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::iterator basic_soa_vector<Alloc, Growth, Ts...>::insert(const_iterator position, InputIterator first, InputIterator last) {
+    const size_type index{ static_cast<size_type>(position - cbegin()) };
+    const size_type old_size{ m_size };
+    reserve_range(first, last, typename ::std::iterator_traits<InputIterator>::iterator_category{});
+    // The elements are appended, then rotated into place per field, so the range is only walked once.
+    try {
+      for (; first != last; ++first) {
+        append_row(*first);
+      }
+    }
+    catch (...) {
+      destroy_from(old_size);
+      throw;
+    }
+    rotate_into_place(index, old_size);
+    return begin() + static_cast<difference_type>(index);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::iterator basic_soa_vector<Alloc, Growth, Ts...>::insert(const_iterator position, ::std::initializer_list<value_type> il) {
+    return insert(position, il.begin(), il.end());
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  template<typename... Args>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::iterator basic_soa_vector<Alloc, Growth, Ts...>::emplace(const_iterator position, Args&&... args) {
+    static_assert(sizeof...(Args) == sizeof...(Ts), "soa_vector::emplace takes one argument per field.");
+    const size_type index{ static_cast<size_type>(position - cbegin()) };
+    const size_type old_size{ m_size };
+    construct_back_from(::std::forward_as_tuple(::std::forward<Args>(args)...));
+    rotate_into_place(index, old_size);
+    return begin() + static_cast<difference_type>(index);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::iterator basic_soa_vector<Alloc, Growth, Ts...>::erase(const_iterator position) {
+    return erase(position, position + 1);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::iterator basic_soa_vector<Alloc, Growth, Ts...>::erase(const_iterator first, const_iterator last) {
+    const size_type index{ static_cast<size_type>(first - cbegin()) };
+    const size_type count{ static_cast<size_type>(last - first) };
+    if (count) {
+      // Every field array is compacted separately, so each one is a plain move over contiguous memory.
+      for_each_field([&](auto field) {
+        auto *array = ::std::get<decltype(field)::value>(m_fields);
+        detail::move_assign(array + index + count, array + m_size, array + index);
+      });
+      destroy_from(m_size - count);
+    }
+    return begin() + static_cast<difference_type>(index);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::clear() noexcept {
+    destroy_from(0);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::destroy_from(size_type first) noexcept {
+    for_each_field([&](auto field) {
+      auto *array = ::std::get<decltype(field)::value>(m_fields);
+      detail::destroy_range(allocator_ref(), array + first, array + m_size);
+    });
+    m_size = first;
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::swap(basic_soa_vector &other) {
+    if (propagate_swap_tag::value || allocators_equal(allocator_ref(), other.allocator_ref())) {
+      using ::std::swap;
+      swap(m_buffer, other.m_buffer);
+      swap(m_fields, other.m_fields);
+      swap(m_size, other.m_size);
+      swap(m_capacity, other.m_capacity);
+      swap_allocators(other, propagate_swap_tag{});
+      return;
+    }
+    // Neither buffer can change owners, so the elements are relocated between them.
+    basic_soa_vector temp(::std::move(other));
+    other = ::std::move(*this);
+    *this = ::std::move(temp);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::reference basic_soa_vector<Alloc, Growth, Ts...>::at(size_type n) noexcept {
+    assert(n < size());
+    return (*this)[n];
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::const_reference basic_soa_vector<Alloc, Growth, Ts...>::at(size_type n) const noexcept {
+    assert(n < size());
+    return (*this)[n];
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  typename basic_soa_vector<Alloc, Growth, Ts...>::size_type basic_soa_vector<Alloc, Growth, Ts...>::max_size() const noexcept {
+    return (allocator_ref().max_size() - field_alignment * sizeof...(Ts)) / (row_bytes());
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::resize(size_type elements) {
+    if (elements < m_size) {
+      destroy_from(elements);
+      return;
+    }
+    reserve(elements);
+    while (m_size < elements) {
+      construct_back([&](auto, auto *dest) { allocator_ref().construct(dest); });
+    }
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::resize(size_type elements, const value_type &val) {
+    if (elements < m_size) {
+      destroy_from(elements);
+      return;
+    }
+    reserve(elements);
+    while (m_size < elements) {
+      push_back(val);
+    }
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::reserve(size_type elements) {
+    if (elements > m_capacity) {
+      reallocate(elements);
+    }
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::shrink_to_fit() {
+    if (m_size == m_capacity) return;
+    if (m_size == 0) {
+      release();
+      return;
+    }
+    reallocate(m_size);
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::reallocate(size_type elements) {
+    const size_type bytes{ allocation_bytes(elements) };
+    char *buffer{ allocator_ref().allocate(bytes) };
+    field_pointers fields{ carve(buffer, elements) };
+    try {
+      relocate_fields(m_fields, m_size, fields);
+    }
+    catch (...) {
+      allocator_ref().deallocate(buffer, bytes);
+      throw;
+    }
+    const size_type size{ m_size };
+    release();
+    m_buffer = buffer;
+    m_fields = fields;
+    m_size = size;
+    m_capacity = elements;
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::relocate_fields(const field_pointers &source, size_type count, const field_pointers &dest) {
+    // Every field is relocated before any source is destroyed. Unless all of them are moved without throwing they
+    // are all copied, so a throwing copy leaves the sources untouched.
+    construct_fields(source, count, dest, [&](auto field, auto *first, auto *last, auto *to) {
+      using type = field_type<decltype(field)::value>;
+      detail::uninitialized_move_if_noexcept(allocator_ref(), first, last, to,
+        ::std::integral_constant<bool, relocate_by_move || !::std::is_copy_constructible<type>::value>{});
+    });
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  template<typename Construct>
+  void basic_soa_vector<Alloc, Growth, Ts...>::construct_fields(const field_pointers &source, size_type count, const field_pointers &dest, Construct construct) {
+    size_type constructed_fields{ 0 };
+    try {
+      for_each_field([&](auto field) {
+        constexpr ::std::size_t I{ decltype(field)::value };
+        construct(field, ::std::get<I>(source), ::std::get<I>(source) + count, ::std::get<I>(dest));
+        ++constructed_fields;
+      });
+    }
+    catch (...) {
+      for_each_field([&](auto field) {
+        constexpr ::std::size_t I{ decltype(field)::value };
+        if (I < constructed_fields) {
+          detail::destroy_range(allocator_ref(), ::std::get<I>(dest), ::std::get<I>(dest) + count);
+        }
+      });
+      throw;
+    }
+  }
+
+  template<typename Alloc, typename Growth, typename... Ts>
+  void basic_soa_vector<Alloc, Growth, Ts...>::release() noexcept {
+    clear();
+    if (m_buffer) {
+      allocator_ref().deallocate(m_buffer, allocation_bytes(m_capacity));
+    }
+    m_buffer = nullptr;
+    m_fields = field_pointers{};
+    m_capacity = 0;
+  }
+
+} // namespace ftl
@@ -0,0 +1,50 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cassert> // assert
+#include <type_traits> // remove_cv
+
+namespace ftl {
+
+  // A non-owning view of a contiguous array, like C++20's std::span with a dynamic extent.
+  // It exposes data() and size(), so it works with the algorithms in algorithm.hpp.
+  template<typename T>
+  class span {
+  public:
+    using element_type = T;
+    using value_type = typename ::std::remove_cv<T>::type;
+    using size_type = ::std::size_t;
+    using pointer = T*;
+    using reference = T&;
+    using iterator = T*;
+
+    constexpr span() noexcept = default;
+    constexpr span(pointer data, size_type size) noexcept : m_data(data), m_size(size) {}
+    // A span of const elements can view the same array as a span of mutable ones.
+    template<typename U, typename = typename ::std::enable_if<::std::is_convertible<U(*)[], T(*)[]>::value>::type>
+    constexpr span(const span<U> &other) noexcept : m_data(other.data()), m_size(other.size()) {}
+
+    constexpr pointer data() const noexcept { return m_data; }
+    constexpr size_type size() const noexcept { return m_size; }
+    constexpr bool empty() const noexcept { return m_size == 0; }
+    constexpr iterator begin() const noexcept { return m_data; }
+    constexpr iterator end() const noexcept { return m_data + m_size; }
+    reference operator[](size_type n) const noexcept {
+      assert(n < m_size);
+      return m_data[n];
+    }
+    reference front() const noexcept { return (*this)[0]; }
+    reference back() const noexcept { return (*this)[m_size - 1]; }
+    span subspan(size_type offset, size_type count) const noexcept {
+      assert(offset + count <= m_size);
+      return span{ m_data + offset, count };
+    }
+
+  private:
+    pointer m_data{ nullptr };
+    size_type m_size{ 0 };
+  };
+
+} // namespace ftl
@@ -0,0 +1,96 @@
+// All content copyright (c) Allan Deutsch 2017. All rights reserved.
+// The vector instrumentation tests. They are built as their own executable, since every translation unit of a
+// program has to agree on FTL_INSTRUMENT_VECTORS, and the other tests run in the default configuration.
+#define FTL_INSTRUMENT_VECTORS 1
+#include "../../vector.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main() {
+  static ftl::vector_site growth_site{ "growth" };
+  static ftl::vector_site shuffle_site{ "shuffle" };
+  {
+    ftl::vector_site_scope scope{ growth_site };
+    ftl::vector<int> grown;
+    std::uint64_t expected_grows{ 0 }, expected_relocations{ 0 };
+    for (int i{ 0 }; i < 1000; ++i) {
+      if (grown.size() == grown.capacity()) {
+        ++expected_grows;
+        expected_relocations += grown.size();
+      }
+      grown.push_back(i);
+    }
+    // An explicit reserve relocates, but isn't a grow.
+    grown.reserve(grown.capacity() * 2);
+    const ftl::vector_event_counts counts{ growth_site.counts() };
+    assert(counts.grows == expected_grows && counts.relocated_elements == expected_relocations + 1000);
+    assert(counts.inline_spills == 0 && counts.insert_copies == 0 && counts.erase_moves == 0);
+    ftl::inline_vector<int, 4> spilled{ 1, 2, 3, 4 };
+    spilled.push_back(5);
+    const ftl::vector_event_counts spill_counts{ growth_site.counts() };
+    assert(spill_counts.inline_spills == 1 && spill_counts.grows == counts.grows + 1 && spill_counts.relocated_elements == counts.relocated_elements + 4);
+  }
+  auto shuffle = [] {
+    FTL_VECTOR_SITE("shuffle in place");
+    ftl::vector<std::string> words;
+    words.reserve(16);
+    words.assign({ "b", "c", "d" });
+    words.insert(words.begin(), std::string{ "a" });
+    words.insert(words.begin() + 1, 2, std::string{ "x" });
+    const std::string tail[]{ "y", "z" };
+    words.insert(words.end() - 1, std::begin(tail), std::end(tail));
+    words.erase(words.begin());
+    words.erase(words.begin(), words.begin() + 2);
+    ftl::unordered_vector<std::string> bag{ "p", "q", "r" };
+    bag.erase(bag.begin());
+  };
+  shuffle();
+  ftl::vector_event_counts shuffled{};
+  ftl::vector_site::for_each([&](const ftl::vector_site &site) {
+    if (std::string{ site.name() } == "shuffle in place") shuffled = site.counts();
+  });
+  // a moved in, then 2 x copied, then y and z copied; the tails shifted are 3, 3 and 1 elements long.
+  assert(shuffled.insert_moves == 1 + 3 + 3 + 1 && shuffled.insert_copies == 4 && shuffled.grows == 0);
+  // Erasing the front shifts 7 elements, erasing two more shifts 5, and the bag moves its last element once.
+  assert(shuffled.erase_moves == 7 + 5 + 1);
+  // Threads count on their own, and their counts are kept when they exit.
+  std::thread worker{ [] {
+    ftl::vector_site_scope scope{ shuffle_site };
+    ftl::vector<int> local;
+    local.reserve(100);
+    for (int i{ 0 }; i < 100; ++i) local.insert(local.begin(), i);
+  } };
+  worker.join();
+  // The first insert is an append; each later one moves the new element in and shifts the ones before it.
+  assert(shuffle_site.counts().insert_moves == 99 + 99 * 100 / 2 && growth_site.counts().insert_moves == 0);
+  std::ostringstream text_summary, json_summary;
+  ftl::write_vector_event_summary(text_summary);
+  ftl::write_vector_event_summary(json_summary, ftl::report_format::json);
+  assert(text_summary.str().find("shuffle in place") != std::string::npos);
+  assert(json_summary.str().find("{\"site\":\"growth\",\"grows\":") != std::string::npos);
+  assert(json_summary.str().find("\"site\":\"unattributed\"") != std::string::npos);
+
+  // Sites past the limit fold into unattributed rather than being listed with its counts.
+  std::vector<std::unique_ptr<ftl::vector_site>> extra_sites;
+  for (std::size_t i{ 0 }; i < ftl::vector_site::max_sites; ++i) {
+    extra_sites.emplace_back(new ftl::vector_site{ "extra" });
+  }
+  {
+    ftl::vector_site_scope scope{ *extra_sites.back() };
+    ftl::vector<int> overflowing{ 1, 2, 3 };
+    overflowing.erase(overflowing.begin());
+  }
+  assert(ftl::vector_site::unattributed().counts().erase_moves == 2 && extra_sites.back()->counts().erase_moves == 2);
+  std::size_t listed_sites{ 0 };
+  ftl::vector_site::for_each([&](const ftl::vector_site &) { ++listed_sites; });
+  assert(listed_sites == ftl::vector_site::max_sites);
+
+  return 0;
+}
@@ -1,6 +1,18 @@
 // All content copyright (c) Allan Deutsch 2017. All rights reserved.
 #include "../container_traits.hpp"
 #include "../vector.hpp"
+#include "../algorithm.hpp"
+#include "../slot_map.hpp"
+#include "../soa_vector.hpp"
+#include "../concurrent_vector.hpp"
+#include "../segmented_vector.hpp"
+#include "../parallel_algorithm.hpp"
+#include "../mmap_allocator.hpp"
+#include "../mapped_vector.hpp"
+#include "../snapshot.hpp"
+#include "../arena.hpp"
+#include "../pool_allocator.hpp"
+#include "../tracking_allocator.hpp"
 
 #include <vector>
 #include <unordered_map>
@@ -170,7 +182,14 @@ template<typename C = T> void test_##TEST(typename std::enable_if_t<ftl::has_##T
       container.reserve(101);
       assert(container.capacity() >= 101);
     }
-    CONTAINER_TEST_DECL(shrink_to_fit) {}
+    CONTAINER_TEST_DECL(shrink_to_fit) {
+      T container;
+      add_n_elements(container, 10);
+      container.reserve(100);
+      container.shrink_to_fit();
+      assert(container.size() == 10);
+      assert(container.capacity() >= container.size());
+    }
     
     CONTAINER_TEST_DECL(index_operator) {}
     CONTAINER_TEST_DECL(map_index_operator) {}
@@ -206,6 +225,104 @@ template<typename C = T> void test_##TEST(typename std::enable_if_t<ftl::has_##T
 
 } // namespace ftl
 #include <memory>
+#include <string>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <list>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+namespace {
+  // Counts how elements are carried over when a vector reallocates.
+  struct relocation_counter {
+    static int copies;
+    static int moves;
+    int value{ 0 };
+    relocation_counter(int v = 0) : value(v) {}
+    relocation_counter(const relocation_counter &other) : value(other.value) { ++copies; }
+    relocation_counter(relocation_counter &&other) noexcept : value(other.value) { ++moves; }
+    relocation_counter& operator=(const relocation_counter &other) { value = other.value; ++assignments; return *this; }
+    relocation_counter& operator=(relocation_counter &&other) noexcept { value = other.value; ++assignments; return *this; }
+    ~relocation_counter() {}
+    static int assignments;
+    static void reset() { copies = moves = assignments = 0; }
+  };
+  int relocation_counter::copies{ 0 };
+  int relocation_counter::moves{ 0 };
+  int relocation_counter::assignments{ 0 };
+
+  // A move constructor that may throw must not be used to relocate, since it would lose the strong guarantee.
+  struct throwing_move {
+    static int copies;
+    throwing_move() = default;
+    throwing_move(const throwing_move &) { ++copies; }
+    throwing_move(throwing_move &&) {}
+    throwing_move& operator=(const throwing_move&) = default;
+  };
+  int throwing_move::copies{ 0 };
+
+  // Copying throws once copies_left runs out, and moving may throw, so relocating it has to copy.
+  struct throwing_copy {
+    static int copies_left;
+    throwing_copy() = default;
+    throwing_copy(const throwing_copy &) {
+      if (copies_left-- == 0) throw std::runtime_error{ "copy" };
+    }
+    throwing_copy(throwing_copy &&) {}
+  };
+  int throwing_copy::copies_left{ 0 };
+
+  // Aligned beyond what new guarantees before C++17.
+  struct alignas(128) over_aligned {
+    int value{ 0 };
+    over_aligned(int v = 0) : value(v) {}
+  };
+
+  bool is_aligned(const void *p, std::size_t alignment) {
+    return reinterpret_cast<std::uintptr_t>(p) % alignment == 0;
+  }
+
+  // A heap allocator with an identity, which propagates on every assignment and swap, and whose container copies get
+  // a fresh identity.
+  template<typename T>
+  struct propagating_allocator {
+    using value_type = T;
+    using pointer = T*;
+    using size_type = std::size_t;
+    template<typename Type>
+    using rebind = propagating_allocator<Type>;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit propagating_allocator(int identity = 0) noexcept : id{ identity } {}
+    template<typename U>
+    propagating_allocator(const propagating_allocator<U> &other) noexcept : id{ other.id } {}
+
+    propagating_allocator select_on_container_copy_construction() const { return propagating_allocator{ id + 100 }; }
+    pointer allocate(size_type n) { return static_cast<pointer>(::operator new(n * sizeof(T))); }
+    void deallocate(pointer p, size_type) noexcept { ::operator delete(p); }
+    size_type max_size() const noexcept { return std::numeric_limits<size_type>::max() / sizeof(T); }
+    template<typename U, typename... Args>
+    void construct(U *p, Args&&... args) { ::new ((void*)p) U(std::forward<Args>(args)...); }
+    template<typename U>
+    void destroy(U *p) { p->~U(); }
+
+    int id;
+  };
+  template<typename T>
+  bool operator==(const propagating_allocator<T> &lhs, const propagating_allocator<T> &rhs) noexcept { return lhs.id == rhs.id; }
+  template<typename T>
+  bool operator!=(const propagating_allocator<T> &lhs, const propagating_allocator<T> &rhs) noexcept { return lhs.id != rhs.id; }
+} // namespace
+
 int main() {
 
   std::vector<std::unique_ptr<ftl::container_test_base>> tests;
@@ -213,6 +330,8 @@ int main() {
   tests.emplace_back(new ftl::container_test<ftl::vector<float>>());
   tests.emplace_back(new ftl::container_test<ftl::unordered_vector<float>>());
   tests.emplace_back(new ftl::container_test<ftl::inline_vector<float,20>>());
+  tests.emplace_back(new ftl::container_test<ftl::soa_vector<float, int>>());
+  tests.emplace_back(new ftl::container_test<ftl::segmented_vector<float>>());
   for (auto &it : tests) {
     it->execute();
   }
@@ -271,5 +390,1058 @@ int main() {
   }
   uiv.erase(uiv.begin());
 
+  static_assert(ftl::is_trivially_relocatable<int>::value, "Trivially copyable types are trivially relocatable.");
+  static_assert(ftl::is_trivially_relocatable<std::unique_ptr<int>>::value, "unique_ptr opts in to trivial relocation.");
+  static_assert(!ftl::is_trivially_relocatable<relocation_counter>::value, "Types with user provided copy/move are not detected as trivially relocatable.");
+
+  ftl::vector<relocation_counter> vrc;
+  for (int i{ 0 }; i < 100; ++i) {
+    vrc.push_back(relocation_counter{ i });
+  }
+  assert(relocation_counter::copies == 0);
+  vrc.reserve(1000);
+  assert(relocation_counter::copies == 0);
+  for (int i{ 0 }; i < 100; ++i) {
+    assert(vrc[i].value == i);
+  }
+
+  ftl::vector<throwing_move> vtm;
+  vtm.reserve(4);
+  vtm.emplace_back();
+  vtm.reserve(64);
+  assert(throwing_move::copies == 1);
+
+  ftl::vector<int> vsized(5);
+  ftl::unordered_vector<std::string> usized(6);
+  assert(vsized.size() == 5 && vsized[4] == 0 && usized.size() == 6 && usized[5].empty());
+
+  ftl::vector<std::unique_ptr<int>> vup;
+  for (int i{ 0 }; i < 50; ++i) {
+    vup.emplace_back(new int{ i });
+  }
+  for (int i{ 0 }; i < 50; ++i) {
+    assert(*vup[i] == i);
+  }
+
+  ftl::inline_vector<std::string, 4> vis;
+  for (int i{ 0 }; i < 16; ++i) {
+    vis.push_back(std::to_string(i));
+  }
+  for (int i{ 0 }; i < 16; ++i) {
+    assert(vis[i] == std::to_string(i));
+  }
+
+  // bulk construction, assignment and destruction
+  ftl::vector<float> vf(1000, 1.5f);
+  assert(vf.size() == 1000);
+  ftl::vector<float> vf2{ vf };
+  assert(vf2.size() == 1000 && vf2[999] == 1.5f);
+  const float *vf2_data{ vf2.data() };
+  vf2.assign(10, 2.5f);
+  assert(vf2.size() == 10 && vf2.data() == vf2_data);
+  vf2 = vf;
+  assert(vf2.size() == 1000 && vf2.data() == vf2_data);
+  vf2.resize(10);
+  assert(vf2.size() == 10 && vf2[9] == 1.5f);
+  vf2.resize(20, 3.0f);
+  assert(vf2.size() == 20 && vf2[9] == 1.5f && vf2[19] == 3.0f);
+  vf2.erase(vf2.begin() + 5, vf2.begin() + 15);
+  assert(vf2.size() == 10 && vf2[4] == 1.5f && vf2[5] == 3.0f);
+  vf2.clear();
+  assert(vf2.empty() && vf2.capacity() >= 1000);
+
+  ftl::vector<std::string> vs(3, std::string{ "ftl" });
+  ftl::vector<std::string> vs2{ "a", "b", "c", "d", "e" };
+  vs2 = vs;
+  assert(vs2.size() == 3 && vs2[2] == "ftl");
+  vs2.assign({ "x", "y", "z", "w" });
+  assert(vs2.size() == 4 && vs2[3] == "w");
+  vs2.resize(2);
+  assert(vs2.size() == 2 && vs2[1] == "y");
+
+  ftl::vector<int> vfill;
+  vfill.assign(5, 1);
+  assert(vfill.size() == 5 && vfill[4] == 1);
+
+  // growth policies
+  assert(ftl::doubling_growth::next_capacity(0, 1, sizeof(int)) == 10);
+  assert(ftl::doubling_growth::next_capacity(10, 11, sizeof(int)) == 20);
+  assert(ftl::three_halves_growth::next_capacity(10, 11, sizeof(int)) == 15);
+  assert(ftl::three_halves_growth::next_capacity(1, 2, sizeof(int)) == 2);
+  assert(ftl::size_class_growth<>::round_to_size_class(65) == 80);
+  assert(ftl::size_class_growth<>::round_to_size_class(4097) == 8192);
+  ftl::vector<int, ftl::default_allocator<int>, ftl::three_halves_growth> v15;
+  for (int i{ 0 }; i < 11; ++i) {
+    v15.push_back(i);
+  }
+  assert(v15.capacity() == 15);
+  ftl::inline_vector<int, 4, ftl::default_allocator<int>, ftl::size_class_growth<>> vsc;
+  for (int i{ 0 }; i < 5; ++i) {
+    vsc.push_back(i);
+  }
+  assert(vsc.capacity() * sizeof(int) == 64 && vsc[4] == 4);
+
+  // the vector family is not polymorphic and stores stateless allocators for free
+  static_assert(sizeof(ftl::vector<int>) == 3 * sizeof(void*), "ftl::vector should be three words.");
+  static_assert(sizeof(ftl::unordered_vector<int>) == 3 * sizeof(void*), "ftl::unordered_vector should be three words.");
+  static_assert(!std::is_polymorphic<ftl::vector<int>>::value, "ftl::vector should not have a vtable.");
+  static_assert(!std::is_polymorphic<ftl::inline_vector<int, 4>>::value, "ftl::inline_vector should not have a vtable.");
+  static_assert(!std::is_polymorphic<ftl::unordered_vector<int>>::value, "ftl::unordered_vector should not have a vtable.");
+
+  ftl::inline_vector<int, 8> viv{ 1, 2, 3 };
+  ftl::inline_vector<int, 8> viv_copy{ viv };
+  assert(viv_copy.size() == 3 && viv_copy[2] == 3 && viv_copy.data() != viv.data());
+  ftl::inline_vector<int, 8> viv_moved{ std::move(viv) };
+  assert(viv_moved.size() == 3 && viv.empty() && viv.capacity() == 8);
+  for (int i{ 0 }; i < 20; ++i) {
+    viv.push_back(i);
+  }
+  const int *viv_heap{ viv.data() };
+  viv_moved = std::move(viv);
+  assert(viv_moved.size() == 20 && viv_moved.data() == viv_heap && viv.capacity() == 8);
+  viv.swap(viv_moved);
+  assert(viv.size() == 20 && viv_moved.empty());
+  viv = { 4, 5 };
+  assert(viv.size() == 2 && viv[1] == 5);
+
+  // shrinking
+  ftl::vector<int> vshrink;
+  for (int i{ 0 }; i < 1000; ++i) {
+    vshrink.push_back(i);
+  }
+  vshrink.erase(vshrink.begin() + 10, vshrink.end());
+  vshrink.shrink_to_fit();
+  assert(vshrink.capacity() == 10 && vshrink[9] == 9);
+  vshrink.clear();
+  vshrink.shrink_to_fit();
+  assert(vshrink.capacity() == 0 && vshrink.data() == nullptr);
+
+  ftl::inline_vector<std::string, 4> vishrink;
+  for (int i{ 0 }; i < 10; ++i) {
+    vishrink.push_back(std::to_string(i));
+  }
+  vishrink.erase(vishrink.begin() + 3, vishrink.end());
+  vishrink.shrink_to_fit();
+  assert(vishrink.capacity() == 4 && vishrink.size() == 3 && vishrink[2] == "2");
+  assert(static_cast<const void*>(vishrink.data()) >= static_cast<const void*>(&vishrink)
+    && static_cast<const void*>(vishrink.data()) < static_cast<const void*>(&vishrink + 1));
+
+  ftl::vector<int, ftl::default_allocator<int>, ftl::auto_shrink<>> vauto;
+  for (int i{ 0 }; i < 1000; ++i) {
+    vauto.push_back(i);
+  }
+  const auto vauto_peak = vauto.capacity();
+  assert(vauto_peak == 1280);
+  while (vauto.size() > 320) {
+    vauto.pop_back();
+  }
+  assert(vauto.capacity() == vauto_peak);
+  while (vauto.size() > 200) {
+    vauto.pop_back();
+  }
+  assert(vauto.capacity() < vauto_peak && vauto.capacity() >= 2 * vauto.size());
+  auto vauto_it = vauto.erase(vauto.begin() + 5, vauto.end() - 10);
+  assert(*vauto_it == 190 && vauto.capacity() <= 4 * vauto.size());
+  ftl::inline_vector<int, 16, ftl::default_allocator<int>, ftl::auto_shrink<>> viauto;
+  for (int i{ 0 }; i < 100; ++i) {
+    viauto.push_back(i);
+  }
+  while (viauto.size() > 2) {
+    viauto.pop_back();
+  }
+  assert(viauto.capacity() == 16 && viauto[1] == 1);
+
+  // default initialized and uninitialized growth
+  ftl::vector<char> vbuf;
+  vbuf.resize_uninitialized(64);
+  assert(vbuf.size() == 64 && vbuf.capacity() >= 64);
+  std::memset(vbuf.data(), 'a', vbuf.size());
+  char *vbuf_tail{ vbuf.append_uninitialized(16) };
+  assert(vbuf.size() == 80 && vbuf_tail == vbuf.data() + 64);
+  std::memset(vbuf_tail, 'b', 16);
+  assert(vbuf[63] == 'a' && vbuf[64] == 'b' && vbuf[79] == 'b');
+  for (int i{ 0 }; i < 100; ++i) {
+    vbuf.append_uninitialized(1);
+  }
+  assert(vbuf.size() == 180 && vbuf[63] == 'a');
+  vbuf.resize(200);
+  assert(vbuf[199] == 0);
+  vbuf.resize(10, ftl::default_init);
+  assert(vbuf.size() == 10 && vbuf[9] == 'a');
+  ftl::vector<std::string> vsdef;
+  vsdef.resize(3, ftl::default_init);
+  assert(vsdef.size() == 3 && vsdef[2].empty());
+  ftl::vector<std::unique_ptr<int>> vupresize;
+  vupresize.resize(5);
+  assert(vupresize.size() == 5 && vupresize[4] == nullptr);
+
+  // vectorized algorithms, checked against std:: at every instruction set level and across partial blocks
+  for (ftl::simd_level level : { ftl::simd_level::avx2, ftl::simd_level::sse2, ftl::simd_level::scalar }) {
+    ftl::limit_simd_level(level);
+    for (int n{ 0 }; n < 70; ++n) {
+      ftl::vector<std::int32_t> vi;
+      ftl::vector<float> vf;
+      ftl::vector<std::uint8_t> vb;
+      for (int i{ 0 }; i < n; ++i) {
+        vi.push_back((i * 37) % 23 - 11);
+        vf.push_back(static_cast<float>((i * 37) % 23) - 11.5f);
+        vb.push_back(static_cast<std::uint8_t>((i * 97) % 251));
+      }
+      for (std::int32_t x : { -11, 0, 11, 100 }) {
+        assert(ftl::find(vi, x) == std::find(vi.begin(), vi.end(), x));
+        assert(ftl::count(vi, x) == static_cast<std::size_t>(std::count(vi.begin(), vi.end(), x)));
+        assert(ftl::find(vf, x - 0.5f) == std::find(vf.begin(), vf.end(), x - 0.5f));
+        assert(ftl::count(vb, static_cast<std::uint8_t>(x)) == static_cast<std::size_t>(std::count(vb.begin(), vb.end(), static_cast<std::uint8_t>(x))));
+      }
+      assert(ftl::min_element(vi) == std::min_element(vi.begin(), vi.end()));
+      assert(ftl::max_element(vi) == std::max_element(vi.begin(), vi.end()));
+      assert(ftl::min_element(vf) == std::min_element(vf.begin(), vf.end()));
+      assert(ftl::max_element(vb) == std::max_element(vb.begin(), vb.end()));
+      if (n) {
+        // With a NaN the element picked is unspecified, but it is one of the range.
+        ftl::vector<float> vnan{ vf };
+        vnan[0] = std::numeric_limits<float>::quiet_NaN();
+        assert(ftl::min_element(vnan) < vnan.end() && ftl::max_element(vnan) < vnan.end());
+        std::fill(vnan.begin(), vnan.end(), std::numeric_limits<float>::quiet_NaN());
+        assert(ftl::min_element(vnan) < vnan.end() && ftl::max_element(vnan) < vnan.end());
+      }
+      assert(ftl::sum(vi) == std::accumulate(vi.begin(), vi.end(), std::int64_t{ 0 }));
+      assert(ftl::sum(vb) == std::accumulate(vb.begin(), vb.end(), std::uint64_t{ 0 }));
+      assert(ftl::sum(vf) == std::accumulate(vf.begin(), vf.end(), 0.0f));
+      ftl::vector<std::int32_t> vi2{ vi };
+      assert(ftl::equal(vi, vi2) && !ftl::lexicographical_compare(vi, vi2));
+      if (n) {
+        vi2[n / 2] += 1;
+        assert(!ftl::equal(vi, vi2) && ftl::lexicographical_compare(vi, vi2) && !ftl::lexicographical_compare(vi2, vi));
+        vi2[n / 2] -= 1;
+        vi2.pop_back();
+        assert(!ftl::equal(vi, vi2) && ftl::lexicographical_compare(vi2, vi));
+      }
+    }
+    std::vector<float> fnan{ 1.0f, std::numeric_limits<float>::quiet_NaN(), 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+    std::vector<float> fnan2{ fnan };
+    fnan2[5] = 4.0f;
+    assert(!ftl::equal(fnan, fnan) && ftl::lexicographical_compare(fnan2, fnan) && !ftl::lexicographical_compare(fnan, fnan2));
+    std::vector<float> fnan_first{ std::numeric_limits<float>::quiet_NaN(), 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+    assert(ftl::min_element(fnan_first) < fnan_first.data() + 8 && ftl::max_element(fnan) < fnan.data() + 9);
+    std::string text(100, 'x');
+    text += "key=value;next";
+    assert(ftl::find_first_of(text, std::string{ "=;" }) == text.data() + 103);
+    assert(ftl::find_first_of(text, std::string{ "ABCDEFGHIJKLMNOPQRSTUVW=" }) == text.data() + 103);
+    assert(ftl::find_first_of(text, std::string{}) == text.data() + text.size());
+    assert(ftl::find(text, ';') == text.data() + 109 && ftl::count(text, 'x') == 101);
+  }
+  ftl::limit_simd_level(ftl::simd_level::avx2);
+  ftl::vector<std::string> vsfind{ "a", "b" };
+  assert(ftl::find(vsfind, "b") == vsfind.begin() + 1 && ftl::sum(ftl::vector<double>{ 0.5, 0.25 }) == 0.75);
+
+  // in place insertion
+  ftl::vector<int> vins{ 0, 1, 2, 3, 4, 5 };
+  vins.reserve(64);
+  auto vins_it = vins.insert(vins.begin() + 2, 3, vins[4]);
+  assert(vins_it == vins.begin() + 2 && vins.size() == 9 && vins[2] == 4 && vins[4] == 4 && vins[5] == 2 && vins[8] == 5);
+  vins_it = vins.insert(vins.end() - 1, 2, 7);
+  assert(*vins_it == 7 && vins[8] == 7 && vins[9] == 7 && vins[10] == 5);
+  vins_it = vins.emplace(vins.begin(), vins.back());
+  assert(vins_it == vins.begin() && vins[0] == 5 && vins[1] == 0 && vins.size() == 12);
+  std::list<int> vins_list{ 10, 11, 12 };
+  vins_it = vins.insert(vins.begin() + 1, vins_list.begin(), vins_list.end());
+  assert(vins[1] == 10 && vins[3] == 12 && vins[4] == 0 && vins.size() == 15);
+  std::istringstream vins_stream{ "20 21 22" };
+  vins_it = vins.insert(vins.begin() + 4, std::istream_iterator<int>{ vins_stream }, std::istream_iterator<int>{});
+  assert(vins_it == vins.begin() + 4 && vins[4] == 20 && vins[6] == 22 && vins[7] == 0 && vins.size() == 18);
+  ftl::vector<std::string> vsins{ "a", "b", "c", "d" };
+  vsins.insert(vsins.begin() + 1, { "x", "y" });
+  vsins.insert(vsins.begin() + 5, 3, vsins[0]);
+  vsins.emplace(vsins.begin() + 2, 2, 'z');
+  assert(vsins.size() == 10 && vsins[0] == "a" && vsins[1] == "x" && vsins[2] == "zz" && vsins[3] == "y" && vsins[4] == "b"
+    && vsins[5] == "c" && vsins[6] == "a" && vsins[8] == "a" && vsins[9] == "d");
+  ftl::inline_vector<std::string, 4> visins{ "a", "b", "c" };
+  visins.insert(visins.begin() + 1, 4, visins[2]);
+  assert(visins.size() == 7 && visins[1] == "c" && visins[4] == "c" && visins[5] == "b" && visins[6] == "c");
+  ftl::vector<std::unique_ptr<int>> vupins;
+  vupins.emplace_back(new int{ 1 });
+  vupins.emplace(vupins.begin(), new int{ 0 });
+  assert(*vupins[0] == 0 && *vupins[1] == 1);
+
+  // a bulk insert into the middle moves each old element once, and copies each new one once
+  for (bool reallocates : { true, false }) {
+    ftl::vector<relocation_counter> vbulk;
+    vbulk.reserve(reallocates ? 100000 : 200000);
+    for (int i{ 0 }; i < 100000; ++i) {
+      vbulk.emplace_back(i);
+    }
+    ftl::vector<relocation_counter> vbulk_src(vbulk.begin(), vbulk.end());
+    relocation_counter::reset();
+    vbulk.insert(vbulk.begin() + 50000, vbulk_src.begin(), vbulk_src.end());
+    assert(relocation_counter::copies + relocation_counter::moves + relocation_counter::assignments <= 100000 + 100000 + 50000);
+    assert(relocation_counter::moves + relocation_counter::assignments <= 100000);
+    assert(vbulk.size() == 200000 && vbulk[49999].value == 49999 && vbulk[50000].value == 0 && vbulk[150000].value == 50000);
+  }
+
+  // bulk removal
+  ftl::vector<int> verase;
+  ftl::unordered_vector<int> uerase;
+  for (int i{ 0 }; i < 100; ++i) {
+    verase.push_back(i);
+    uerase.push_back(i);
+  }
+  assert(verase.erase_if([](int x) { return x % 3 == 0; }) == 34 && verase.size() == 66);
+  assert(verase[0] == 1 && verase[1] == 2 && verase[2] == 4 && verase[65] == 98);
+  assert(ftl::retain(verase, [](int x) { return x < 50; }) == 33 && verase.size() == 33 && verase.back() == 49);
+  assert(verase.erase_indices({ 0, 1, 5, 32 }) == 4 && verase.size() == 29 && verase[0] == 4 && verase[3] == 10 && verase.back() == 47);
+  assert(ftl::erase_indices(verase, std::vector<std::size_t>{}) == 0 && verase.size() == 29);
+  assert(uerase.erase_if([](int x) { return x % 3 == 0; }) == 34 && uerase.size() == 66);
+  assert(std::none_of(uerase.begin(), uerase.end(), [](int x) { return x % 3 == 0; }) && uerase[0] == 98);
+  assert(ftl::retain(uerase, [](int x) { return x < 50; }) == 33 && std::all_of(uerase.begin(), uerase.end(), [](int x) { return x < 50; }));
+  const int uerase_sum{ std::accumulate(uerase.begin(), uerase.end(), 0) };
+  const int uerase_removed{ uerase[0] + uerase[1] + uerase[31] + uerase[32] };
+  assert(ftl::erase_indices(uerase, std::vector<std::size_t>{ 0, 1, 31, 32 }) == 4 && uerase.size() == 29);
+  assert(std::accumulate(uerase.begin(), uerase.end(), 0) == uerase_sum - uerase_removed);
+  ftl::unordered_vector<std::string> userase{ "a", "b", "c", "d", "e", "f" };
+  userase.erase(userase.begin() + 1, userase.begin() + 3);
+  assert(userase.size() == 4 && userase[0] == "a" && userase[1] == "e" && userase[2] == "f" && userase[3] == "d");
+  userase.erase(userase.begin() + 2, userase.end());
+  userase.erase(userase.begin());
+  assert(userase.size() == 1 && userase[0] == "e");
+  ftl::unordered_vector<std::string> userase_all{ "a", "b", "c" };
+  assert(userase_all.erase_if([](const std::string &) { return true; }) == 3 && userase_all.empty());
+  // every survivor is moved at most once, and only the removed slots are destroyed
+  ftl::vector<relocation_counter> vrcerase;
+  for (int i{ 0 }; i < 1000; ++i) {
+    vrcerase.emplace_back(i);
+  }
+  relocation_counter::reset();
+  vrcerase.erase_if([](const relocation_counter &x) { return x.value % 2 == 0; });
+  assert(vrcerase.size() == 500 && vrcerase[1].value == 3 && relocation_counter::assignments <= 500 && relocation_counter::copies == 0);
+
+  // slot_map
+  ftl::slot_map<std::string> smap;
+  auto skey_a = smap.insert("a");
+  auto skey_b = smap.insert(std::string{ "b" });
+  auto skey_c = smap.emplace(3, 'c');
+  assert(smap.size() == 3 && smap[skey_a] == "a" && *smap.find(skey_c) == "ccc" && smap.contains(skey_b));
+  assert(smap.erase(skey_a) && !smap.erase(skey_a) && !smap.contains(skey_a) && smap.find(skey_a) == nullptr);
+  assert(smap.size() == 2 && smap[skey_b] == "b" && smap[skey_c] == "ccc");
+  auto skey_d = smap.insert("d");
+  assert(skey_d.index == skey_a.index && skey_d != skey_a && !smap.contains(skey_a) && smap[skey_d] == "d");
+  for (auto it = smap.begin(); it != smap.end(); ++it) {
+    assert(smap[smap.key_of(it)] == *it);
+  }
+  assert(!smap.contains(decltype(skey_a){}) && !smap.contains(decltype(skey_a){ 100, 1 }));
+  smap.clear();
+  assert(smap.empty() && !smap.contains(skey_b) && !smap.contains(skey_d));
+  ftl::vector<decltype(skey_a)> skeys;
+  for (int i{ 0 }; i < 1000; ++i) {
+    skeys.push_back(smap.insert(std::to_string(i)));
+  }
+  for (int i{ 0 }; i < 1000; i += 2) {
+    smap.erase(skeys[i]);
+  }
+  for (int i{ 1 }; i < 1000; i += 2) {
+    assert(smap[skeys[i]] == std::to_string(i) && !smap.contains(skeys[i - 1]));
+  }
+  assert(smap.size() == 500);
+
+  // soa_vector
+  ftl::soa_vector<float, std::string, char> soa;
+  soa.push_back(std::make_tuple(1.5f, std::string{ "one" }, 'a'));
+  soa.emplace_back(2.5f, "bbb", 'b');
+  soa.push_back({ 0.5f, "zero", 'c' });
+  assert(soa.size() == 3 && std::get<1>(soa[1]) == "bbb" && std::get<0>(soa.back()) == 0.5f && std::get<2>(soa.front()) == 'a');
+  for (int i{ 0 }; i < 200; ++i) {
+    soa.emplace_back(static_cast<float>(i), std::to_string(i), static_cast<char>(i));
+  }
+  assert(soa.size() == 203 && soa.get<1>()[3 + 150] == "150" && soa.get<0>()[3 + 199] == 199.0f);
+  assert(reinterpret_cast<std::uintptr_t>(soa.data<0>()) % 64 == 0 && reinterpret_cast<std::uintptr_t>(soa.data<1>()) % 64 == 0 &&
+    reinterpret_cast<std::uintptr_t>(soa.data<2>()) % 64 == 0);
+  soa.erase(soa.begin() + 1);
+  assert(soa.size() == 202 && std::get<1>(soa[1]) == "zero" && std::get<1>(soa[2]) == "0");
+  soa.erase(soa.begin() + 2, soa.begin() + 102);
+  assert(soa.size() == 102 && std::get<1>(soa[2]) == "100" && std::get<1>(soa.back()) == "199");
+  std::get<1>(soa[0]) = "first";
+  ftl::soa_vector<float, std::string, char> soa_copy{ soa };
+  assert(soa_copy.size() == soa.size() && std::get<1>(soa_copy[0]) == "first" && std::get<0>(soa_copy[101]) == 199.0f);
+  std::sort(soa.begin(), soa.end(), [](const auto &lhs, const auto &rhs) { return std::get<0>(lhs) > std::get<0>(rhs); });
+  assert(std::is_sorted(soa.get<0>().begin(), soa.get<0>().end(), std::greater<float>{}));
+  for (std::size_t i{ 0 }; i < soa.size(); ++i) {
+    // Sorting by the first field carried the other fields along.
+    const float key{ soa.get<0>()[i] };
+    if (key >= 100.0f) assert(std::get<1>(soa[i]) == std::to_string(static_cast<int>(key)));
+  }
+  soa.reserve(1000);
+  assert(soa.capacity() >= 1000 && soa.size() == 102 && std::get<0>(soa.front()) == 199.0f);
+  soa.shrink_to_fit();
+  assert(soa.capacity() == 102);
+  ftl::soa_vector<float, std::string, char> soa_moved{ std::move(soa) };
+  assert(soa.empty() && soa.capacity() == 0 && soa_moved.size() == 102);
+  ftl::soa_vector<int> soa_single{ std::make_tuple(3), std::make_tuple(1), std::make_tuple(2) };
+  std::sort(soa_single.begin(), soa_single.end());
+  assert(soa_single.get<0>()[0] == 1 && soa_single.get<0>()[1] == 2 && soa_single.get<0>()[2] == 3);
+  assert(ftl::sum(soa_single.get<0>()) == 6);
+  soa_single.resize(5);
+  assert(soa_single.size() == 5 && soa_single.get<0>()[4] == 0);
+  soa_single.insert(soa_single.begin() + 1, 2, std::make_tuple(7));
+  assert(soa_single.size() == 7 && soa_single.get<0>()[0] == 1 && soa_single.get<0>()[1] == 7 && soa_single.get<0>()[2] == 7 && soa_single.get<0>()[3] == 2);
+  ftl::soa_vector<int, std::string> soa_ops;
+  soa_ops.assign(3, std::make_tuple(1, std::string{ "one" }));
+  assert(soa_ops.size() == 3 && std::get<1>(soa_ops[2]) == "one");
+  soa_ops.assign({ std::make_tuple(2, std::string{ "two" }), std::make_tuple(3, std::string{ "three" }) });
+  const std::vector<std::tuple<int, std::string>> soa_rows{ std::make_tuple(7, std::string{ "seven" }), std::make_tuple(8, std::string{ "eight" }) };
+  assert(soa_ops.insert(soa_ops.begin() + 1, soa_rows.begin(), soa_rows.end()) == soa_ops.begin() + 1);
+  soa_ops.insert(soa_ops.end(), { std::make_tuple(9, std::string{ "nine" }) });
+  assert(soa_ops.emplace(soa_ops.begin(), 0, "zero") == soa_ops.begin());
+  // 0 2 7 8 3 9
+  assert(soa_ops.size() == 6 && soa_ops.get<0>()[2] == 7 && std::get<1>(soa_ops[3]) == "eight" && soa_ops.get<0>()[4] == 3 && std::get<1>(soa_ops.back()) == "nine");
+  assert(soa_rows.size() == 2 && std::get<1>(soa_rows[0]) == "seven");
+  const std::list<std::tuple<int, std::string>> soa_listed{ std::make_tuple(5, std::string{ "5" }), std::make_tuple(6, std::string{ "6" }) };
+  ftl::soa_vector<int, std::string> soa_assigned;
+  soa_assigned.assign(soa_ops.begin(), soa_ops.begin() + 2);
+  soa_assigned.insert(soa_assigned.begin() + 1, soa_listed.begin(), soa_listed.end());
+  assert(soa_assigned.size() == 4 && soa_assigned.get<0>()[1] == 5 && std::get<1>(soa_assigned[2]) == "6" && soa_assigned.get<0>()[3] == 2);
+  assert(std::get<1>(soa_ops[0]) == "zero");
+  soa_assigned.resize(6, std::make_tuple(4, std::string{ "four" }));
+  assert(soa_assigned.size() == 6 && std::get<1>(soa_assigned[5]) == "four");
+  soa_assigned.resize(2, std::make_tuple(4, std::string{ "four" }));
+  assert(soa_assigned.size() == 2);
+  ftl::soa_vector<std::string, throwing_copy> soa_mixed;
+  soa_mixed.reserve(2);
+  soa_mixed.emplace_back(std::string(32, 'x'), throwing_copy{});
+  soa_mixed.emplace_back(std::string(32, 'y'), throwing_copy{});
+  throwing_copy::copies_left = 1;
+  bool soa_mixed_threw{ false };
+  try {
+    soa_mixed.reserve(100);
+  }
+  catch (const std::runtime_error &) {
+    soa_mixed_threw = true;
+  }
+  // The strings were copied rather than moved, since the second field can't be moved without the risk of throwing.
+  assert(soa_mixed_threw && soa_mixed.size() == 2 && soa_mixed.capacity() == 2);
+  assert(std::get<0>(soa_mixed[0]) == std::string(32, 'x') && std::get<0>(soa_mixed[1]) == std::string(32, 'y'));
+
+  // concurrent_vector
+  ftl::concurrent_vector<std::string> cvec;
+  cvec.push_back("a");
+  std::string *cvec_first{ &cvec[0] };
+  auto cvec_batch = cvec.grow_by(100, std::string{ "b" });
+  assert(cvec.size() == 101 && *cvec_batch == "b" && cvec_batch - cvec.begin() == 1 && cvec.back() == "b");
+  assert(&cvec[0] == cvec_first && cvec.capacity() >= 101);
+  cvec.emplace_back(3, 'c');
+  cvec.grow_by({ std::string{ "d" }, std::string{ "e" } });
+  cvec.grow_to_at_least(200);
+  assert(cvec.size() == 200 && cvec[101] == "ccc" && cvec[103] == "e" && cvec[199].empty() && &cvec[0] == cvec_first);
+  ftl::concurrent_vector<std::string> cvec_copy{ cvec };
+  assert(cvec_copy.size() == 200 && std::equal(cvec.begin(), cvec.end(), cvec_copy.begin()));
+  cvec.clear();
+  assert(cvec.empty() && cvec.capacity() >= 200);
+  cvec.shrink_to_fit();
+  assert(cvec.capacity() == 0);
+  ftl::concurrent_vector<int> cints;
+  {
+    const int per_thread{ 10000 };
+    std::vector<std::thread> producers;
+    for (int t{ 0 }; t < 4; ++t) {
+      producers.emplace_back([&cints, t, per_thread] {
+        for (int i{ 0 }; i < per_thread; ++i) {
+          if (i % 100 == 0) {
+            auto it = cints.grow_by(10);
+            for (int j{ 0 }; j < 10; ++j) it[j] = t * per_thread + i + j;
+            i += 9;
+          }
+          else {
+            cints.push_back(t * per_thread + i);
+          }
+        }
+      });
+    }
+    for (auto &producer : producers) producer.join();
+    // Every value was appended exactly once, whichever thread won each index.
+    std::vector<int> seen(cints.begin(), cints.end());
+    std::sort(seen.begin(), seen.end());
+    assert(seen.size() == 4 * per_thread);
+    for (int i{ 0 }; i < 4 * per_thread; ++i) assert(seen[i] == i);
+  }
+
+  // segmented_vector
+  ftl::segmented_vector<std::string, ftl::default_allocator<std::string>, 4> seg;
+  seg.push_back("0");
+  std::string *seg_first{ &seg[0] };
+  for (int i{ 1 }; i < 10; ++i) {
+    seg.push_back(std::to_string(i));
+  }
+  assert(seg.size() == 10 && seg.capacity() == 12 && seg.block_count() == 3 && &seg[0] == seg_first && seg.back() == "9");
+  assert(seg.block(2).size() == 2 && seg.block(1)[3] == "7" && &seg.block(1)[0] + 1 == &seg[5]);
+  auto seg_it = seg.insert(seg.begin() + 2, 3, seg[9]);
+  assert(seg.size() == 13 && *seg_it == "9" && seg[4] == "9" && seg[5] == "2" && seg.back() == "9");
+  seg.insert(seg.begin(), { std::string{ "a" }, std::string{ "b" } });
+  seg.emplace(seg.end() - 1, 2, 'c');
+  assert(seg.size() == 16 && seg[0] == "a" && seg[2] == "0" && seg[14] == "cc" && seg[15] == "9");
+  seg.erase(seg.begin(), seg.begin() + 2);
+  seg.erase(seg.begin() + 2, seg.begin() + 5);
+  const std::vector<std::string> seg_expected{ "0", "1", "2", "3", "4", "5", "6", "7", "8", "cc", "9" };
+  assert(seg.size() == seg_expected.size() && std::equal(seg.begin(), seg.end(), seg_expected.begin()));
+  std::size_t seg_seen{ 0 };
+  seg.for_each_block([&](std::string *first, std::string *last) {
+    for (; first != last; ++first) assert(*first == seg_expected[seg_seen++]);
+  });
+  assert(seg_seen == seg.size());
+  seg.resize(3);
+  seg.shrink_to_fit();
+  assert(seg.size() == 3 && seg.capacity() == 4 && seg[2] == "2");
+  ftl::segmented_vector<std::string, ftl::default_allocator<std::string>, 4> seg_copy{ seg };
+  seg_copy.resize(9, "x");
+  assert(seg_copy.size() == 9 && seg_copy[8] == "x" && seg_copy[1] == "1" && seg.size() == 3);
+  seg = std::move(seg_copy);
+  assert(seg.size() == 9 && seg_copy.empty());
+  ftl::segmented_vector<int> seg_ints(5000, 1);
+  assert(ftl::segmented_vector<int>::block_size == 1024 && seg_ints.block_count() == 5);
+  long seg_sum{ 0 };
+  seg_ints.for_each_block([&](const int *first, const int *last) { seg_sum = std::accumulate(first, last, seg_sum); });
+  assert(seg_sum == 5000);
+
+  // parallel algorithms
+  ftl::thread_pool pool{ 4 };
+  assert(pool.size() == 4);
+  ftl::vector<int> par(100003, 0);
+  ftl::parallel_fill(par, 2, pool);
+  assert(std::count(par.begin(), par.end(), 2) == 100003);
+  ftl::parallel_for(par, [](int &x) { x *= 3; }, pool);
+  assert(ftl::parallel_reduce(par, 0L, pool) == 6L * 100003);
+  std::iota(par.begin(), par.end(), 0);
+  ftl::vector<long long> par_squares(par.size(), 0);
+  ftl::parallel_transform(par, par_squares, [](int x) { return static_cast<long long>(x) * x; }, pool);
+  assert(par_squares[100002] == 100002LL * 100002 && par_squares[7] == 49);
+  assert(ftl::parallel_reduce(par, 0LL, [](long long a, long long b) { return a > b ? a : b; }, pool) == 100002);
+  std::size_t par_chunks{ 0 };
+  ftl::parallel_for_chunks(par, [&](int *first, int *last) {
+    // Pieces never share a cache line with their neighbours, so only the ends may be unaligned.
+    assert(first == par.data() || reinterpret_cast<std::uintptr_t>(first) % 64 == 0 || last == par.data() + par.size());
+    static std::mutex chunk_mutex;
+    std::lock_guard<std::mutex> lock{ chunk_mutex };
+    par_chunks += static_cast<std::size_t>(last - first);
+  }, 1000, pool);
+  assert(par_chunks == par.size());
+  std::mt19937 par_rng{ 7 };
+  std::shuffle(par.begin(), par.end(), par_rng);
+  ftl::parallel_sort(par, std::less<int>{}, pool);
+  assert(std::is_sorted(par.begin(), par.end()) && par.front() == 0 && par.back() == 100002);
+  ftl::parallel_sort(par, std::greater<int>{});
+  assert(std::is_sorted(par.begin(), par.end(), std::greater<int>{}));
+  ftl::vector<std::string> par_strings;
+  for (int i{ 0 }; i < 20000; ++i) par_strings.push_back(std::to_string((i * 7919) % 20000));
+  ftl::parallel_sort(par_strings, std::less<std::string>{}, pool);
+  assert(std::is_sorted(par_strings.begin(), par_strings.end()) && par_strings.size() == 20000);
+  // Elements this large are sorted with a grain of one.
+  struct par_large {
+    int key;
+    char payload[16384];
+  };
+  ftl::vector<par_large> par_large_sorted;
+  par_large_sorted.resize(3);
+  for (int i{ 0 }; i < 3; ++i) par_large_sorted[i].key = i;
+  ftl::parallel_sort(par_large_sorted, [](const par_large &lhs, const par_large &rhs) { return lhs.key < rhs.key; }, pool);
+  assert(par_large_sorted[0].key == 0 && par_large_sorted[1].key == 1 && par_large_sorted[2].key == 2);
+  ftl::inline_vector<float, 8> par_inline{ 1.0f, 2.0f, 3.0f };
+  assert(ftl::parallel_reduce(par_inline, 0.5f, pool) == 6.5f);
+  bool par_threw{ false };
+  try {
+    ftl::parallel_for(par, [](int x) { if (x == 5000) throw std::runtime_error{ "5000" }; }, pool);
+  }
+  catch (const std::runtime_error &e) {
+    par_threw = std::string{ e.what() } == "5000";
+  }
+  assert(par_threw);
+
+  // mmap_allocator
+  ftl::vector<int, ftl::mmap_allocator<int, 4096>> mapped;
+  for (int i{ 0 }; i < 300000; ++i) mapped.push_back(i);
+  assert(mapped.size() == 300000 && mapped.capacity() >= 300000);
+  bool mapped_intact{ true };
+  for (int i{ 0 }; i < 300000; ++i) mapped_intact = mapped_intact && mapped[i] == i;
+  assert(mapped_intact);
+  mapped.shrink_to_fit();
+  mapped.erase(mapped.begin(), mapped.begin() + 299990);
+  mapped.shrink_to_fit();
+  assert(mapped.size() == 10 && mapped.front() == 299990 && mapped.back() == 299999);
+  ftl::mmap_allocator<int, 4096> mapped_alloc;
+  auto mapped_block = ftl::allocate_at_least(mapped_alloc, 1000);
+  assert(mapped_block.count >= 1000);
+  mapped_block.ptr[mapped_block.count - 1] = 7;
+  auto remapped = ftl::reallocate(mapped_alloc, mapped_block.ptr, mapped_block.count, 100000);
+  assert(remapped.count >= 100000 && remapped.ptr[mapped_block.count - 1] == 7);
+  mapped_alloc.deallocate(remapped.ptr, remapped.count);
+  // inline_vector never hands its inline buffer to reallocate.
+  ftl::inline_vector<int, 4, ftl::mmap_allocator<int, 64>> mapped_inline{ 1, 2, 3, 4 };
+  for (int i{ 5 }; i <= 100; ++i) mapped_inline.push_back(i);
+  assert(mapped_inline.size() == 100 && mapped_inline[3] == 4 && mapped_inline[99] == 100);
+  ftl::vector<std::string, ftl::mmap_allocator<std::string, 64>> mapped_strings;
+  for (int i{ 0 }; i < 100; ++i) mapped_strings.push_back(std::to_string(i));
+  assert(mapped_strings[42] == "42");
+
+  // mapped_vector
+#if FTL_HAS_MMAP
+  const char *mapped_path{ "ftl_mapped_vector_test.bin" };
+  std::remove(mapped_path);
+  {
+    ftl::mapped_vector<std::uint64_t> table{ mapped_path };
+    assert(table.is_open() && table.empty() && !table.read_only());
+    for (std::uint64_t i{ 0 }; i < 100000; ++i) table.push_back(i * 3);
+    table.insert(table.begin(), 2, 7);
+    table.erase(table.begin() + 1);
+    table.push_back(table[0]);
+    table.flush();
+    table.advise(ftl::access_pattern::sequential);
+    assert(table.size() == 100002 && table.front() == 7 && table[1] == 0 && table.back() == 7);
+  }
+  {
+    ftl::mapped_vector<std::uint64_t> table{ mapped_path, ftl::map_mode::read_only };
+    assert(table.read_only() && table.size() == 100002 && table.capacity() == table.size());
+    assert(table[100000] == 99999 * 3 && std::accumulate(table.begin() + 1, table.end() - 1, std::uint64_t{ 0 }) == 3ull * 99999 * 100000 / 2);
+  }
+  {
+    ftl::mapped_vector<std::uint64_t> table{ mapped_path };
+    table.resize(10);
+    table.resize(12, 5);
+    assert(table.size() == 12 && table[9] == 8 * 3 && table[11] == 5);
+    ftl::mapped_vector<std::uint64_t> moved{ std::move(table) };
+    assert(!table.is_open() && moved.size() == 12);
+  }
+  bool mapped_rejected{ false };
+  try {
+    ftl::mapped_vector<std::uint32_t> wrong{ mapped_path, ftl::map_mode::read_only };
+  }
+  catch (const std::runtime_error &) {
+    mapped_rejected = true;
+  }
+  assert(mapped_rejected);
+  std::remove(mapped_path);
+  {
+    // Forward ranges are inserted with a single shift of the tail, input ranges an element at a time.
+    ftl::mapped_vector<int> ranges{ mapped_path };
+    ranges.insert(ranges.end(), { 1, 2, 3 });
+    const std::vector<int> middle{ 10, 11, 12, 13 };
+    assert(ranges.insert(ranges.begin() + 1, middle.begin(), middle.end()) == ranges.begin() + 1);
+    std::istringstream words{ "20 21" };
+    ranges.insert(ranges.end() - 1, std::istream_iterator<int>{ words }, std::istream_iterator<int>{});
+    const int expected_ranges[]{ 1, 10, 11, 12, 13, 2, 20, 21, 3 };
+    assert(ranges.size() == 9 && std::equal(ranges.begin(), ranges.end(), std::begin(expected_ranges)));
+    assert(*ranges.emplace(ranges.begin() + 2, 7) == 7 && ranges[1] == 10 && ranges[2] == 7 && ranges[3] == 11);
+    assert(*ranges.emplace(ranges.end(), ranges.front()) == 1 && ranges.size() == 11);
+    ranges.assign(3, ranges[4]);
+    assert(ranges.size() == 3 && ranges[0] == 12 && ranges[2] == 12);
+    ranges.assign(middle.begin(), middle.end());
+    assert(ranges.size() == 4 && std::equal(ranges.begin(), ranges.end(), middle.begin()));
+    std::istringstream more_words{ "30 31 32" };
+    ranges.assign(std::istream_iterator<int>{ more_words }, std::istream_iterator<int>{});
+    assert(ranges.size() == 3 && ranges[0] == 30 && ranges[2] == 32);
+    ranges.assign({ 5, 6 });
+    assert(ranges.size() == 2 && ranges[0] == 5 && ranges[1] == 6);
+  }
+  std::remove(mapped_path);
+#endif
+
+  // snapshots
+#if FTL_HAS_SNAPSHOT
+  const char *snapshot_path{ "ftl_snapshot_test.bin" };
+  const int snapshot_fd{ ::open(snapshot_path, O_RDWR | O_CREAT | O_TRUNC, 0644) };
+  assert(snapshot_fd >= 0);
+  ftl::vector<int> snap_ints(50000, 0);
+  std::iota(snap_ints.begin(), snap_ints.end(), -7);
+  ftl::vector<std::string> snap_strings{ "", "a", std::string(3000000, 'x'), "last" };
+  ftl::vector<ftl::vector<std::string>> snap_nested{ { "x", "yy" }, {}, { "zzz" } };
+  std::int64_t snap_offset{ ftl::save_at(snapshot_fd, 0, snap_ints) };
+  const std::int64_t snap_strings_at{ snap_offset };
+  snap_offset = ftl::save_at(snapshot_fd, snap_offset, snap_strings);
+  const std::int64_t snap_nested_at{ snap_offset };
+  snap_offset = ftl::save_at(snapshot_fd, snap_offset, snap_nested);
+  assert(snap_strings_at == 32 + 50000 * 4);
+  ftl::inline_vector<int, 8> snap_ints_loaded{ 1, 2, 3 };
+  assert(ftl::load_at(snapshot_fd, 0, snap_ints_loaded) == snap_strings_at);
+  assert(snap_ints_loaded.size() == 50000 && std::equal(snap_ints.begin(), snap_ints.end(), snap_ints_loaded.begin()));
+  ftl::unordered_vector<std::string> snap_strings_loaded;
+  assert(ftl::load_at(snapshot_fd, snap_strings_at, snap_strings_loaded) == snap_nested_at);
+  assert(snap_strings_loaded.size() == 4 && snap_strings_loaded[2] == snap_strings[2] && snap_strings_loaded[3] == "last");
+  ftl::vector<ftl::vector<std::string>> snap_nested_loaded;
+  assert(ftl::load_at(snapshot_fd, snap_nested_at, snap_nested_loaded) == snap_offset);
+  assert(snap_nested_loaded.size() == 3 && snap_nested_loaded[0][1] == "yy" && snap_nested_loaded[1].empty() && snap_nested_loaded[2][0] == "zzz");
+  {
+    // Loading a chunk at a time, as for snapshots larger than memory.
+    ftl::snapshot_reader in{ snapshot_fd, 0 };
+    assert(in.begin<int>() == 50000);
+    ftl::vector<int> chunk;
+    long long chunk_sum{ 0 };
+    std::size_t chunks{ 0 };
+    while (in.remaining()) {
+      chunk.clear();
+      in.read(chunk, 4096);
+      chunk_sum = std::accumulate(chunk.begin(), chunk.end(), chunk_sum);
+      ++chunks;
+    }
+    in.finish();
+    assert(chunks == 13 && chunk_sum == std::accumulate(snap_ints.begin(), snap_ints.end(), 0LL));
+  }
+  bool snap_rejected{ false };
+  try {
+    ftl::vector<std::int64_t> wrong;
+    ftl::load_at(snapshot_fd, 0, wrong);
+  }
+  catch (const std::runtime_error &) {
+    snap_rejected = true;
+  }
+  assert(snap_rejected);
+  ::close(snapshot_fd);
+  std::remove(snapshot_path);
+  {
+    // Back to back snapshots through a pipe, written a chunk at a time with small frames.
+    int snap_pipe[2];
+    assert(::pipe(snap_pipe) == 0);
+    ftl::snapshot_writer out{ snap_pipe[1], -1, 16 };
+    out.begin<std::string>(3);
+    out.append(snap_strings.data(), 2);
+    out.append(snap_strings.data() + 3, 1);
+    out.finish();
+    ftl::vector<short> snap_shorts(100, 3);
+    out.save(snap_shorts);
+    ftl::snapshot_reader in{ snap_pipe[0] };
+    ftl::vector<std::string> piped_strings;
+    in.load(piped_strings);
+    ftl::vector<short> piped_shorts;
+    in.load(piped_shorts);
+    assert(piped_strings.size() == 3 && piped_strings[1] == "a" && piped_strings[2] == "last");
+    assert(piped_shorts.size() == 100 && piped_shorts[99] == 3);
+    ::close(snap_pipe[0]);
+    ::close(snap_pipe[1]);
+  }
+#endif
+
+  // arena
+  {
+    ftl::arena request_arena{ 256 };
+    ftl::arena_allocator<int> arena_ints{ request_arena };
+    ftl::vector<int, ftl::arena_allocator<int>> ids{ arena_ints };
+    for (int i{ 0 }; i < 1000; ++i) ids.push_back(i);
+    assert(ids.size() == 1000 && ids[999] == 999);
+    // The vector grows in place while it is at the top of the arena's current chunk.
+    ftl::arena roomy_arena{ 1 << 16 };
+    ftl::vector<int, ftl::arena_allocator<int>> in_place{ ftl::arena_allocator<int>{ roomy_arena } };
+    in_place.push_back(1);
+    const int *in_place_data{ in_place.data() };
+    for (int i{ 0 }; i < 1000; ++i) in_place.push_back(i);
+    assert(in_place.data() == in_place_data && roomy_arena.stats().used_bytes == in_place.capacity() * sizeof(int));
+    ftl::vector<double, ftl::arena_allocator<double>> weights{ ftl::arena_allocator<double>{ arena_ints } };
+    weights.assign(100, 0.5);
+    assert(reinterpret_cast<std::uintptr_t>(weights.data()) % alignof(double) == 0);
+    ftl::vector<std::string, ftl::arena_allocator<std::string>> names{ ftl::arena_allocator<std::string>{ request_arena } };
+    for (int i{ 0 }; i < 50; ++i) names.push_back(std::to_string(i));
+    assert(names[49] == "49" && ids.get_allocator() == weights.get_allocator());
+    ftl::vector<int, ftl::arena_allocator<int>> moved_ids{ std::move(ids) };
+    moved_ids.push_back(1000);
+    assert(moved_ids.size() == 1001);
+    void *top{ request_arena.allocate(64, 64) };
+    assert(reinterpret_cast<std::uintptr_t>(top) % 64 == 0);
+    const std::size_t used{ request_arena.stats().used_bytes };
+    request_arena.deallocate(top, 64);
+    assert(request_arena.stats().used_bytes == used - 64);
+    assert(request_arena.allocate(64, 64) == top);
+    names.clear();
+    const ftl::arena_stats before_reset{ request_arena.stats() };
+    assert(before_reset.chunks > 1 && before_reset.peak_used_bytes >= before_reset.used_bytes);
+    request_arena.reset();
+    const ftl::arena_stats after_reset{ request_arena.stats() };
+    assert(after_reset.used_bytes == 0 && after_reset.chunks == before_reset.chunks && after_reset.resets == 1);
+    // Retained chunks are reused rather than allocated again.
+    void *big{ request_arena.allocate(before_reset.reserved_bytes / 4) };
+    assert(big && request_arena.stats().reserved_bytes == before_reset.reserved_bytes);
+    request_arena.release();
+    assert(request_arena.stats().chunks == 0 && request_arena.stats().reserved_bytes == 0);
+    ids = ftl::vector<int, ftl::arena_allocator<int>>{ arena_ints };
+    weights = ftl::vector<double, ftl::arena_allocator<double>>{ ftl::arena_allocator<double>{ request_arena } };
+    moved_ids = ftl::vector<int, ftl::arena_allocator<int>>{ arena_ints };
+  }
+
+  // pool_allocator
+  {
+    ftl::block_pool pool;
+    ftl::pool_allocator<int, 16> pooled_ints{ pool };
+    int *first_block{ pooled_ints.allocate(3) };
+    int *second_block{ pooled_ints.allocate(4) };
+    assert(first_block != second_block && pool.stats().live_blocks == 2 && pool.stats().slabs == 1);
+    pooled_ints.deallocate(first_block, 3);
+    // The freed block is the first one reused, and sizes in the same class share it.
+    assert(pooled_ints.allocate(2) == first_block);
+    auto pooled_room = ftl::allocate_at_least(pooled_ints, 5);
+    assert(pooled_room.count == 8 && reinterpret_cast<std::uintptr_t>(pooled_room.ptr) % 16 == 0);
+    pooled_ints.deallocate(pooled_room.ptr, pooled_room.count);
+    int *large_block{ pooled_ints.allocate(1000) };
+    assert(pool.stats().live_blocks == 2);
+    pooled_ints.deallocate(large_block, 1000);
+    pooled_ints.deallocate(first_block, 2);
+    pooled_ints.deallocate(second_block, 4);
+    assert(pool.stats().live_blocks == 0);
+    // Slabs only go back to the heap once all their blocks are free.
+    ftl::vector<double*> pooled_blocks;
+    ftl::pool_allocator<double, 16> pooled_doubles{ pooled_ints };
+    for (int i{ 0 }; i < 1000; ++i) pooled_blocks.push_back(pooled_doubles.allocate(2));
+    const std::size_t pooled_slabs{ pool.stats().slabs };
+    assert(pooled_slabs > 4);
+    for (std::size_t i{ 1 }; i < pooled_blocks.size(); ++i) pooled_doubles.deallocate(pooled_blocks[i], 2);
+    pool.release_unused();
+    assert(pool.stats().slabs == 1 && pool.stats().live_blocks == 1);
+    assert(pooled_doubles.allocate(2) != pooled_blocks[0]);
+    pool.release_unused();
+    assert(pool.stats().slabs == 1 && pool.stats().live_blocks == 2);
+    ftl::vector<std::string, ftl::pool_allocator<std::string, 8>> pooled_strings{ ftl::pool_allocator<std::string, 8>{ pool } };
+    for (int i{ 0 }; i < 100; ++i) pooled_strings.push_back(std::to_string(i));
+    assert(pooled_strings.size() == 100 && pooled_strings[99] == "99");
+  }
+  ftl::inline_vector<int, 4, ftl::pool_allocator<int>> pooled_inline{ 1, 2, 3, 4, 5, 6 };
+  pooled_inline.push_back(7);
+  assert(pooled_inline.size() == 7 && pooled_inline[6] == 7);
+  assert(ftl::block_pool::thread_default().stats().live_blocks == 1);
+
+  // linear_stack_allocator
+  {
+    ftl::linear_stack_allocator<int, 64> frame;
+    int *bottom{ frame.allocate(8) };
+    int *top{ frame.allocate(8) };
+    assert(top == bottom + 8 && frame.available() == 48);
+    // Only the topmost block is reclaimed; the one below it was freed first, so its space stays taken.
+    frame.deallocate(bottom, 8);
+    assert(frame.available() == 48);
+    frame.deallocate(top, 8);
+    assert(frame.available() == 56);
+    {
+      ftl::linear_stack_allocator<int, 64>::scope scratch{ frame };
+      frame.allocate(20);
+      frame.allocate(20);
+      assert(frame.available() == 16);
+    }
+    assert(frame.available() == 56 && frame.allocate(4) == bottom + 8);
+    const auto mark = frame.marker();
+    frame.allocate(10);
+    frame.rewind(mark);
+    assert(frame.marker() == mark);
+    bool frame_overflowed{ false };
+    try {
+      frame.allocate(100);
+    }
+    catch (const std::bad_alloc &) {
+      frame_overflowed = true;
+    }
+    assert(frame_overflowed && frame == frame && !(frame == ftl::linear_stack_allocator<int, 64>{}));
+    // Blocks freed out of order leave holes, which only a rewind reclaims.
+    const auto holes = frame.marker();
+    int *first_block{ frame.allocate(4) };
+    int *middle_block{ frame.allocate(4) };
+    int *last_block{ frame.allocate(4) };
+    frame.deallocate(middle_block, 4);
+    frame.deallocate(first_block, 4);
+    assert(frame.marker() == holes + 12);
+    frame.deallocate(last_block, 4);
+    assert(frame.marker() == holes + 8 && frame.allocate(4) == last_block);
+    frame.rewind(holes);
+    assert(frame.allocate(4) == first_block);
+
+    // A vector on top of the buffer grows in place.
+    ftl::vector<int, ftl::linear_stack_allocator<int, 256>> stacked;
+    stacked.push_back(0);
+    const int *stacked_data{ stacked.data() };
+    for (int i{ 1 }; i < 200; ++i) stacked.push_back(i);
+    assert(stacked.data() == stacked_data && stacked.size() == 200 && stacked[199] == 199);
+    // With the heap fallback it moves to the heap once the buffer is full.
+    ftl::vector<int, ftl::linear_stack_allocator<int, 32, true>> spilled;
+    for (int i{ 0 }; i < 1000; ++i) spilled.push_back(i);
+    assert(spilled.size() == 1000 && spilled[999] == 999 && spilled[31] == 31);
+    ftl::vector<std::string, ftl::linear_stack_allocator<std::string, 64, true>> stacked_strings;
+    for (int i{ 0 }; i < 100; ++i) stacked_strings.push_back(std::to_string(i));
+    assert(stacked_strings[99] == "99");
+  }
+
+  // over-aligned storage
+  {
+    ftl::vector<over_aligned> wide;
+    for (int i{ 0 }; i < 100; ++i) wide.push_back(i);
+    assert(is_aligned(wide.data(), 128) && wide[99].value == 99);
+    ftl::inline_vector<over_aligned, 3> wide_inline{ 1, 2 };
+    assert(is_aligned(wide_inline.data(), 128));
+    // Blocks which spill out of a stack buffer keep the type's alignment.
+    ftl::vector<over_aligned, ftl::linear_stack_allocator<over_aligned, 4, true>> wide_spilled;
+    bool wide_spilled_aligned{ true };
+    for (int i{ 0 }; i < 500; ++i) {
+      wide_spilled.push_back(i);
+      wide_spilled_aligned = wide_spilled_aligned && is_aligned(wide_spilled.data(), 128);
+    }
+    assert(wide_spilled_aligned && wide_spilled[499].value == 499);
+    ftl::aligned_vector<float> lanes;
+    lanes.push_back(1.0f);
+    // Blocks are rounded up to whole cache lines.
+    assert(is_aligned(lanes.data(), 64) && lanes.capacity() == 16);
+    for (int i{ 0 }; i < 1000; ++i) lanes.push_back(static_cast<float>(i));
+    assert(is_aligned(lanes.data(), 64) && lanes.capacity() % 16 == 0 && lanes[1000] == 999.0f);
+    ftl::aligned_vector<char, 4096> page{ 'a' };
+    assert(is_aligned(page.data(), 4096));
+    ftl::inline_vector<float, 8, ftl::aligned_allocator<float, 32>> small_lanes{ 1.0f, 2.0f };
+    assert(is_aligned(small_lanes.data(), 32) && alignof(decltype(small_lanes)) >= 32);
+    for (int i{ 0 }; i < 20; ++i) small_lanes.push_back(static_cast<float>(i));
+    assert(is_aligned(small_lanes.data(), 32) && small_lanes.size() == 22);
+    ftl::aligned_allocator<double> rebound{ ftl::aligned_allocator<float>{} };
+    assert(rebound == ftl::aligned_allocator<float>{} && ftl::aligned_allocator<over_aligned>::alignment == 128);
+  }
+
+  // tracking_allocator
+  {
+    static ftl::allocation_tag mesh_tag{ "mesh \"vertices\"" };
+    static ftl::allocation_tag scratch_tag{ "scratch" };
+    using tracked_ints = ftl::tracking_allocator<ftl::default_allocator<int>>;
+    {
+      ftl::vector<int, tracked_ints> vertices{ tracked_ints{ mesh_tag } };
+      for (int i{ 0 }; i < 100; ++i) vertices.push_back(i);
+      const ftl::allocation_stats grown{ mesh_tag.stats() };
+      assert(grown.allocations > 1 && grown.allocations == grown.deallocations + 1);
+      assert(grown.live_bytes == vertices.capacity() * sizeof(int) && grown.peak_bytes >= grown.live_bytes);
+      std::uint64_t histogram_total{ 0 };
+      for (std::uint64_t count : grown.histogram) histogram_total += count;
+      assert(histogram_total == grown.allocations);
+      ftl::inline_vector<int, 4, tracked_ints> corners{ tracked_ints{ scratch_tag } };
+      for (int i{ 0 }; i < 4; ++i) corners.push_back(i);
+      assert(scratch_tag.stats().allocations == 0);
+      corners.push_back(4);
+      ftl::unordered_vector<int, tracked_ints> pending{ tracked_ints{ scratch_tag } };
+      pending.assign(50, 7);
+      assert(scratch_tag.stats().allocations == 2);
+      // Vectors can't hand buffers to another tag, so the move relocates and each tag accounts for its own block.
+      ftl::vector<int, tracked_ints> copied{ tracked_ints{ scratch_tag } };
+      copied = std::move(vertices);
+      assert(copied.size() == 100 && vertices.empty() && scratch_tag.stats().allocations == 3);
+      ftl::vector<int, tracked_ints> duplicate{ copied };
+      assert(&duplicate.get_allocator().tag() == &scratch_tag);
+    }
+    assert(mesh_tag.stats().live_bytes == 0 && scratch_tag.stats().live_bytes == 0 && scratch_tag.stats().peak_bytes > 0);
+    // Counting is lock-free and exact across threads.
+    scratch_tag.reset();
+    std::vector<std::thread> tracked_threads;
+    for (int t{ 0 }; t < 4; ++t) {
+      tracked_threads.emplace_back([] {
+        for (int i{ 0 }; i < 1000; ++i) {
+          ftl::vector<int, tracked_ints> local{ tracked_ints{ scratch_tag } };
+          local.push_back(i);
+        }
+      });
+    }
+    for (auto &thread : tracked_threads) thread.join();
+    assert(scratch_tag.stats().allocations == 4000 && scratch_tag.stats().deallocations == 4000 && scratch_tag.stats().live_bytes == 0);
+    {
+      // Blocks outliving a reset are still accounted for when they are freed.
+      ftl::vector<int, tracked_ints> survivor{ tracked_ints{ mesh_tag } };
+      survivor.reserve(100);
+      survivor.push_back(1);
+      mesh_tag.reset();
+      assert(mesh_tag.stats().live_bytes == 400 && mesh_tag.stats().peak_bytes == 400 && mesh_tag.stats().allocations == 0);
+      survivor.shrink_to_fit();
+      assert(mesh_tag.stats().live_bytes == 4 && mesh_tag.stats().peak_bytes == 404 && mesh_tag.stats().deallocations == 1);
+    }
+    assert(mesh_tag.stats().live_bytes == 0);
+    ftl::vector<float, ftl::tracking_allocator<ftl::aligned_allocator<float>>> tracked_lanes{ { 1.0f, 2.0f } };
+    assert(is_aligned(tracked_lanes.data(), 64) && ftl::allocation_tag::untagged().stats().live_bytes == 64);
+    std::ostringstream text_report, json_report;
+    ftl::write_allocation_report(text_report);
+    ftl::write_allocation_report(json_report, ftl::report_format::json);
+    assert(text_report.str().find("scratch") != std::string::npos);
+    assert(json_report.str().find("{\"tag\":\"mesh \\\"vertices\\\"\",\"allocations\":") != std::string::npos);
+    assert(json_report.str().front() == '[' && json_report.str().find("\"peak_bytes\":") != std::string::npos);
+  }
+
+  // stateful allocators
+  {
+    using arena_vector = ftl::vector<std::string, ftl::arena_allocator<std::string>>;
+    ftl::arena shared_arena, other_arena;
+    ftl::arena_allocator<std::string> shared{ shared_arena }, other{ other_arena };
+    arena_vector source{ shared };
+    for (int i{ 0 }; i < 20; ++i) source.push_back(std::to_string(i));
+    // Vectors sharing an arena hand their buffer over.
+    const std::string *source_data{ source.data() };
+    arena_vector stolen{ std::move(source) };
+    assert(stolen.data() == source_data && source.empty() && source.capacity() == 0);
+    arena_vector sharing{ shared };
+    sharing = std::move(stolen);
+    assert(sharing.data() == source_data && sharing.size() == 20);
+    // Across arenas the allocator stays put and the elements are relocated into its memory.
+    arena_vector elsewhere{ other };
+    elsewhere.push_back("x");
+    const std::size_t other_used{ other_arena.stats().used_bytes };
+    elsewhere = std::move(sharing);
+    assert(elsewhere.get_allocator() == other && elsewhere.size() == 20 && elsewhere[19] == "19" && sharing.empty());
+    assert(other_arena.stats().used_bytes > other_used);
+    arena_vector swapped{ shared };
+    swapped.push_back("y");
+    swapped.swap(elsewhere);
+    assert(swapped.size() == 20 && swapped[0] == "0" && elsewhere.size() == 1 && elsewhere[0] == "y");
+    assert(swapped.get_allocator() == shared && elsewhere.get_allocator() == other);
+    ftl::inline_vector<std::string, 2, ftl::arena_allocator<std::string>> small_a{ shared }, small_b{ other };
+    small_a.push_back("a");
+    for (int i{ 0 }; i < 5; ++i) small_b.push_back(std::to_string(i));
+    small_a.swap(small_b);
+    assert(small_a.size() == 5 && small_a[4] == "4" && small_b.size() == 1 && small_b[0] == "a");
+    assert(small_a.get_allocator() == shared && small_b.get_allocator() == other);
+    small_a = std::move(small_b);
+    assert(small_a.size() == 1 && small_a[0] == "a" && small_a.get_allocator() == shared);
+
+    // Buffers of a linear_stack_allocator can't change hands, so moves relocate.
+    ftl::vector<int, ftl::linear_stack_allocator<int, 64>> framed;
+    for (int i{ 0 }; i < 10; ++i) framed.push_back(i);
+    ftl::vector<int, ftl::linear_stack_allocator<int, 64>> reframed{ std::move(framed) };
+    assert(reframed.size() == 10 && reframed[9] == 9 && reframed.data() != framed.data());
+
+    using propagating_vector = ftl::vector<std::string, propagating_allocator<std::string>>;
+    propagating_vector first{ propagating_allocator<std::string>{ 1 } }, second{ propagating_allocator<std::string>{ 2 } };
+    first.push_back("first");
+    second.push_back("second");
+    propagating_vector copy{ first };
+    assert(copy.get_allocator().id == 101 && copy[0] == "first");
+    copy = second;
+    assert(copy.get_allocator().id == 2 && copy[0] == "second");
+    const std::string *second_data{ second.data() };
+    first = std::move(second);
+    assert(first.get_allocator().id == 2 && first.data() == second_data);
+    propagating_vector third{ propagating_allocator<std::string>{ 3 } };
+    third.push_back("third");
+    first.swap(third);
+    assert(first.get_allocator().id == 3 && first[0] == "third" && third.get_allocator().id == 2 && third[0] == "second");
+    ftl::inline_vector<std::string, 2, propagating_allocator<std::string>> inline_first{ propagating_allocator<std::string>{ 1 } };
+    ftl::inline_vector<std::string, 2, propagating_allocator<std::string>> inline_second{ propagating_allocator<std::string>{ 2 } };
+    inline_first.push_back("1");
+    for (int i{ 0 }; i < 4; ++i) inline_second.push_back(std::to_string(i));
+    inline_first.swap(inline_second);
+    assert(inline_first.get_allocator().id == 2 && inline_first.size() == 4 && inline_second.get_allocator().id == 1 && inline_second[0] == "1");
+
+    // soa_vector propagates its allocator the same way.
+    using propagating_soa = ftl::basic_soa_vector<propagating_allocator<char>, ftl::default_growth, int, std::string>;
+    propagating_soa soa_first{ propagating_allocator<char>{ 1 } }, soa_second{ propagating_allocator<char>{ 2 } };
+    soa_first.emplace_back(1, "first");
+    soa_second.emplace_back(2, "second");
+    propagating_soa soa_copy{ soa_first };
+    assert(soa_copy.get_allocator().id == 101 && std::get<1>(soa_copy[0]) == "first");
+    soa_copy = soa_second;
+    assert(soa_copy.get_allocator().id == 2 && std::get<1>(soa_copy[0]) == "second");
+    const int *soa_second_data{ soa_second.data<0>() };
+    soa_first = std::move(soa_second);
+    assert(soa_first.get_allocator().id == 2 && soa_first.data<0>() == soa_second_data && soa_second.empty());
+    propagating_soa soa_third{ propagating_allocator<char>{ 3 } };
+    soa_third.emplace_back(3, "third");
+    soa_first.swap(soa_third);
+    assert(soa_first.get_allocator().id == 3 && std::get<1>(soa_first[0]) == "third" && soa_third.get_allocator().id == 2);
+    using arena_soa = ftl::basic_soa_vector<ftl::arena_allocator<char>, ftl::default_growth, int, std::string>;
+    arena_soa soa_shared{ ftl::arena_allocator<char>{ shared_arena } }, soa_other{ ftl::arena_allocator<char>{ other_arena } };
+    for (int i{ 0 }; i < 5; ++i) soa_shared.emplace_back(i, std::to_string(i));
+    soa_other.emplace_back(-1, "x");
+    soa_shared.swap(soa_other);
+    assert(soa_shared.size() == 1 && std::get<1>(soa_shared[0]) == "x" && soa_other.size() == 5 && std::get<1>(soa_other[4]) == "4");
+    assert(soa_shared.get_allocator() == ftl::arena_allocator<char>{ shared_arena } && soa_other.get_allocator() == ftl::arena_allocator<char>{ other_arena });
+    soa_shared = std::move(soa_other);
+    assert(soa_shared.size() == 5 && std::get<0>(soa_shared[2]) == 2 && soa_other.empty());
+    assert(soa_shared.get_allocator() == ftl::arena_allocator<char>{ shared_arena });
+  }
+
   return 0;
 }
\ No newline at end of file
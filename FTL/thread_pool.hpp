@@ -0,0 +1,395 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "vector.hpp" // ftl::vector
+
+#include <atomic> // atomic, atomic_thread_fence
+#include <condition_variable> // condition_variable
+#include <cstddef> // size_t
+#include <cstdint> // int64_t, uint32_t
+#include <exception> // exception_ptr
+#include <memory> // unique_ptr
+#include <mutex> // mutex, unique_lock
+#include <thread> // thread, yield
+#include <utility> // forward, move
+
+namespace ftl {
+
+  class thread_pool;
+
+  namespace detail {
+    // The unit of work the pool schedules. Tasks live on the stack of the thread which forks them, since a fork
+    // always joins before returning, so scheduling one never allocates.
+    struct pool_task {
+      explicit pool_task(void (*run)(pool_task&)) noexcept : execute(run) {}
+      // Never throws: closure_task catches whatever the work throws.
+      void (*execute)(pool_task&);
+      ::std::atomic<bool> done{ false };
+      // Set for tasks submitted from outside the pool, whose submitter sleeps until done.
+      bool injected{ false };
+    };
+
+    // A task running a callable, keeping whatever it throws for the thread that joins it.
+    template<typename Function>
+    struct closure_task : pool_task {
+      explicit closure_task(Function &f) noexcept : pool_task(&run), function(f) {}
+      static void run(pool_task &task) noexcept {
+        closure_task &self = static_cast<closure_task&>(task);
+        try {
+          self.function();
+        }
+        catch (...) {
+          self.error = ::std::current_exception();
+        }
+        task.done.store(true, ::std::memory_order_release);
+      }
+      Function &function;
+      ::std::exception_ptr error;
+    };
+
+    // A Chase-Lev work-stealing deque, with the memory orders of Le, Pop, Cohen and Zappa Nardelli,
+    // "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+    // The owning thread pushes and pops at the bottom, LIFO, so it keeps working on the data it just touched.
+    // Any thread may steal from the top, FIFO, which takes the oldest and so usually the largest piece of work.
+    // The buffer grows when full. Outgrown buffers are kept until the deque dies, as a thief may still be reading one.
+    template<typename T>
+    class work_stealing_deque {
+      static_assert(::std::is_pointer<T>::value, "work_stealing_deque holds pointers, so an empty result can be nullptr.");
+    public:
+      explicit work_stealing_deque(::std::size_t capacity = 256) {
+        m_buffers.emplace_back(new buffer{ capacity });
+        m_buffer.store(m_buffers.back().get(), ::std::memory_order_relaxed);
+      }
+
+      // Owner only.
+      void push(T item) {
+        const ::std::int64_t bottom{ m_bottom.load(::std::memory_order_relaxed) };
+        const ::std::int64_t top{ m_top.load(::std::memory_order_acquire) };
+        buffer *items{ m_buffer.load(::std::memory_order_relaxed) };
+        if (bottom - top > static_cast<::std::int64_t>(items->mask)) {
+          items = grow(items, top, bottom);
+        }
+        items->put(bottom, item);
+        // A release store rather than the paper's release fence and relaxed store: the same cost, and race detectors
+        // which do not model fences understand it.
+        m_bottom.store(bottom + 1, ::std::memory_order_release);
+      }
+
+      // Owner only. Returns nullptr when empty.
+      T pop() noexcept {
+        const ::std::int64_t bottom{ m_bottom.load(::std::memory_order_relaxed) - 1 };
+        buffer *items{ m_buffer.load(::std::memory_order_relaxed) };
+        m_bottom.store(bottom, ::std::memory_order_relaxed);
+        ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+        ::std::int64_t top{ m_top.load(::std::memory_order_relaxed) };
+        if (top > bottom) {
+          m_bottom.store(bottom + 1, ::std::memory_order_relaxed);
+          return nullptr;
+        }
+        T item{ items->get(bottom) };
+        if (top == bottom) {
+          // The last item: race the thieves for it.
+          if (!m_top.compare_exchange_strong(top, top + 1, ::std::memory_order_seq_cst, ::std::memory_order_relaxed)) {
+            item = nullptr;
+          }
+          m_bottom.store(bottom + 1, ::std::memory_order_relaxed);
+        }
+        return item;
+      }
+
+      // Any thread. Returns nullptr when empty or when another thread won the race for the top item.
+      T steal() noexcept {
+        ::std::int64_t top{ m_top.load(::std::memory_order_acquire) };
+        ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+        const ::std::int64_t bottom{ m_bottom.load(::std::memory_order_acquire) };
+        if (top >= bottom) return nullptr;
+        T item{ m_buffer.load(::std::memory_order_acquire)->get(top) };
+        if (!m_top.compare_exchange_strong(top, top + 1, ::std::memory_order_seq_cst, ::std::memory_order_relaxed)) {
+          return nullptr;
+        }
+        return item;
+      }
+
+      bool empty() const noexcept {
+        return m_top.load(::std::memory_order_relaxed) >= m_bottom.load(::std::memory_order_relaxed);
+      }
+
+    private:
+      struct buffer {
+        explicit buffer(::std::size_t capacity) : mask(capacity - 1), items(new ::std::atomic<T>[capacity]) {}
+        T get(::std::int64_t i) const noexcept { return items[static_cast<::std::size_t>(i) & mask].load(::std::memory_order_relaxed); }
+        void put(::std::int64_t i, T item) noexcept { items[static_cast<::std::size_t>(i) & mask].store(item, ::std::memory_order_relaxed); }
+        ::std::size_t mask;
+        ::std::unique_ptr<::std::atomic<T>[]> items;
+      };
+
+      buffer* grow(buffer *old, ::std::int64_t top, ::std::int64_t bottom) {
+        m_buffers.emplace_back(new buffer{ (old->mask + 1) * 2 });
+        buffer *grown{ m_buffers.back().get() };
+        for (::std::int64_t i{ top }; i < bottom; ++i) {
+          grown->put(i, old->get(i));
+        }
+        m_buffer.store(grown, ::std::memory_order_release);
+        return grown;
+      }
+
+      // Top and bottom sit on separate cache lines, as thieves hammer one and the owner the other.
+      ::std::atomic<::std::int64_t> m_top{ 0 };
+      char m_padding[64 - sizeof(::std::atomic<::std::int64_t>)];
+      ::std::atomic<::std::int64_t> m_bottom{ 0 };
+      ::std::atomic<buffer*> m_buffer{ nullptr };
+      vector<::std::unique_ptr<buffer>> m_buffers;
+    };
+
+    // Which pool, if any, the calling thread works for.
+    struct worker_context {
+      thread_pool *pool{ nullptr };
+      ::std::size_t index{ 0 };
+    };
+    inline worker_context& current_worker() noexcept {
+      static thread_local worker_context context;
+      return context;
+    }
+  } // namespace detail
+
+  // A fork-join thread pool with work stealing.
+  // Work is expressed with fork_join, which runs two callables, possibly in parallel, and returns once both are done.
+  // Each worker keeps its forks in its own Chase-Lev deque and runs them newest first; idle workers steal the oldest
+  // fork of a random victim. A worker which has to wait for a stolen fork runs other forks meanwhile,
+  // so nested parallelism never blocks a thread.
+  // Threads outside the pool enter it through run (fork_join does so implicitly), which blocks until the work is done.
+  // Exceptions thrown by the work are rethrown to the caller of fork_join or run.
+  class thread_pool {
+  public:
+    // Starts `threads` workers, or one per hardware thread if 0.
+    explicit thread_pool(::std::size_t threads = 0);
+    ~thread_pool();
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ::std::size_t size() const noexcept { return m_workers.size(); }
+
+    // Runs function on one of the workers and waits for it. Called from a worker of this pool, it just calls function.
+    template<typename Function>
+    void run(Function &&function);
+    // Runs left and right, potentially in parallel, and returns when both have finished.
+    template<typename Left, typename Right>
+    void fork_join(Left &&left, Right &&right);
+
+    // A process wide pool with one worker per hardware thread, started on first use.
+    static thread_pool& default_pool() {
+      static thread_pool pool;
+      return pool;
+    }
+
+  private:
+    struct worker {
+      detail::work_stealing_deque<detail::pool_task*> tasks;
+      ::std::thread thread;
+    };
+
+    void work(::std::size_t index);
+    void execute(detail::pool_task &task) noexcept;
+    // Finds a task for worker `index`: its own newest first, then the injected ones, then another worker's oldest.
+    detail::pool_task* find_task(::std::size_t index) noexcept;
+    detail::pool_task* take_injected() noexcept;
+    bool has_work() const noexcept;
+    void wake_one();
+    // Keeps worker `index` busy with other tasks until task is done.
+    void help_until_done(::std::size_t index, const detail::pool_task &task) noexcept;
+
+    vector<::std::unique_ptr<worker>> m_workers;
+    // Tasks submitted by threads outside the pool.
+    ::std::mutex m_injected_mutex;
+    vector<detail::pool_task*> m_injected;
+    ::std::atomic<::std::size_t> m_injected_count{ 0 };
+    // Idle workers sleep on m_wake. Submitters only take the mutex when someone is asleep.
+    ::std::mutex m_sleep_mutex;
+    ::std::condition_variable m_wake;
+    ::std::atomic<::std::size_t> m_sleepers{ 0 };
+    ::std::uint64_t m_wake_epoch{ 0 };
+    bool m_stopping{ false };
+    // Wakes threads outside the pool waiting in run.
+    ::std::mutex m_done_mutex;
+    ::std::condition_variable m_done;
+  };
+
+  inline thread_pool::thread_pool(::std::size_t threads) {
+    if (threads == 0) {
+      threads = ::std::thread::hardware_concurrency();
+      if (threads == 0) threads = 1;
+    }
+    m_workers.reserve(threads);
+    for (::std::size_t i{ 0 }; i < threads; ++i) {
+      m_workers.emplace_back(new worker{});
+    }
+    // Every deque exists before any worker starts stealing.
+    for (::std::size_t i{ 0 }; i < threads; ++i) {
+      m_workers[i]->thread = ::std::thread{ [this, i] { work(i); } };
+    }
+  }
+
+  inline thread_pool::~thread_pool() {
+    {
+      ::std::lock_guard<::std::mutex> lock{ m_sleep_mutex };
+      m_stopping = true;
+      ++m_wake_epoch;
+    }
+    m_wake.notify_all();
+    for (auto &w : m_workers) {
+      w->thread.join();
+    }
+  }
+
+  template<typename Function>
+  void thread_pool::run(Function &&function) {
+    detail::worker_context &context = detail::current_worker();
+    if (context.pool == this) {
+      function();
+      return;
+    }
+    detail::closure_task<Function> task{ function };
+    task.injected = true;
+    {
+      ::std::lock_guard<::std::mutex> lock{ m_injected_mutex };
+      m_injected.push_back(&task);
+      m_injected_count.fetch_add(1, ::std::memory_order_seq_cst);
+    }
+    wake_one();
+    // The worker finishing the task notifies under m_done_mutex, so checking done under it cannot miss the wakeup.
+    {
+      ::std::unique_lock<::std::mutex> lock{ m_done_mutex };
+      m_done.wait(lock, [&task] { return task.done.load(::std::memory_order_acquire); });
+    }
+    if (task.error) ::std::rethrow_exception(task.error);
+  }
+
+  template<typename Left, typename Right>
+  void thread_pool::fork_join(Left &&left, Right &&right) {
+    detail::worker_context &context = detail::current_worker();
+    if (context.pool != this) {
+      run([&] { fork_join(left, right); });
+      return;
+    }
+    const ::std::size_t index{ context.index };
+    detail::closure_task<Right> forked{ right };
+    m_workers[index]->tasks.push(&forked);
+    wake_one();
+    ::std::exception_ptr error;
+    try {
+      left();
+    }
+    catch (...) {
+      error = ::std::current_exception();
+    }
+    // Unless a thief took it, the fork is still the newest task in this worker's deque.
+    detail::pool_task *task{ m_workers[index]->tasks.pop() };
+    if (task) {
+      execute(*task);
+    }
+    if (task != &forked) {
+      help_until_done(index, forked);
+    }
+    if (error) ::std::rethrow_exception(error);
+    if (forked.error) ::std::rethrow_exception(forked.error);
+  }
+
+  inline void thread_pool::work(::std::size_t index) {
+    detail::worker_context &context = detail::current_worker();
+    context.pool = this;
+    context.index = index;
+    for (;;) {
+      detail::pool_task *task{ find_task(index) };
+      if (task) {
+        execute(*task);
+        continue;
+      }
+      ::std::unique_lock<::std::mutex> lock{ m_sleep_mutex };
+      if (m_stopping) return;
+      const ::std::uint64_t epoch{ m_wake_epoch };
+      m_sleepers.fetch_add(1, ::std::memory_order_seq_cst);
+      ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+      // Work submitted before the submitter could see this worker asleep must not be slept through.
+      if (!has_work()) {
+        m_wake.wait(lock, [&] { return m_wake_epoch != epoch; });
+      }
+      m_sleepers.fetch_sub(1, ::std::memory_order_relaxed);
+      if (m_stopping) return;
+    }
+  }
+
+  inline void thread_pool::execute(detail::pool_task &task) noexcept {
+    // The task may be gone as soon as it is done, so read the flag first.
+    const bool injected{ task.injected };
+    task.execute(task);
+    if (injected) {
+      // Taking the mutex orders the wakeup after the submitter's last check of done.
+      { ::std::lock_guard<::std::mutex> lock{ m_done_mutex }; }
+      m_done.notify_all();
+    }
+  }
+
+  inline detail::pool_task* thread_pool::find_task(::std::size_t index) noexcept {
+    detail::pool_task *task{ m_workers[index]->tasks.pop() };
+    if (task) return task;
+    task = take_injected();
+    if (task) return task;
+    // Start from a different victim each time, so thieves spread out.
+    thread_local ::std::uint32_t seed{ static_cast<::std::uint32_t>(index * 2654435761u + 1) };
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    const ::std::size_t count{ m_workers.size() };
+    for (::std::size_t i{ 0 }; i < count; ++i) {
+      const ::std::size_t victim{ (seed + i) % count };
+      if (victim == index) continue;
+      task = m_workers[victim]->tasks.steal();
+      if (task) return task;
+    }
+    return nullptr;
+  }
+
+  inline detail::pool_task* thread_pool::take_injected() noexcept {
+    if (m_injected_count.load(::std::memory_order_acquire) == 0) return nullptr;
+    ::std::lock_guard<::std::mutex> lock{ m_injected_mutex };
+    if (m_injected.empty()) return nullptr;
+    detail::pool_task *task{ m_injected.back() };
+    m_injected.pop_back();
+    m_injected_count.fetch_sub(1, ::std::memory_order_relaxed);
+    return task;
+  }
+
+  inline bool thread_pool::has_work() const noexcept {
+    if (m_injected_count.load(::std::memory_order_seq_cst)) return true;
+    for (const auto &w : m_workers) {
+      if (!w->tasks.empty()) return true;
+    }
+    return false;
+  }
+
+  inline void thread_pool::wake_one() {
+    ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+    if (m_sleepers.load(::std::memory_order_relaxed) == 0) return;
+    {
+      ::std::lock_guard<::std::mutex> lock{ m_sleep_mutex };
+      ++m_wake_epoch;
+    }
+    m_wake.notify_one();
+  }
+
+  inline void thread_pool::help_until_done(::std::size_t index, const detail::pool_task &task) noexcept {
+    unsigned idle{ 0 };
+    while (!task.done.load(::std::memory_order_acquire)) {
+      detail::pool_task *other{ find_task(index) };
+      if (other) {
+        execute(*other);
+        idle = 0;
+      }
+      else if (++idle > 64) {
+        ::std::this_thread::yield();
+      }
+    }
+  }
+
+} // namespace ftl
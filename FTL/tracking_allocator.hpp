@@ -0,0 +1,327 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "allocator.hpp" // allocate_at_least, reallocate, allocators_equal
+#include "report.hpp" // report_format
+
+#include <algorithm> // find
+#include <atomic> // atomic
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <iomanip> // setw
+#include <mutex> // mutex, lock_guard
+#include <ostream> // ostream
+#include <type_traits> // enable_if, integral_constant
+#include <vector> // the tag registry
+
+// Allocation tracking is on unless the build defines FTL_TRACK_ALLOCATIONS to 0. Compiled out, a
+// tracking_allocator is its inner allocator under another name: it stores no tag and counts nothing, and the tags
+// and reports still compile but stay empty.
+#ifndef FTL_TRACK_ALLOCATIONS
+#define FTL_TRACK_ALLOCATIONS 1
+#endif
+
+namespace ftl {
+
+  // A snapshot of the allocations made under one tag.
+  struct allocation_stats {
+    // Allocations of size in [2^i, 2^(i+1)) bytes land in bucket i; 0 and 1 byte ones in bucket 0, and anything
+    // larger than the last bucket in it.
+    static constexpr ::std::size_t histogram_buckets{ 32 };
+
+    const char *tag;
+    ::std::uint64_t allocations;
+    ::std::uint64_t deallocations;
+    ::std::uint64_t allocated_bytes;
+    ::std::uint64_t live_bytes;
+    ::std::uint64_t peak_bytes;
+    ::std::uint64_t histogram[histogram_buckets];
+  };
+
+  // allocation_tag is a named set of counters which tracking_allocators attribute their allocations to, such as
+  // one per subsystem or per kind of container. Counting is lock-free: relaxed atomic adds, plus a compare and
+  // swap loop while the peak rises. Tags register themselves for reporting when created, and must outlive the
+  // allocators using them, so they are usually statics:
+  //   static ftl::allocation_tag mesh_tag{ "mesh vertices" };
+  //   ftl::vector<vertex, ftl::tracking_allocator<ftl::default_allocator<vertex>>> vertices{ mesh_tag };
+  class allocation_tag {
+  public:
+    explicit allocation_tag(const char *name);
+    allocation_tag(const allocation_tag &) = delete;
+    allocation_tag& operator=(const allocation_tag &) = delete;
+    ~allocation_tag();
+
+    const char* name() const noexcept { return m_name; }
+    allocation_stats stats() const noexcept;
+    // Zeroes the counters, for measuring a phase of the program. Blocks still live stay counted as live, and the
+    // peak restarts from them.
+    void reset() noexcept;
+
+    void record_allocation(::std::size_t bytes) noexcept;
+    void record_deallocation(::std::size_t bytes) noexcept;
+
+    // The tag of tracking_allocators which weren't given one.
+    static allocation_tag& untagged();
+    // Calls f(const allocation_tag&) for every live tag, in the order they were created.
+    template<typename F>
+    static void for_each(F &&f);
+
+  private:
+    struct registry {
+      ::std::mutex mutex;
+      ::std::vector<const allocation_tag*> tags;
+    };
+    static registry& tags();
+    static ::std::size_t bucket(::std::size_t bytes) noexcept;
+
+    const char *m_name;
+#if FTL_TRACK_ALLOCATIONS
+    ::std::atomic<::std::uint64_t> m_allocations{ 0 };
+    ::std::atomic<::std::uint64_t> m_deallocations{ 0 };
+    ::std::atomic<::std::uint64_t> m_allocated_bytes{ 0 };
+    ::std::atomic<::std::uint64_t> m_live_bytes{ 0 };
+    ::std::atomic<::std::uint64_t> m_peak_bytes{ 0 };
+    ::std::atomic<::std::uint64_t> m_histogram[allocation_stats::histogram_buckets];
+#endif
+  };
+
+  inline allocation_tag::allocation_tag(const char *name) : m_name{ name } {
+#if FTL_TRACK_ALLOCATIONS
+    for (auto &count : m_histogram) count.store(0, ::std::memory_order_relaxed);
+#endif
+    registry &r = tags();
+    ::std::lock_guard<::std::mutex> lock{ r.mutex };
+    r.tags.push_back(this);
+  }
+
+  inline allocation_tag::~allocation_tag() {
+    registry &r = tags();
+    ::std::lock_guard<::std::mutex> lock{ r.mutex };
+    r.tags.erase(::std::find(r.tags.begin(), r.tags.end(), this));
+  }
+
+  inline allocation_tag::registry& allocation_tag::tags() {
+    // Created before the first tag, so it is destroyed after the last static one.
+    static registry instance;
+    return instance;
+  }
+
+  inline allocation_tag& allocation_tag::untagged() {
+    static allocation_tag instance{ "untagged" };
+    return instance;
+  }
+
+  template<typename F>
+  void allocation_tag::for_each(F &&f) {
+    registry &r = tags();
+    ::std::lock_guard<::std::mutex> lock{ r.mutex };
+    for (const allocation_tag *tag : r.tags) f(*tag);
+  }
+
+  inline ::std::size_t allocation_tag::bucket(::std::size_t bytes) noexcept {
+    ::std::size_t result{ 0 };
+    while (bytes > 1 && result + 1 < allocation_stats::histogram_buckets) {
+      bytes >>= 1;
+      ++result;
+    }
+    return result;
+  }
+
+#if FTL_TRACK_ALLOCATIONS
+  inline void allocation_tag::record_allocation(::std::size_t bytes) noexcept {
+    m_allocations.fetch_add(1, ::std::memory_order_relaxed);
+    m_allocated_bytes.fetch_add(bytes, ::std::memory_order_relaxed);
+    m_histogram[bucket(bytes)].fetch_add(1, ::std::memory_order_relaxed);
+    const ::std::uint64_t live{ m_live_bytes.fetch_add(bytes, ::std::memory_order_relaxed) + bytes };
+    ::std::uint64_t peak{ m_peak_bytes.load(::std::memory_order_relaxed) };
+    while (live > peak && !m_peak_bytes.compare_exchange_weak(peak, live, ::std::memory_order_relaxed)) {}
+  }
+
+  inline void allocation_tag::record_deallocation(::std::size_t bytes) noexcept {
+    m_deallocations.fetch_add(1, ::std::memory_order_relaxed);
+    m_live_bytes.fetch_sub(bytes, ::std::memory_order_relaxed);
+  }
+
+  inline allocation_stats allocation_tag::stats() const noexcept {
+    allocation_stats result{ m_name, m_allocations.load(::std::memory_order_relaxed), m_deallocations.load(::std::memory_order_relaxed),
+      m_allocated_bytes.load(::std::memory_order_relaxed), m_live_bytes.load(::std::memory_order_relaxed),
+      m_peak_bytes.load(::std::memory_order_relaxed), {} };
+    for (::std::size_t i{ 0 }; i < allocation_stats::histogram_buckets; ++i) {
+      result.histogram[i] = m_histogram[i].load(::std::memory_order_relaxed);
+    }
+    return result;
+  }
+
+  inline void allocation_tag::reset() noexcept {
+    m_allocations.store(0, ::std::memory_order_relaxed);
+    m_deallocations.store(0, ::std::memory_order_relaxed);
+    m_allocated_bytes.store(0, ::std::memory_order_relaxed);
+    m_peak_bytes.store(m_live_bytes.load(::std::memory_order_relaxed), ::std::memory_order_relaxed);
+    for (auto &count : m_histogram) count.store(0, ::std::memory_order_relaxed);
+  }
+#else
+  inline void allocation_tag::record_allocation(::std::size_t) noexcept {}
+  inline void allocation_tag::record_deallocation(::std::size_t) noexcept {}
+  inline allocation_stats allocation_tag::stats() const noexcept { return { m_name, 0, 0, 0, 0, 0, {} }; }
+  inline void allocation_tag::reset() noexcept {}
+#endif
+
+  // Writes the statistics of every tag: a table with the histogram's non-empty buckets as text, or an array of
+  // objects, one per tag, as JSON.
+  void write_allocation_report(::std::ostream &out, report_format format = report_format::text);
+
+  namespace detail {
+    inline void write_text_stats(::std::ostream &out, const allocation_stats &s) {
+      out << ::std::left << ::std::setw(24) << s.tag << ::std::right
+        << ::std::setw(12) << s.allocations << ::std::setw(12) << s.deallocations << ::std::setw(16) << s.allocated_bytes
+        << ::std::setw(16) << s.live_bytes << ::std::setw(16) << s.peak_bytes << '\n';
+      for (::std::size_t i{ 0 }; i < allocation_stats::histogram_buckets; ++i) {
+        if (s.histogram[i]) out << "  " << (::std::uint64_t{ 1 } << i) << "+ bytes: " << s.histogram[i] << '\n';
+      }
+    }
+
+    inline void write_json_stats(::std::ostream &out, const allocation_stats &s) {
+      out << "{\"tag\":";
+      write_json_string(out, s.tag);
+      out << ",\"allocations\":" << s.allocations << ",\"deallocations\":" << s.deallocations
+        << ",\"allocated_bytes\":" << s.allocated_bytes << ",\"live_bytes\":" << s.live_bytes
+        << ",\"peak_bytes\":" << s.peak_bytes << ",\"histogram\":[";
+      for (::std::size_t i{ 0 }; i < allocation_stats::histogram_buckets; ++i) {
+        out << (i ? "," : "") << s.histogram[i];
+      }
+      out << "]}";
+    }
+  } // namespace detail
+
+  inline void write_allocation_report(::std::ostream &out, report_format format) {
+    if (format == report_format::json) {
+      bool first{ true };
+      out << '[';
+      allocation_tag::for_each([&](const allocation_tag &tag) {
+        out << (first ? "" : ",");
+        detail::write_json_stats(out, tag.stats());
+        first = false;
+      });
+      out << "]\n";
+      return;
+    }
+    out << ::std::left << ::std::setw(24) << "tag" << ::std::right << ::std::setw(12) << "allocs" << ::std::setw(12) << "deallocs"
+      << ::std::setw(16) << "allocated" << ::std::setw(16) << "live" << ::std::setw(16) << "peak" << '\n';
+    allocation_tag::for_each([&](const allocation_tag &tag) { detail::write_text_stats(out, tag.stats()); });
+  }
+
+  // tracking_allocator wraps another allocator, Inner, and counts its allocations under an allocation_tag. The
+  // optional extensions of Inner, allocate_at_least and reallocate, are passed through, as are its propagation
+  // traits. Blocks are counted under the tag of the allocator which made them, so allocators only compare equal
+  // when their tags match as well as their inner allocators; moving a vector to another tag relocates it.
+  template<typename Inner>
+  class tracking_allocator;
+
+#if FTL_TRACK_ALLOCATIONS
+  template<typename Inner>
+  class tracking_allocator {
+  public:
+    using value_type = typename Inner::value_type;
+    using pointer = typename Inner::pointer;
+    using reference = value_type&;
+    using const_pointer = const value_type *;
+    using const_reference = const value_type&;
+    using size_type = typename Inner::size_type;
+    using difference_type = ::std::ptrdiff_t;
+    template<typename Type>
+    using rebind = tracking_allocator<typename Inner::template rebind<Type>>;
+    using propagate_on_container_copy_assignment = ::std::integral_constant<bool, detail::propagate_on_copy_assignment<Inner>::value>;
+    using propagate_on_container_move_assignment = ::std::integral_constant<bool, detail::propagate_on_move_assignment<Inner>::value>;
+    using propagate_on_container_swap = ::std::integral_constant<bool, detail::propagate_on_swap<Inner>::value>;
+    using is_always_equal = ::std::false_type;
+    static constexpr ::std::size_t alignment{ detail::allocation_alignment<Inner>::value };
+
+    tracking_allocator() : m_inner{}, m_tag{ &allocation_tag::untagged() } {}
+    tracking_allocator(allocation_tag &tag, const Inner &inner = Inner{}) : m_inner{ inner }, m_tag{ &tag } {}
+    explicit tracking_allocator(const Inner &inner) : m_inner{ inner }, m_tag{ &allocation_tag::untagged() } {}
+    template<typename U>
+    tracking_allocator(const tracking_allocator<U> &other) : m_inner{ other.inner() }, m_tag{ &other.tag() } {}
+
+    const Inner& inner() const noexcept { return m_inner; }
+    allocation_tag& tag() const noexcept { return *m_tag; }
+
+    pointer allocate(size_type n) {
+      pointer result{ m_inner.allocate(n) };
+      m_tag->record_allocation(n * sizeof(value_type));
+      return result;
+    }
+    allocation_result<pointer, size_type> allocate_at_least(size_type n) {
+      auto result = ftl::allocate_at_least(m_inner, n);
+      m_tag->record_allocation(result.count * sizeof(value_type));
+      return result;
+    }
+    void deallocate(pointer p, size_type n) {
+      m_tag->record_deallocation(n * sizeof(value_type));
+      m_inner.deallocate(p, n);
+    }
+    // Only there when Inner has it, since containers look for it.
+    template<typename I = Inner, typename = typename ::std::enable_if<detail::has_reallocate<I>::value>::type>
+    allocation_result<pointer, size_type> reallocate(pointer p, size_type old_count, size_type n) {
+      auto result = ftl::reallocate(m_inner, p, old_count, n);
+      m_tag->record_deallocation(old_count * sizeof(value_type));
+      m_tag->record_allocation(result.count * sizeof(value_type));
+      return result;
+    }
+    size_type max_size() const noexcept { return m_inner.max_size(); }
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+      m_inner.construct(p, ::std::forward<Args>(args)...);
+    }
+    template<class U>
+    void destroy(U* p) {
+      m_inner.destroy(p);
+    }
+
+    tracking_allocator select_on_container_copy_construction() const {
+      return tracking_allocator{ *m_tag, ftl::select_on_container_copy_construction(m_inner) };
+    }
+
+  private:
+    Inner m_inner;
+    allocation_tag *m_tag;
+  };
+
+  template<typename Inner>
+  constexpr ::std::size_t tracking_allocator<Inner>::alignment;
+
+  template<typename T, typename U>
+  bool operator==(const tracking_allocator<T> &lhs, const tracking_allocator<U> &rhs) noexcept {
+    return &lhs.tag() == &rhs.tag() && lhs.inner() == rhs.inner();
+  }
+#else
+  template<typename Inner>
+  class tracking_allocator : public Inner {
+  public:
+    template<typename Type>
+    using rebind = tracking_allocator<typename Inner::template rebind<Type>>;
+
+    tracking_allocator() = default;
+    tracking_allocator(allocation_tag &, const Inner &inner = Inner{}) : Inner(inner) {}
+    explicit tracking_allocator(const Inner &inner) : Inner(inner) {}
+    template<typename U>
+    tracking_allocator(const tracking_allocator<U> &other) : Inner(other.inner()) {}
+
+    const Inner& inner() const noexcept { return *this; }
+    allocation_tag& tag() const noexcept { return allocation_tag::untagged(); }
+
+    tracking_allocator select_on_container_copy_construction() const {
+      return tracking_allocator{ ftl::select_on_container_copy_construction(inner()) };
+    }
+  };
+
+  template<typename T, typename U>
+  bool operator==(const tracking_allocator<T> &lhs, const tracking_allocator<U> &rhs) noexcept {
+    return lhs.inner() == rhs.inner();
+  }
+#endif
+
+  template<typename T, typename U>
+  bool operator!=(const tracking_allocator<T> &lhs, const tracking_allocator<U> &rhs) noexcept { return !(lhs == rhs); }
+
+} // namespace ftl
@@ -3,21 +3,273 @@
 #pragma once
 
 #include "allocator.hpp" // ftl::default_allocator
+#include "relocate.hpp" // ftl::relocate
+#include "growth_policy.hpp" // ftl::default_growth
+#include "vector_instrumentation.hpp" // detail::record_vector_event
 
 #include <limits> // needed for allocator::max_size
 #include <iterator> // ::std::reverse_iterator<>
 #include <utility> // ::std::distance
 #include <memory>
 #include <cassert>
-#include <algorithm> // rotate
+#include <algorithm> // rotate, fill_n, copy, move
+#include <type_traits> // is_trivially_destructible, is_trivially_copyable
+#include <cstring> // memcpy
 namespace ftl {
-  // vector implementation with ::std::vector parity
-  template<typename T, typename Alloc = default_allocator<T>>
-  class vector {
+  // Tag requesting default initialization rather than value initialization of new elements,
+  // e.g. vec.resize(n, ftl::default_init) leaves new ints indeterminate instead of zeroing them.
+  struct default_init_t {
+    explicit default_init_t() = default;
+  };
+  constexpr default_init_t default_init{};
+
+  namespace detail {
+    // Bulk kernels shared by the vector family.
+    // Each one dispatches on the element type so trivial types compile down to memset/memcpy or nothing at all.
+
+    // Destroys [first, last). Trivially destructible types have nothing to do.
+    template<typename Alloc, typename T>
+    void destroy_range(Alloc &, T *, T *, ::std::true_type) noexcept {}
+    template<typename Alloc, typename T>
+    void destroy_range(Alloc &alloc, T *first, T *last, ::std::false_type) noexcept {
+      for (; first != last; ++first) {
+        alloc.destroy(first);
+      }
+    }
+    template<typename Alloc, typename T>
+    void destroy_range(Alloc &alloc, T *first, T *last) noexcept {
+      destroy_range(alloc, first, last, ::std::is_trivially_destructible<T>{});
+    }
+
+    // Constructs n copies of val in the uninitialized storage at dest and returns the end of the new range.
+    template<typename Alloc, typename T>
+    T* uninitialized_fill(Alloc &, T *dest, ::std::size_t n, const T &val, ::std::true_type) noexcept {
+      return ::std::fill_n(dest, n, val);
+    }
+    template<typename Alloc, typename T>
+    T* uninitialized_fill(Alloc &alloc, T *dest, ::std::size_t n, const T &val, ::std::false_type) {
+      T *out{ dest };
+      try {
+        for (; n; --n, ++out) {
+          alloc.construct(out, val);
+        }
+      }
+      catch (...) {
+        destroy_range(alloc, dest, out);
+        throw;
+      }
+      return out;
+    }
+    template<typename Alloc, typename T>
+    T* uninitialized_fill(Alloc &alloc, T *dest, ::std::size_t n, const T &val) {
+      return uninitialized_fill(alloc, dest, n, val, ::std::is_trivially_copyable<T>{});
+    }
+
+    // Value initializes n elements in the uninitialized storage at dest and returns the end of the new range.
+    template<typename Alloc, typename T>
+    T* uninitialized_value_construct(Alloc &, T *dest, ::std::size_t n, ::std::true_type) noexcept {
+      return ::std::fill_n(dest, n, T());
+    }
+    template<typename Alloc, typename T>
+    T* uninitialized_value_construct(Alloc &alloc, T *dest, ::std::size_t n, ::std::false_type) {
+      T *out{ dest };
+      try {
+        for (; n; --n, ++out) {
+          alloc.construct(out);
+        }
+      }
+      catch (...) {
+        destroy_range(alloc, dest, out);
+        throw;
+      }
+      return out;
+    }
+    template<typename Alloc, typename T>
+    T* uninitialized_value_construct(Alloc &alloc, T *dest, ::std::size_t n) {
+      return uninitialized_value_construct(alloc, dest, n, ::std::integral_constant<bool,
+        ::std::is_trivially_default_constructible<T>::value && ::std::is_trivially_copyable<T>::value>{});
+    }
+
+    // Default initializes n elements at dest: trivially constructible types are left untouched.
+    template<typename Alloc, typename T>
+    T* uninitialized_default_construct(Alloc &, T *dest, ::std::size_t n, ::std::true_type) noexcept {
+      return dest + n;
+    }
+    template<typename Alloc, typename T>
+    T* uninitialized_default_construct(Alloc &alloc, T *dest, ::std::size_t n, ::std::false_type) {
+      return uninitialized_value_construct(alloc, dest, n, ::std::false_type{});
+    }
+    template<typename Alloc, typename T>
+    T* uninitialized_default_construct(Alloc &alloc, T *dest, ::std::size_t n) {
+      return uninitialized_default_construct(alloc, dest, n, ::std::is_trivially_default_constructible<T>{});
+    }
+
+    // True when [first, last) can be copied into T storage with memcpy.
+    template<typename Iterator, typename T>
+    struct is_memcpy_copyable : ::std::integral_constant<bool,
+      ::std::is_pointer<Iterator>::value
+      && ::std::is_same<typename ::std::remove_cv<typename ::std::remove_pointer<Iterator>::type>::type, T>::value
+      && ::std::is_trivially_copyable<T>::value> {};
+
+    // Copy constructs [first, last) into the uninitialized storage at dest and returns the end of the new range.
+    template<typename Alloc, typename Iterator, typename T>
+    T* uninitialized_copy(Alloc &, Iterator first, Iterator last, T *dest, ::std::true_type) noexcept {
+      const auto count{ static_cast<::std::size_t>(last - first) };
+      if (count) {
+        ::std::memcpy(static_cast<void*>(dest), static_cast<const void*>(first), count * sizeof(T));
+      }
+      return dest + count;
+    }
+    template<typename Alloc, typename Iterator, typename T>
+    T* uninitialized_copy(Alloc &alloc, Iterator first, Iterator last, T *dest, ::std::false_type) {
+      T *out{ dest };
+      try {
+        for (; first != last; ++first, ++out) {
+          alloc.construct(out, *first);
+        }
+      }
+      catch (...) {
+        destroy_range(alloc, dest, out);
+        throw;
+      }
+      return out;
+    }
+    template<typename Alloc, typename Iterator, typename T>
+    T* uninitialized_copy(Alloc &alloc, Iterator first, Iterator last, T *dest) {
+      return uninitialized_copy(alloc, first, last, dest, is_memcpy_copyable<Iterator, T>{});
+    }
+
+    // Copy assigns [first, first + n) over the live elements at dest. std::copy already lowers to memmove for trivial types.
+    template<typename Iterator, typename T>
+    Iterator copy_assign(Iterator first, ::std::size_t n, T *dest) {
+      for (; n; --n, ++first, ++dest) {
+        *dest = *first;
+      }
+      return first;
+    }
+    template<typename T>
+    const T* copy_assign(const T *first, ::std::size_t n, T *dest) {
+      ::std::copy(first, first + n, dest);
+      return first + n;
+    }
+    template<typename T>
+    T* copy_assign(T *first, ::std::size_t n, T *dest) {
+      ::std::copy(first, first + n, dest);
+      return first + n;
+    }
+
+    // Move assigns [first, last) over the live elements starting at dest, which may overlap the source from the left.
+    // Returns the end of the assigned range.
+    template<typename T>
+    T* move_assign(T *first, T *last, T *dest) {
+      return ::std::move(first, last, dest);
+    }
+
+    // Move constructs [first, last) into the uninitialized storage at dest and returns the end of the new range.
+    template<typename Alloc, typename T>
+    T* uninitialized_move(Alloc &alloc, T *first, T *last, T *dest) {
+      return uninitialized_copy(alloc, ::std::make_move_iterator(first), ::std::make_move_iterator(last), dest);
+    }
+
+    // Moves [first, last) into the uninitialized storage at dest if that can't throw, and copies it otherwise,
+    // so the source is still intact if this throws. Returns the end of the new range.
+    template<typename Alloc, typename T>
+    T* uninitialized_move_if_noexcept(Alloc &alloc, T *first, T *last, T *dest, ::std::true_type) {
+      return uninitialized_move(alloc, first, last, dest);
+    }
+    template<typename Alloc, typename T>
+    T* uninitialized_move_if_noexcept(Alloc &alloc, T *first, T *last, T *dest, ::std::false_type) {
+      return uninitialized_copy(alloc, static_cast<const T*>(first), static_cast<const T*>(last), dest);
+    }
+    template<typename Alloc, typename T>
+    T* uninitialized_move_if_noexcept(Alloc &alloc, T *first, T *last, T *dest) {
+      return uninitialized_move_if_noexcept(alloc, first, last, dest, ::std::integral_constant<bool,
+        ::std::is_nothrow_move_constructible<T>::value || !::std::is_copy_constructible<T>::value>{});
+    }
+
+    // Sources of the elements an insertion adds. Each one can construct or assign any run of its elements,
+    // identified by the offset of the first one, so the insertion can split them between raw and live storage.
+    template<typename T>
+    struct fill_source {
+      const T &value;
+      template<typename Alloc>
+      T* construct(Alloc &alloc, T *dest, ::std::size_t, ::std::size_t count) const {
+        return uninitialized_fill(alloc, dest, count, value);
+      }
+      void assign(T *dest, ::std::size_t, ::std::size_t count) const {
+        ::std::fill_n(dest, count, value);
+      }
+    };
+
+    template<typename ForwardIterator>
+    struct range_source {
+      ForwardIterator first;
+      template<typename Alloc, typename T>
+      T* construct(Alloc &alloc, T *dest, ::std::size_t offset, ::std::size_t count) const {
+        const ForwardIterator begin{ ::std::next(first, offset) };
+        return uninitialized_copy(alloc, begin, ::std::next(begin, count), dest);
+      }
+      template<typename T>
+      void assign(T *dest, ::std::size_t offset, ::std::size_t count) const {
+        copy_assign(::std::next(first, offset), count, dest);
+      }
+    };
+
+    // A single element which is moved into place.
+    template<typename T>
+    struct move_source {
+      T &value;
+      template<typename Alloc>
+      T* construct(Alloc &alloc, T *dest, ::std::size_t, ::std::size_t count) const {
+        if (count) alloc.construct(dest++, ::std::move(value));
+        return dest;
+      }
+      void assign(T *dest, ::std::size_t, ::std::size_t count) const {
+        if (count) *dest = ::std::move(value);
+      }
+    };
+
+    // The counter the elements a source adds go to when vectors are instrumented.
+    template<typename Source>
+    struct source_event : ::std::integral_constant<vector_event, vector_event::insert_copy> {};
+    template<typename T>
+    struct source_event<move_source<T>> : ::std::integral_constant<vector_event, vector_event::insert_move> {};
+    template<typename ForwardIterator>
+    struct source_event<range_source<ForwardIterator>> : ::std::integral_constant<vector_event,
+      ::std::is_rvalue_reference<typename ::std::iterator_traits<ForwardIterator>::reference>::value ? vector_event::insert_move : vector_event::insert_copy> {};
+
+    // Stores the allocator of a container. Stateless allocators are stored as an empty base so they take no space.
+    template<typename Alloc, bool Empty = ::std::is_empty<Alloc>::value>
+    class allocator_holder : private Alloc {
+    public:
+      allocator_holder() = default;
+      explicit allocator_holder(const Alloc &alloc) : Alloc(alloc) {}
+      Alloc& allocator_ref() noexcept { return *this; }
+      const Alloc& allocator_ref() const noexcept { return *this; }
+    };
+    template<typename Alloc>
+    class allocator_holder<Alloc, false> {
+    public:
+      allocator_holder() = default;
+      explicit allocator_holder(const Alloc &alloc) : m_alloc(alloc) {}
+      Alloc& allocator_ref() noexcept { return m_alloc; }
+      const Alloc& allocator_ref() const noexcept { return m_alloc; }
+    private:
+      Alloc m_alloc{};
+    };
+  } // namespace detail
+
+  // vector_base implements the vector family with ::std::vector parity.
+  // Derived is the concrete vector type (CRTP). Operations which a derivative customizes, such as reserve,
+  // are called through it, so the family needs no functions and every call can be inlined.
+  // Growth is the policy deciding how much capacity to request when the vector is full (see growth_policy.hpp).
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  class vector_base : protected detail::allocator_holder<Alloc> {
   public:
     // type aliases
     using size_type = std::size_t;
     using allocator_type = Alloc;
+    using growth_policy = Growth;
     using value_type = T;
     using iterator = T*;
     using const_iterator = const T *;
@@ -30,29 +282,28 @@ namespace ftl {
 
     // constructors
     // default
-    vector();
-    explicit vector(const allocator_type& alloc);
+    vector_base();
+    explicit vector_base(const allocator_type& alloc);
     // fill
-    explicit vector(size_type n, const allocator_type& alloc = allocator_type{});
-    vector(size_type n, const value_type& val, const allocator_type& alloc = allocator_type{});
+    explicit vector_base(size_type n, const allocator_type& alloc = allocator_type{});
+    vector_base(size_type n, const value_type& val, const allocator_type& alloc = allocator_type{});
     // range
     template<typename InputIterator>
-    vector(InputIterator first, InputIterator last, const allocator_type& alloc = allocator_type{});
+    vector_base(InputIterator first, InputIterator last, const allocator_type& alloc = allocator_type{});
     // copy
-    vector(const vector<T, Alloc> &other);
-    vector(const vector<T, Alloc>& other, const allocator_type& alloc);
+    vector_base(const vector_base &other);
+    vector_base(const vector_base& other, const allocator_type& alloc);
     // move
-    vector(vector<T, Alloc> &&other);
-    vector(vector<T, Alloc> &&other, const allocator_type& alloc);
+    vector_base(vector_base &&other);
+    vector_base(vector_base &&other, const allocator_type& alloc);
     // initializer list
-    vector(::std::initializer_list<value_type> il, const allocator_type& alloc = allocator_type{});
+    vector_base(::std::initializer_list<value_type> il, const allocator_type& alloc = allocator_type{});
 
-    virtual ~vector();
 
     // assignment
-    vector<T, Alloc>& operator=(const vector<T, Alloc> &other);
-    vector<T, Alloc>& operator=(vector<T, Alloc> &&other);
-    vector<T, Alloc>& operator=(::std::initializer_list<value_type> il);
+    Derived& operator=(const vector_base &other);
+    Derived& operator=(vector_base &&other);
+    Derived& operator=(::std::initializer_list<value_type> il);
 
     // iterators
     iterator begin() const noexcept;
@@ -83,12 +334,23 @@ namespace ftl {
     iterator insert(const_iterator position, value_type &&val);
     iterator insert(const_iterator position, ::std::initializer_list<value_type> il);
 
-    virtual iterator erase(iterator position);
-    virtual iterator erase(iterator first, iterator last);
+    iterator erase(iterator position);
+    iterator erase(iterator first, iterator last);
+    // Bulk removal in a single pass over the vector, keeping the order of the remaining elements.
+    // Each returns the number of elements removed.
+    template<typename Predicate>
+    size_type erase_if(Predicate pred);
+    // Keeps only the elements for which pred returns true.
+    template<typename Predicate>
+    size_type retain(Predicate pred);
+    // Removes the elements at the given indices, which must be sorted in ascending order without duplicates.
+    template<typename Indices>
+    size_type erase_indices(const Indices &indices);
+    size_type erase_indices(::std::initializer_list<size_type> indices);
 
     template<typename Vector>
     void swap(Vector &other);
-    void swap(vector<T, Alloc> &other);
+    void swap(Derived &other);
 
     void clear() noexcept;
 
@@ -111,104 +373,180 @@ namespace ftl {
     bool empty() const noexcept;
     void resize(size_type elements);
     void resize(size_type elements, const value_type &val);
-    virtual void reserve(size_type elements);
+    void resize(size_type elements, default_init_t);
+    // Sets the size without touching the bytes of new elements, which the caller must write before reading.
+    // Only available for trivially default constructible types, for which this is the same as resize(n, default_init).
+    void resize_uninitialized(size_type elements);
+    // Appends n elements without initializing them and returns a pointer to the first one,
+    // e.g. for reading a message straight into the end of a buffer.
+    pointer append_uninitialized(size_type n);
+    void reserve(size_type elements);
     void shrink_to_fit();
 
     // allocator
     allocator_type get_allocator() const noexcept;
 
   protected:
-    vector(iterator Begin, iterator End, size_type Capacity, const allocator_type &alloc = default_allocator<value_type>{});
+    // Derived vectors are destroyed through their own type, so the base destructor needn't be virtual.
+    ~vector_base();
+
+    Derived& derived() noexcept { return static_cast<Derived&>(*this); }
+    const Derived& derived() const noexcept { return static_cast<const Derived&>(*this); }
+
+    vector_base(iterator Begin, iterator End, size_type Capacity, const allocator_type &alloc = allocator_type{});
 
-    virtual void grow();
+    void grow();
+    // Makes room for at least `required` elements, growing geometrically so repeated calls stay amortized O(1).
+    void grow_to(size_type required);
     bool full() const noexcept;
+    // Destroys the elements from new_end on, which the caller has already moved out of or given up on.
+    void truncate(pointer new_end);
+    template<typename Integral>
+    void assign_dispatch(Integral n, Integral val, ::std::true_type);
+    template<typename InputIterator>
+    void assign_dispatch(InputIterator first, InputIterator last, ::std::false_type);
+    template<typename InputIterator>
+    void assign_range(InputIterator first, InputIterator last, ::std::input_iterator_tag);
+    template<typename ForwardIterator>
+    void assign_range(ForwardIterator first, ForwardIterator last, ::std::forward_iterator_tag);
+    template<typename Integral>
+    iterator insert_dispatch(size_type index, Integral n, Integral val, ::std::true_type);
+    template<typename InputIterator>
+    iterator insert_dispatch(size_type index, InputIterator first, InputIterator last, ::std::false_type);
+    template<typename InputIterator>
+    iterator insert_range(size_type index, InputIterator first, InputIterator last, ::std::input_iterator_tag);
+    template<typename ForwardIterator>
+    iterator insert_range(size_type index, ForwardIterator first, ForwardIterator last, ::std::forward_iterator_tag);
+    // Inserts n elements at index into a new buffer, constructing them with construct(dest) before the old elements
+    // are relocated around them, so the arguments may refer to elements of this vector.
+    template<typename Construct>
+    iterator insert_reallocate(size_type index, size_type n, Construct construct);
+    // Inserts n elements from source at index when they fit in the current capacity, shifting the tail once.
+    // Trivially relocatable tails are shifted with a memmove and the new elements constructed in the hole.
+    template<typename Source>
+    iterator insert_in_place(size_type index, size_type n, const Source &source, ::std::true_type);
+    // Otherwise the tail is moved back by n and the new elements are assigned over the vacated slots,
+    // except for those which land past the old end and are constructed instead.
+    template<typename Source>
+    iterator insert_in_place(size_type index, size_type n, const Source &source, ::std::false_type);
+    using relocation_tag = ::std::integral_constant<bool, is_trivially_relocatable<T>::value>;
+    // The capacity the growth policy asks for to hold `required` elements.
+    size_type grown_capacity(size_type required) const noexcept;
+    // Gives back a buffer the vector no longer uses. Derived vectors which don't own every buffer they use hide this.
+    void release_storage(pointer buffer, size_type capacity) noexcept;
+    // Moves the elements into a new buffer with room for the given number of elements.
+    // The old buffer is returned rather than released, since derived vectors may not own it.
+    pointer relocate_storage(size_type elements);
+    // Whether the current buffer came from the allocator. Derived vectors with a buffer of their own hide this.
+    bool owns_storage() const noexcept { return m_capacity != 0; }
+    // Grows the buffer through the allocator's reallocate, which may avoid copying the elements at all.
+    // Returns false when the allocator can't, or the elements can't be moved as bytes.
+    bool reallocate_storage(size_type elements, ::std::true_type);
+    bool reallocate_storage(size_type, ::std::false_type) noexcept { return false; }
+    using reallocate_tag = ::std::integral_constant<bool, is_trivially_relocatable<T>::value && detail::has_reallocate<Alloc>::value>;
+    // Reallocates to the smaller of the current capacity and max(elements, size()), releasing the old buffer.
+    void shrink_capacity(size_type elements);
+    // Gives memory back once the vector is sparse enough, if the growth policy asks for it.
+    void shrink_if_sparse();
+    void shrink_if_sparse(::std::true_type);
+    void shrink_if_sparse(::std::false_type) noexcept {}
+    // Takes the elements of other, which is left empty. Its buffer is taken over when this vector's allocator can
+    // free it, and otherwise the elements are relocated into a buffer from this vector's allocator.
+    // This vector must be empty and hold no buffer.
+    void take_elements(vector_base &other);
+    // Destroys the elements and gives back the buffer, leaving the vector without one.
+    void release_all() noexcept;
+    // Replaces the allocator with alloc, if the allocator propagates.
+    void propagate_allocator(const Alloc &alloc, ::std::true_type) { allocator_ref() = alloc; }
+    void propagate_allocator(const Alloc &, ::std::false_type) noexcept {}
+    void swap_allocators(vector_base &other, ::std::true_type) {
+      using ::std::swap;
+      swap(allocator_ref(), other.allocator_ref());
+    }
+    void swap_allocators(vector_base &, ::std::false_type) noexcept {}
+    using propagate_copy_tag = ::std::integral_constant<bool, detail::propagate_on_copy_assignment<Alloc>::value>;
+    using propagate_move_tag = ::std::integral_constant<bool, detail::propagate_on_move_assignment<Alloc>::value>;
+    using propagate_swap_tag = ::std::integral_constant<bool, detail::propagate_on_swap<Alloc>::value>;
+
 
+    using detail::allocator_holder<Alloc>::allocator_ref;
 
     pointer m_begin{ nullptr };
     pointer m_end{ nullptr };
     size_type m_capacity{ 0u };
-    allocator_type m_alloc{};
   };
 
   // constructors
   // default
-  template<typename T, typename Alloc>
-  vector<T, Alloc>::vector() { }
-  template<typename T, typename Alloc>
-  vector<T, Alloc>::vector(const allocator_type& alloc)
-    : m_alloc(alloc) {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  vector_base<Derived, T, Alloc, Growth>::vector_base() { }
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  vector_base<Derived, T, Alloc, Growth>::vector_base(const allocator_type& alloc)
+    : detail::allocator_holder<Alloc>(alloc) {
   }
   // fill
-  template<typename T, typename Alloc>
-  vector<T, Alloc>::vector(size_type n, const allocator_type& alloc)
-    : m_alloc(alloc) {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  vector_base<Derived, T, Alloc, Growth>::vector_base(size_type n, const allocator_type& alloc)
+    : detail::allocator_holder<Alloc>(alloc) {
     reserve(n);
+    m_end = detail::uninitialized_value_construct(allocator_ref(), m_begin, n);
   }
-  template<typename T, typename Alloc>
-  vector<T, Alloc>::vector(size_type n, const value_type& val, const allocator_type& alloc)
-    : m_alloc(alloc) {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  vector_base<Derived, T, Alloc, Growth>::vector_base(size_type n, const value_type& val, const allocator_type& alloc)
+    : detail::allocator_holder<Alloc>(alloc) {
     assign(n, val);
   }
   // range
-  template<typename T, typename Alloc>
+  template<typename Derived, typename T, typename Alloc, typename Growth>
   template<typename InputIterator>
-  vector<T, Alloc>::vector(InputIterator first, InputIterator last, const allocator_type& alloc)
-    : m_alloc(alloc) {
+  vector_base<Derived, T, Alloc, Growth>::vector_base(InputIterator first, InputIterator last, const allocator_type& alloc)
+    : detail::allocator_holder<Alloc>(alloc) {
     assign(first, last);
   }
   // copy
-  template<typename T, typename Alloc>
-  vector<T, Alloc>::vector(const vector<T, Alloc> &other)
-    : m_alloc(other.get_allocator()) {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  vector_base<Derived, T, Alloc, Growth>::vector_base(const vector_base &other)
+    : detail::allocator_holder<Alloc>(select_on_container_copy_construction(other.allocator_ref())) {
     assign(other.begin(), other.end());
   }
 
-  template<typename T, typename Alloc>
-  vector<T, Alloc>::vector(const vector<T, Alloc>& other, const allocator_type& alloc)
-    : m_alloc(alloc) {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  vector_base<Derived, T, Alloc, Growth>::vector_base(const vector_base& other, const allocator_type& alloc)
+    : detail::allocator_holder<Alloc>(alloc) {
     assign(other.begin(), other.end());
   }
   // move
-  template<typename T, typename Alloc>
-  vector<T, Alloc>::vector(vector<T, Alloc> &&other)
-    : m_begin(other.m_begin)
-    , m_end(other.m_end)
-    , m_capacity(other.m_capacity) {
-    other.m_begin = nullptr;
-    other.m_end = nullptr;
-    other.m_capacity = 0;
-  }
-  template<typename T, typename Alloc>
-  vector<T, Alloc>::vector(vector<T, Alloc> &&other, const allocator_type& alloc)
-    : m_begin(other.begin())
-    , m_end(other.end())
-    , m_capacity(other.capacity())
-    , m_alloc(alloc) {
-    other.m_begin = other.m_end = nullptr;
-    other.m_capacity = 0u;
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  vector_base<Derived, T, Alloc, Growth>::vector_base(vector_base &&other)
+    : detail::allocator_holder<Alloc>(other.allocator_ref()) {
+    take_elements(other);
+  }
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  vector_base<Derived, T, Alloc, Growth>::vector_base(vector_base &&other, const allocator_type& alloc)
+    : detail::allocator_holder<Alloc>(alloc) {
+    take_elements(other);
   }
   // initializer list
-  template<typename T, typename Alloc>
-  vector<T, Alloc>::vector(::std::initializer_list<value_type> il, const allocator_type& alloc)
-    : m_alloc(alloc) {
-    reserve(il.size());
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  vector_base<Derived, T, Alloc, Growth>::vector_base(::std::initializer_list<value_type> il, const allocator_type& alloc)
+    : detail::allocator_holder<Alloc>(alloc) {
     assign(il);
   }
 
   // protected for inline_vector
-  template<typename T, typename Alloc>
-  vector<T, Alloc>::vector(iterator Begin, iterator End, size_type Capacity, const allocator_type &alloc)
-    : m_begin(Begin)
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  vector_base<Derived, T, Alloc, Growth>::vector_base(iterator Begin, iterator End, size_type Capacity, const allocator_type &alloc)
+    : detail::allocator_holder<Alloc>(alloc)
+    , m_begin(Begin)
     , m_end(End)
-    , m_capacity(Capacity)
-    , m_alloc(alloc) {
+    , m_capacity(Capacity) {
   }
 
-  template<typename T, typename Alloc>
-  vector<T, Alloc>::~vector() {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  vector_base<Derived, T, Alloc, Growth>::~vector_base() {
     if(this->capacity() != 0){ 
-      clear();
-      m_alloc.deallocate(m_begin, m_capacity);
+      detail::destroy_range(allocator_ref(), m_begin, m_end);
+      allocator_ref().deallocate(m_begin, m_capacity);
     }
     m_begin = nullptr;
     m_end = nullptr;
@@ -216,156 +554,278 @@ namespace ftl {
   }
 
   // assignment
-  template<typename T, typename Alloc>
-  vector<T, Alloc>& vector<T, Alloc>::operator=(const vector<T, Alloc> &other) {
-    clear();
-    assign(other.begin(), other.end());
-    return *this;
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  Derived& vector_base<Derived, T, Alloc, Growth>::operator=(const vector_base &other) {
+    if (this != &other) {
+      // The buffer has to go before a propagating allocator which couldn't free it replaces the current one.
+      if (propagate_copy_tag::value && !allocators_equal(allocator_ref(), other.allocator_ref())) {
+        release_all();
+      }
+      propagate_allocator(other.allocator_ref(), propagate_copy_tag{});
+      assign(other.begin(), other.end());
+    }
+    return derived();
+  }
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  Derived& vector_base<Derived, T, Alloc, Growth>::operator=(vector_base &&other) {
+    if (this != &other) {
+      release_all();
+      propagate_allocator(other.allocator_ref(), propagate_move_tag{});
+      take_elements(other);
+    }
+    return derived();
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::take_elements(vector_base &other) {
+    assert(m_begin == nullptr && m_capacity == 0);
+    if (allocators_equal(allocator_ref(), other.allocator_ref())) {
+      m_begin = other.m_begin;
+      m_end = other.m_end;
+      m_capacity = other.m_capacity;
+      other.m_begin = other.m_end = nullptr;
+      other.m_capacity = 0;
+      return;
+    }
+    reserve(other.size());
+    m_end = relocate(allocator_ref(), other.m_begin, other.m_end, m_begin);
+    other.m_end = other.m_begin;
   }
-  template<typename T, typename Alloc>
-  vector<T, Alloc>& vector<T, Alloc>::operator=(vector<T, Alloc> &&other) {
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::release_all() noexcept {
     clear();
-    m_begin = other.m_begin;
-    m_end = other.m_end;
-    m_capacity = other.m_capacity;
-    other.m_begin = nullptr;
-    other.m_end = nullptr;
-    other.m_capacity = 0;
-    return *this;
+    if (m_capacity != 0) {
+      allocator_ref().deallocate(m_begin, m_capacity);
+    }
+    m_begin = m_end = nullptr;
+    m_capacity = 0;
   }
-  template<typename T, typename Alloc>
-  vector<T, Alloc>& vector<T, Alloc>::operator=(::std::initializer_list<T> il) {
-    clear();
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  Derived& vector_base<Derived, T, Alloc, Growth>::operator=(::std::initializer_list<T> il) {
     assign(il);
-    return *this;
+    return derived();
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::size_type vector<T, Alloc>::size() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::size_type vector_base<Derived, T, Alloc, Growth>::size() const noexcept {
     return m_end - m_begin;
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::size_type vector<T, Alloc>::capacity() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::size_type vector_base<Derived, T, Alloc, Growth>::capacity() const noexcept {
     return m_capacity;
   }
 
-  template<typename T, typename Alloc>
-  bool vector<T, Alloc>::full() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  bool vector_base<Derived, T, Alloc, Growth>::full() const noexcept {
     return static_cast<unsigned long long>(::std::distance(m_begin, m_end)) >= m_capacity;
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::size_type vector<T, Alloc>::max_size() const noexcept {
-    return m_alloc.max_size();
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::size_type vector_base<Derived, T, Alloc, Growth>::max_size() const noexcept {
+    return allocator_ref().max_size();
   }
-  template<typename T, typename Alloc>
-  bool vector<T, Alloc>::empty() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  bool vector_base<Derived, T, Alloc, Growth>::empty() const noexcept {
     return m_begin == m_end;
   }
 
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::resize(size_type elements) {
-    resize(elements, value_type{});
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::resize(size_type elements) {
+    if (elements > size()) {
+      derived().reserve(elements);
+      m_end = detail::uninitialized_value_construct(allocator_ref(), m_end, elements - size());
+    }
+    else {
+      detail::destroy_range(allocator_ref(), m_begin + elements, m_end);
+      m_end = m_begin + elements;
+    }
   }
 
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::resize(size_type elements, const value_type &val) {
-    if (capacity < elements) {
-      reserve(elements);
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::resize(size_type elements, default_init_t) {
+    if (elements > size()) {
+      derived().reserve(elements);
+      m_end = detail::uninitialized_default_construct(allocator_ref(), m_end, elements - size());
+    }
+    else {
+      detail::destroy_range(allocator_ref(), m_begin + elements, m_end);
+      m_end = m_begin + elements;
     }
-    if (elements > size) {
-      for (size_type i{ size() }; i < elements; ++i) {
-        push_back(val);
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::resize_uninitialized(size_type elements) {
+    static_assert(::std::is_trivially_default_constructible<value_type>::value, "resize_uninitialized requires a trivially default constructible type.");
+    resize(elements, default_init);
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::pointer vector_base<Derived, T, Alloc, Growth>::append_uninitialized(size_type n) {
+    static_assert(::std::is_trivially_default_constructible<value_type>::value, "append_uninitialized requires a trivially default constructible type.");
+    grow_to(size() + n);
+    pointer tail{ m_end };
+    m_end += n;
+    return tail;
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::resize(size_type elements, const value_type &val) {
+    if (elements > size()) {
+      if (capacity() < elements) {
+        // val may refer to an element of this vector, which reserving would invalidate.
+        const value_type temp{ val };
+        derived().reserve(elements);
+        m_end = detail::uninitialized_fill(allocator_ref(), m_end, elements - size(), temp);
+      }
+      else {
+        m_end = detail::uninitialized_fill(allocator_ref(), m_end, elements - size(), val);
       }
     }
     else {
-      while (size() > elements) {
-        pop_back();
-      }
+      detail::destroy_range(allocator_ref(), m_begin + elements, m_end);
+      m_end = m_begin + elements;
     }
   }
 
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::reserve(size_type elements) {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::reserve(size_type elements) {
     if (capacity() >= elements) return;
+    if (derived().owns_storage() && reallocate_storage(elements, reallocate_tag{})) return;
 
-    pointer new_buffer = m_alloc.allocate(elements);
-    pointer temp_begin = begin(), temp_end = end();
-    m_begin = m_end = new_buffer;
     size_type old_capacity{ capacity() };
-    m_capacity = elements;
-    assign(temp_begin, temp_end);
+    pointer old_buffer{ relocate_storage(elements) };
+    derived().release_storage(old_buffer, old_capacity);
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  bool vector_base<Derived, T, Alloc, Growth>::reallocate_storage(size_type elements, ::std::true_type) {
+    const size_type count{ size() };
+    auto allocation = reallocate(allocator_ref(), m_begin, m_capacity, elements);
+    m_begin = allocation.ptr;
+    m_end = m_begin + count;
+    m_capacity = allocation.count;
+    return true;
+  }
 
-    for (auto it{ temp_begin }; it != temp_end; ++it) {
-      m_alloc.destroy(&*it);
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::release_storage(pointer buffer, size_type capacity) noexcept {
+    if (capacity != 0) {
+      allocator_ref().deallocate(buffer, capacity);
     }
-    m_alloc.deallocate(temp_begin, old_capacity);
   }
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::shrink_to_fit() {
-    // The behavior of this function is implementation defined.
-    // This implementation chooses to avoid reallocating into a smaller space.
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::pointer vector_base<Derived, T, Alloc, Growth>::relocate_storage(size_type elements) {
+    auto allocation = allocate_at_least(allocator_ref(), elements);
+    detail::record_vector_event(detail::vector_event::relocate, size());
+    pointer new_end;
+    try {
+      new_end = relocate(allocator_ref(), m_begin, m_end, allocation.ptr);
+    }
+    catch (...) {
+      allocator_ref().deallocate(allocation.ptr, allocation.count);
+      throw;
+    }
+    pointer old_buffer{ m_begin };
+    m_begin = allocation.ptr;
+    m_end = new_end;
+    m_capacity = allocation.count;
+    return old_buffer;
+  }
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::shrink_to_fit() {
+    derived().shrink_capacity(size());
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::shrink_capacity(size_type elements) {
+    if (elements < size()) elements = size();
+    if (elements >= capacity()) return;
+
+    size_type old_capacity{ capacity() };
+    if (elements == 0) {
+      allocator_ref().deallocate(m_begin, old_capacity);
+      m_begin = m_end = nullptr;
+      m_capacity = 0;
+      return;
+    }
+    pointer old_buffer{ relocate_storage(elements) };
+    allocator_ref().deallocate(old_buffer, old_capacity);
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::shrink_if_sparse() {
+    shrink_if_sparse(detail::is_auto_shrinking<growth_policy>{});
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::iterator vector<T, Alloc>::begin() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::shrink_if_sparse(::std::true_type) {
+    if (growth_policy::should_shrink(size(), capacity())) {
+      derived().shrink_capacity(growth_policy::shrunk_capacity(size(), sizeof(value_type)));
+    }
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::begin() const noexcept {
     return m_begin;
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::iterator vector<T, Alloc>::end() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::end() const noexcept {
     return m_end;
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::const_iterator vector<T, Alloc>::cbegin() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::const_iterator vector_base<Derived, T, Alloc, Growth>::cbegin() const noexcept {
     return m_begin;
   }
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::const_iterator vector<T, Alloc>::cend() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::const_iterator vector_base<Derived, T, Alloc, Growth>::cend() const noexcept {
     return m_end;
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::reverse_iterator vector<T, Alloc>::rbegin() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::reverse_iterator vector_base<Derived, T, Alloc, Growth>::rbegin() const noexcept {
     return reverse_iterator{ m_end - 1 };
   }
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::reverse_iterator vector<T, Alloc>::rend() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::reverse_iterator vector_base<Derived, T, Alloc, Growth>::rend() const noexcept {
     return reverse_iterator{ m_begin - 1 };
   }
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::const_reverse_iterator vector<T, Alloc>::crbegin() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::const_reverse_iterator vector_base<Derived, T, Alloc, Growth>::crbegin() const noexcept {
     return const_reverse_iterator{ m_end - 1 };
   }
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::const_reverse_iterator vector<T, Alloc>::crend() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::const_reverse_iterator vector_base<Derived, T, Alloc, Growth>::crend() const noexcept {
     return const_reverse_iterator{ m_begin - 1 };
   }
 
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::pop_back() {
-    m_alloc.destroy(--m_end);
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::pop_back() {
+    allocator_ref().destroy(--m_end);
+    shrink_if_sparse();
   }
 
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::push_back(const T &data) {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::push_back(const T &data) {
     if (full()) grow();
-    m_alloc.construct(m_end++, data);
+    allocator_ref().construct(m_end++, data);
   }
 
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::push_back(T &&data) {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::push_back(T &&data) {
     if (full()) grow();
-    m_alloc.construct(m_end++, std::forward<T&&>(data));
+    allocator_ref().construct(m_end++, std::forward<T&&>(data));
   }
 
-  template<typename T, typename Alloc>
+  template<typename Derived, typename T, typename Alloc, typename Growth>
   template<typename... Args>
-  void vector<T, Alloc>::emplace_back(Args&&... args) {
+  void vector_base<Derived, T, Alloc, Growth>::emplace_back(Args&&... args) {
     if (full()) grow();
-    m_alloc.construct(m_end, ::std::forward<Args>(args)...);
+    allocator_ref().construct(m_end, ::std::forward<Args>(args)...);
     ++m_end;
   }
 
@@ -373,108 +833,316 @@ namespace ftl {
 
 
 
-  template<typename T, typename Alloc>
+  template<typename Derived, typename T, typename Alloc, typename Growth>
   template<typename InputIterator>
-  void vector<T, Alloc>::assign(InputIterator first, InputIterator last) {
-    clear();
-    reserve(static_cast<size_type>(::std::distance(first, last)));
-    for (auto it{ first }; it != last; ++it) {
-      emplace_back(*it);
+  void vector_base<Derived, T, Alloc, Growth>::assign(InputIterator first, InputIterator last) {
+    // vector<int>::assign(5, 1) deduces InputIterator = int, which must be treated as a fill.
+    assign_dispatch(first, last, ::std::is_integral<InputIterator>{});
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename Integral>
+  void vector_base<Derived, T, Alloc, Growth>::assign_dispatch(Integral n, Integral val, ::std::true_type) {
+    assign(static_cast<size_type>(n), static_cast<value_type>(val));
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename InputIterator>
+  void vector_base<Derived, T, Alloc, Growth>::assign_dispatch(InputIterator first, InputIterator last, ::std::false_type) {
+    assign_range(first, last, typename ::std::iterator_traits<InputIterator>::iterator_category{});
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename InputIterator>
+  void vector_base<Derived, T, Alloc, Growth>::assign_range(InputIterator first, InputIterator last, ::std::input_iterator_tag) {
+    // Single pass ranges can't be measured up front, so the existing elements are reused until either side runs out.
+    pointer it{ m_begin };
+    for (; it != m_end && first != last; ++it, ++first) {
+      *it = *first;
+    }
+    if (first == last) {
+      detail::destroy_range(allocator_ref(), it, m_end);
+      m_end = it;
+      return;
+    }
+    for (; first != last; ++first) {
+      emplace_back(*first);
     }
   }
 
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::assign(size_type n, const value_type &val) {
-    clear();
-    reserve(n);
-    for (size_type i{ 0 }; i < n; ++i) {
-      emplace_back(std::forward<decltype(val)>(val));
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename ForwardIterator>
+  void vector_base<Derived, T, Alloc, Growth>::assign_range(ForwardIterator first, ForwardIterator last, ::std::forward_iterator_tag) {
+    const size_type n{ static_cast<size_type>(::std::distance(first, last)) };
+    if (n > capacity()) {
+      // None of the existing elements survive, so drop them before reserving rather than relocating them.
+      clear();
+      derived().reserve(n);
+      m_end = detail::uninitialized_copy(allocator_ref(), first, last, m_begin);
+    }
+    else if (n <= size()) {
+      detail::copy_assign(first, n, m_begin);
+      detail::destroy_range(allocator_ref(), m_begin + n, m_end);
+      m_end = m_begin + n;
+    }
+    else {
+      ForwardIterator mid{ detail::copy_assign(first, size(), m_begin) };
+      m_end = detail::uninitialized_copy(allocator_ref(), mid, last, m_end);
     }
   }
 
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::assign(::std::initializer_list<typename vector<T, Alloc>::value_type> il) {
-    clear();
-    reserve(il.size());
-    for (auto it{ ::std::begin(il) }; it != ::std::end(il); ++it) {
-      emplace_back(*it);
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::assign(size_type n, const value_type &val) {
+    if (n > capacity()) {
+      // val may refer to an element of this vector, which clearing would destroy.
+      const value_type temp{ val };
+      clear();
+      derived().reserve(n);
+      m_end = detail::uninitialized_fill(allocator_ref(), m_begin, n, temp);
+    }
+    else if (n <= size()) {
+      ::std::fill_n(m_begin, n, val);
+      detail::destroy_range(allocator_ref(), m_begin + n, m_end);
+      m_end = m_begin + n;
+    }
+    else {
+      ::std::fill(m_begin, m_end, val);
+      m_end = detail::uninitialized_fill(allocator_ref(), m_end, n - size(), val);
     }
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::iterator vector<T, Alloc>::insert(const_iterator position, const value_type &val) {
-    iterator it{ const_cast<iterator>(position) };
-    emplace_back(val);
-    ::std::rotate(it, end() - 1, end());
-    return it;
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::assign(::std::initializer_list<typename vector_base<Derived, T, Alloc, Growth>::value_type> il) {
+    assign_range(il.begin(), il.end(), ::std::random_access_iterator_tag{});
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::iterator vector<T, Alloc>::insert(const_iterator position, size_type n, const value_type &val) {
-    iterator it{ const_cast<iterator>(position) }, n_first{ end() };
-    for (size_type i{ 0 }; i < n; ++i) {
-      emplace_back(val);
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert(const_iterator position, const value_type &val) {
+    return emplace(position, val);
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert(const_iterator position, size_type n, const value_type &val) {
+    const size_type index{ static_cast<size_type>(position - m_begin) };
+    if (n == 0) return m_begin + index;
+    if (size() + n > capacity()) {
+      detail::record_vector_event(detail::vector_event::insert_copy, n);
+      return insert_reallocate(index, n, [&](pointer dest) { detail::uninitialized_fill(allocator_ref(), dest, n, val); });
     }
-    ::std::rotate(it, n_first, end());
-    return it;
+    // val may refer to an element which is about to be shifted.
+    const value_type temp{ val };
+    return insert_in_place(index, n, detail::fill_source<value_type>{ temp }, relocation_tag{});
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename InputIterator>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert(const_iterator position, InputIterator first, InputIterator last) {
+    // vector<int>::insert(pos, 5, 1) deduces InputIterator = int, which must be treated as a fill.
+    return insert_dispatch(static_cast<size_type>(position - m_begin), first, last, ::std::is_integral<InputIterator>{});
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename Integral>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert_dispatch(size_type index, Integral n, Integral val, ::std::true_type) {
+    return insert(m_begin + index, static_cast<size_type>(n), static_cast<value_type>(val));
   }
 
-  template<typename T, typename Alloc>
+  template<typename Derived, typename T, typename Alloc, typename Growth>
   template<typename InputIterator>
-  typename vector<T, Alloc>::iterator vector<T, Alloc>::insert(const_iterator position, InputIterator first, InputIterator last) {
-    iterator it{ const_cast<iterator>(position) }, n_first{ end() };
-    for (auto it{ first }; it != last; ++it) {
-      emplace_back(*it);
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert_dispatch(size_type index, InputIterator first, InputIterator last, ::std::false_type) {
+    return insert_range(index, first, last, typename ::std::iterator_traits<InputIterator>::iterator_category{});
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename InputIterator>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert_range(size_type index, InputIterator first, InputIterator last, ::std::input_iterator_tag) {
+    // Single pass ranges can't be measured up front, so they are appended and then rotated into place.
+    // That moves every element at most a constant number of times, where inserting them one by one would be quadratic.
+    const size_type old_size{ size() };
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+    detail::record_vector_event(detail::vector_event::insert_copy, size() - old_size);
+    detail::record_vector_event(detail::vector_event::insert_move, old_size - index);
+    ::std::rotate(m_begin + index, m_begin + old_size, m_end);
+    return m_begin + index;
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename ForwardIterator>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert_range(size_type index, ForwardIterator first, ForwardIterator last, ::std::forward_iterator_tag) {
+    const size_type n{ static_cast<size_type>(::std::distance(first, last)) };
+    if (n == 0) return m_begin + index;
+    const detail::range_source<ForwardIterator> source{ first };
+    if (size() + n > capacity()) {
+      detail::record_vector_event(detail::source_event<detail::range_source<ForwardIterator>>::value, n);
+      return insert_reallocate(index, n, [&](pointer dest) { source.construct(allocator_ref(), dest, 0, n); });
+    }
+    return insert_in_place(index, n, source, relocation_tag{});
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename Construct>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert_reallocate(size_type index, size_type n, Construct construct) {
+    auto allocation = allocate_at_least(allocator_ref(), grown_capacity(size() + n));
+    detail::record_vector_event(detail::vector_event::grow, 1);
+    detail::record_vector_event(detail::vector_event::relocate, size());
+    pointer gap{ allocation.ptr + index };
+    try {
+      construct(gap);
+    }
+    catch (...) {
+      allocator_ref().deallocate(allocation.ptr, allocation.count);
+      throw;
+    }
+    pointer new_end;
+    try {
+      new_end = relocate_with_gap(allocator_ref(), m_begin, m_begin + index, m_end, allocation.ptr, n);
+    }
+    catch (...) {
+      detail::destroy_range(allocator_ref(), gap, gap + n);
+      allocator_ref().deallocate(allocation.ptr, allocation.count);
+      throw;
+    }
+    pointer old_buffer{ m_begin };
+    size_type old_capacity{ m_capacity };
+    m_begin = allocation.ptr;
+    m_end = new_end;
+    m_capacity = allocation.count;
+    derived().release_storage(old_buffer, old_capacity);
+    return gap;
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename Source>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert_in_place(size_type index, size_type n, const Source &source, ::std::true_type) {
+    pointer position{ m_begin + index };
+    const size_type tail{ size() - index };
+    detail::record_vector_event(detail::source_event<Source>::value, n);
+    detail::record_vector_event(detail::vector_event::insert_move, tail);
+    if (tail) {
+      ::std::memmove(static_cast<void*>(position + n), static_cast<const void*>(position), tail * sizeof(value_type));
+    }
+    try {
+      source.construct(allocator_ref(), position, 0, n);
+    }
+    catch (...) {
+      if (tail) {
+        ::std::memmove(static_cast<void*>(position), static_cast<const void*>(position + n), tail * sizeof(value_type));
+      }
+      throw;
+    }
+    m_end += n;
+    return position;
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename Source>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert_in_place(size_type index, size_type n, const Source &source, ::std::false_type) {
+    pointer position{ m_begin + index };
+    pointer old_end{ m_end };
+    const size_type tail{ size() - index };
+    detail::record_vector_event(detail::source_event<Source>::value, n);
+    detail::record_vector_event(detail::vector_event::insert_move, tail);
+    if (tail > n) {
+      m_end = detail::uninitialized_move(allocator_ref(), old_end - n, old_end, old_end);
+      ::std::move_backward(position, old_end - n, old_end);
+      source.assign(position, 0, n);
+    }
+    else {
+      m_end = source.construct(allocator_ref(), old_end, tail, n - tail);
+      try {
+        m_end = detail::uninitialized_move(allocator_ref(), position, old_end, m_end);
+      }
+      catch (...) {
+        detail::destroy_range(allocator_ref(), old_end, m_end);
+        m_end = old_end;
+        throw;
+      }
+      source.assign(position, 0, tail);
     }
-    ::std::rotate(it, n_first, end());
-    return it;
+    return position;
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::iterator vector<T, Alloc>::insert(const_iterator position, value_type &&val) {
-    iterator it{ const_cast<iterator>(position) };
-    emplace_back(val);
-    ::std::rotate(it, end() - 1, end());
-    return it;
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert(const_iterator position, value_type &&val) {
+    return emplace(position, ::std::move(val));
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::iterator vector<T, Alloc>::insert(const_iterator position, ::std::initializer_list<value_type> il) {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::insert(const_iterator position, ::std::initializer_list<value_type> il) {
     return insert(position, ::std::begin(il), ::std::end(il));
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::iterator vector<T, Alloc>::erase(iterator position) {
-    iterator follow{ position };
-    iterator lead{ follow + 1 };
-    for (; lead != end(); ++follow, ++lead) {
-      m_alloc.destroy(follow);
-      m_alloc.construct(follow, ::std::move(*lead));
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::erase(iterator position) {
+    const size_type index{ static_cast<size_type>(position - m_begin) };
+    detail::record_vector_event(detail::vector_event::erase_move, static_cast<size_type>(m_end - position) - 1);
+    detail::move_assign(position + 1, m_end, position);
+    allocator_ref().destroy(--m_end);
+    shrink_if_sparse();
+    return m_begin + index;
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::erase(iterator first, iterator last) {
+    const size_type index{ static_cast<size_type>(first - m_begin) };
+    detail::record_vector_event(detail::vector_event::erase_move, static_cast<size_type>(m_end - last));
+    truncate(detail::move_assign(last, m_end, first));
+    return m_begin + index;
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename Predicate>
+  typename vector_base<Derived, T, Alloc, Growth>::size_type vector_base<Derived, T, Alloc, Growth>::erase_if(Predicate pred) {
+    const size_type old_size{ size() };
+    truncate(::std::remove_if(m_begin, m_end, pred));
+    return old_size - size();
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename Predicate>
+  typename vector_base<Derived, T, Alloc, Growth>::size_type vector_base<Derived, T, Alloc, Growth>::retain(Predicate pred) {
+    return derived().erase_if([&pred](reference element) { return !pred(element); });
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  template<typename Indices>
+  typename vector_base<Derived, T, Alloc, Growth>::size_type vector_base<Derived, T, Alloc, Growth>::erase_indices(const Indices &indices) {
+    auto first = ::std::begin(indices);
+    auto last = ::std::end(indices);
+    if (first == last) return 0;
+    // Every run of survivors between two removed indices is moved down once.
+    pointer out{ m_begin + *first };
+    const pointer first_removed{ out };
+    pointer read{ out + 1 };
+    size_type removed{ 1 };
+    for (++first; first != last; ++first, ++removed) {
+      pointer next{ m_begin + *first };
+      assert(next >= read && next < m_end && "Indices must be sorted, unique and in range.");
+      out = detail::move_assign(read, next, out);
+      read = next + 1;
     }
-    pop_back();
-    return const_cast<iterator>(position);
+    detail::record_vector_event(detail::vector_event::erase_move, static_cast<size_type>(m_end - first_removed) - removed);
+    truncate(detail::move_assign(read, m_end, out));
+    return removed;
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::iterator vector<T, Alloc>::erase(iterator first, iterator last) {
-    iterator follow{ first };
-    iterator lead{ last };
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::size_type vector_base<Derived, T, Alloc, Growth>::erase_indices(::std::initializer_list<size_type> indices) {
+    return derived().template erase_indices<::std::initializer_list<size_type>>(indices);
+  }
 
-    for (; lead != end() && follow != last; ++lead, ++follow) {
-      m_alloc.destroy(follow);
-      m_alloc.construct(follow, ::std::move(*lead));
-    }
-    iterator new_end{ follow };
-    while (end() != new_end) {
-      pop_back();
-    }
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::truncate(pointer new_end) {
+    detail::destroy_range(allocator_ref(), new_end, m_end);
     m_end = new_end;
-    return const_cast<iterator>(first);
+    shrink_if_sparse();
   }
 
-  template<typename T, typename Alloc>
+  template<typename Derived, typename T, typename Alloc, typename Growth>
   template<typename Vector>
-  void vector<T, Alloc>::swap(Vector &other) {
+  void vector_base<Derived, T, Alloc, Growth>::swap(Vector &other) {
     static_assert(::std::is_same<value_type, typename Vector::value_type>::value, "Swapping the elements of two vectors requires that they have the same value type.");
 
     if (size() > other.size()) {
@@ -507,168 +1175,392 @@ namespace ftl {
     }
 
   }
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::swap(vector<T, Alloc> &other) {
-    ::std::swap(this->m_begin, other.m_begin);
-    ::std::swap(this->m_end, other.m_end);
-    ::std::swap(this->m_capacity, other.m_capacity);
-    ::std::swap(this->m_alloc, other.m_alloc);
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::swap(Derived &other) {
+    if (propagate_swap_tag::value || allocators_equal(allocator_ref(), other.allocator_ref())) {
+      ::std::swap(this->m_begin, other.m_begin);
+      ::std::swap(this->m_end, other.m_end);
+      ::std::swap(this->m_capacity, other.m_capacity);
+      swap_allocators(other, propagate_swap_tag{});
+      return;
+    }
+    // Neither buffer can change owners, so the elements are relocated between them.
+    Derived temp(::std::move(other));
+    other = ::std::move(derived());
+    derived() = ::std::move(temp);
   }
 
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::clear() noexcept {
-    while (!this->empty()) pop_back();
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::clear() noexcept {
+    detail::destroy_range(allocator_ref(), m_begin, m_end);
+    m_end = m_begin;
   }
 
-  template<typename T, typename Alloc>
+  template<typename Derived, typename T, typename Alloc, typename Growth>
   template<typename... Args>
-  typename vector<T, Alloc>::iterator vector<T, Alloc>::emplace(const_iterator position, Args&&... args) {
-    iterator it{ const_cast<iterator>(position) }, n_first{ end() };
-    emplace_back(::std::forward<Args>(args)...);
-    ::std::rotate(it, n_first, end());
-    return it;
+  typename vector_base<Derived, T, Alloc, Growth>::iterator vector_base<Derived, T, Alloc, Growth>::emplace(const_iterator position, Args&&... args) {
+    const size_type index{ static_cast<size_type>(position - m_begin) };
+    if (full()) {
+      return insert_reallocate(index, 1, [&](pointer dest) { allocator_ref().construct(dest, ::std::forward<Args>(args)...); });
+    }
+    if (index == size()) {
+      allocator_ref().construct(m_end, ::std::forward<Args>(args)...);
+      return m_end++;
+    }
+    // The arguments may refer to an element which is about to be shifted, so the new element is built first.
+    value_type temp(::std::forward<Args>(args)...);
+    return insert_in_place(index, 1, detail::move_source<value_type>{ temp }, relocation_tag{});
   }
 
-  template<typename T, typename Alloc>
-  void vector<T, Alloc>::grow() {
-    size_type new_capacity{ (capacity() != 0) ? (capacity() * 2) : 10 };
-    reserve(new_capacity);
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::grow() {
+    grow_to(size() + 1);
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  void vector_base<Derived, T, Alloc, Growth>::grow_to(size_type required) {
+    if (required <= capacity()) return;
+    detail::record_vector_event(detail::vector_event::grow, 1);
+    derived().reserve(grown_capacity(required));
+  }
+
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::size_type vector_base<Derived, T, Alloc, Growth>::grown_capacity(size_type required) const noexcept {
+    size_type new_capacity{ growth_policy::next_capacity(capacity(), required, sizeof(value_type)) };
+    if (new_capacity > max_size()) new_capacity = max_size();
+    if (new_capacity < required) new_capacity = required;
+    return new_capacity;
   }
 
 
 
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::reference vector<T, Alloc>::front() const {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::reference vector_base<Derived, T, Alloc, Growth>::front() const {
     return *m_begin;
   }
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::reference vector<T, Alloc>::back() const {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::reference vector_base<Derived, T, Alloc, Growth>::back() const {
     return *(m_end - 1);
   }
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::pointer vector<T, Alloc>::data() const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::pointer vector_base<Derived, T, Alloc, Growth>::data() const noexcept {
     return m_begin;
   }
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::reference vector<T, Alloc>::at(size_type n) noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::reference vector_base<Derived, T, Alloc, Growth>::at(size_type n) noexcept {
     assert(n < size());
     return *(m_begin + n);
   }
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::const_reference vector<T, Alloc>::at(size_type n) const noexcept {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::const_reference vector_base<Derived, T, Alloc, Growth>::at(size_type n) const noexcept {
     assert(n < size());
     return *(m_begin + n);
   }
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::reference vector<T, Alloc>::operator[](size_type n) {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::reference vector_base<Derived, T, Alloc, Growth>::operator[](size_type n) {
     return *(m_begin + n);
   }
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::const_reference vector<T, Alloc>::operator[](size_type n) const {
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::const_reference vector_base<Derived, T, Alloc, Growth>::operator[](size_type n) const {
     return *(m_begin + n);
   }
 
-  template<typename T, typename Alloc>
-  typename vector<T, Alloc>::allocator_type vector<T, Alloc>::get_allocator() const noexcept {
-    return m_alloc;
+  template<typename Derived, typename T, typename Alloc, typename Growth>
+  typename vector_base<Derived, T, Alloc, Growth>::allocator_type vector_base<Derived, T, Alloc, Growth>::get_allocator() const noexcept {
+    return allocator_ref();
   }
 
 
+  // vector implementation with ::std::vector parity
+  template<typename T, typename Alloc = default_allocator<T>, typename Growth = default_growth>
+  class vector : public vector_base<vector<T, Alloc, Growth>, T, Alloc, Growth> {
+    using base = vector_base<vector<T, Alloc, Growth>, T, Alloc, Growth>;
+  public:
+    using base::base;
+    using base::operator=;
+    vector() = default;
+  };
+
+
+  // A vector whose data() is aligned to Align bytes, for SIMD loops and per-thread arrays free of false sharing.
+  template<typename T, std::size_t Align = 64, typename Growth = default_growth>
+  using aligned_vector = vector<T, aligned_allocator<T, Align>, Growth>;
+
+
   // inline_vector is a vector derivative with a built in storage buffer for the first N elements,
   // where N is specified as a non-type template parameter.
-  template <typename T, std::size_t N, typename Alloc = default_allocator<T>>
-  class inline_vector : public vector<T, Alloc> {
+  template <typename T, std::size_t N, typename Alloc = default_allocator<T>, typename Growth = default_growth>
+  class inline_vector : public vector_base<inline_vector<T, N, Alloc, Growth>, T, Alloc, Growth> {
+    using base = vector_base<inline_vector<T, N, Alloc, Growth>, T, Alloc, Growth>;
   public:
     using value_type = T;
-    using pointer = typename vector<T, Alloc>::pointer;
-    using size_type = typename vector<T, Alloc>::size_type;
-    inline_vector()
-      : vector<T, Alloc>(reinterpret_cast<pointer>(inline_buffer),
-        reinterpret_cast<pointer>(inline_buffer),
-        N)
-    {}
-    virtual ~inline_vector() override;
-
-    virtual void reserve(size_type elements) override;
+    using allocator_type = Alloc;
+    using pointer = typename base::pointer;
+    using size_type = typename base::size_type;
+
+    inline_vector();
+    explicit inline_vector(const allocator_type &alloc);
+    inline_vector(::std::initializer_list<value_type> il, const allocator_type &alloc = allocator_type{});
+    inline_vector(const inline_vector &other);
+    inline_vector(inline_vector &&other);
+    ~inline_vector();
+
+    inline_vector& operator=(const inline_vector &other);
+    inline_vector& operator=(inline_vector &&other);
+    using base::operator=;
+
+    using base::swap;
+    void swap(inline_vector &other);
   protected:
+    friend base;
+    // Moves the elements back into the inline buffer once they fit, and releases the heap block.
+    void shrink_capacity(size_type elements);
+    // The inline buffer is part of the vector and is never deallocated.
+    void release_storage(pointer buffer, size_type capacity) noexcept;
+    bool owns_storage() const noexcept { return !is_inline(); }
   private:
-    char inline_buffer[sizeof(value_type) * N];
+    pointer inline_data() noexcept { return reinterpret_cast<pointer>(inline_buffer); }
+    bool is_inline() const noexcept { return this->m_begin == reinterpret_cast<const T*>(inline_buffer); }
+    // Takes the elements of other, which is left empty. This vector must be empty and using its inline buffer.
+    void steal(inline_vector &other);
+    // Destroys the elements and goes back to the inline buffer.
+    void release_heap_storage() noexcept;
+    // Move assignment, taking other's allocator along if Propagate is true_type.
+    template<typename Propagate>
+    void move_from(inline_vector &other, Propagate propagate);
+
+    // Aligned like the blocks of the allocator, so data() is as aligned inline as it is on the heap.
+    alignas(detail::allocation_alignment<Alloc>::value) char inline_buffer[sizeof(value_type) * N];
   };
-  template<typename T, std::size_t N, typename Alloc>
-  inline_vector<T, N, Alloc>::~inline_vector() {
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  inline_vector<T, N, Alloc, Growth>::inline_vector()
+    : base(reinterpret_cast<pointer>(inline_buffer), reinterpret_cast<pointer>(inline_buffer), N) {
+  }
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  inline_vector<T, N, Alloc, Growth>::inline_vector(const allocator_type &alloc)
+    : base(reinterpret_cast<pointer>(inline_buffer), reinterpret_cast<pointer>(inline_buffer), N, alloc) {
+  }
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  inline_vector<T, N, Alloc, Growth>::inline_vector(::std::initializer_list<value_type> il, const allocator_type &alloc)
+    : inline_vector(alloc) {
+    this->assign(il);
+  }
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  inline_vector<T, N, Alloc, Growth>::inline_vector(const inline_vector &other)
+    : inline_vector(select_on_container_copy_construction(other.allocator_ref())) {
+    this->assign(other.begin(), other.end());
+  }
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  inline_vector<T, N, Alloc, Growth>::inline_vector(inline_vector &&other)
+    : inline_vector(other.get_allocator()) {
+    steal(other);
+  }
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  inline_vector<T, N, Alloc, Growth>::~inline_vector() {
     this->clear();
-    if (!(this->m_begin == (pointer)this->inline_buffer)) {
-      this->m_alloc.deallocate(this->m_begin, this->m_capacity);
+    if (!is_inline()) {
+      this->allocator_ref().deallocate(this->m_begin, this->m_capacity);
     }
+    // Leave nothing for the base destructor to release.
     this->m_begin = nullptr;
     this->m_end = nullptr;
     this->m_capacity = 0;
   }
-  template<typename T, std::size_t N, typename Alloc>
-  void inline_vector<T, N, Alloc>::reserve(size_type elements) {
-    if (this->capacity() >= elements) return;
-    // The special case where the inline buffer is the current storage needs to be handled.
-    // The buffer shouldn't be deallocated, so the special case for that is implemented here.
-    if (this->m_begin == reinterpret_cast<pointer>(inline_buffer)) {
-
-      pointer new_buffer = this->m_alloc.allocate(elements);
-      pointer temp_begin = this->begin(), temp_end = this->end();
-      this->m_begin = this->m_end = new_buffer;
-      size_type old_capacity{ this->capacity() };
-      this->m_capacity = elements;
-      this->assign(temp_begin, temp_end);
-
-      for (auto it{ temp_begin }; it != temp_end; ++it) {
-        this->m_alloc.destroy(it);
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  inline_vector<T, N, Alloc, Growth>& inline_vector<T, N, Alloc, Growth>::operator=(const inline_vector &other) {
+    if (this != &other) {
+      if (base::propagate_copy_tag::value && !allocators_equal(this->allocator_ref(), other.allocator_ref())) {
+        release_heap_storage();
       }
+      this->propagate_allocator(other.allocator_ref(), typename base::propagate_copy_tag{});
+      this->assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  inline_vector<T, N, Alloc, Growth>& inline_vector<T, N, Alloc, Growth>::operator=(inline_vector &&other) {
+    if (this != &other) {
+      move_from(other, typename base::propagate_move_tag{});
+    }
+    return *this;
+  }
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  template<typename Propagate>
+  void inline_vector<T, N, Alloc, Growth>::move_from(inline_vector &other, Propagate propagate) {
+    release_heap_storage();
+    this->propagate_allocator(other.allocator_ref(), propagate);
+    steal(other);
+  }
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  void inline_vector<T, N, Alloc, Growth>::release_heap_storage() noexcept {
+    this->clear();
+    if (!is_inline()) {
+      this->allocator_ref().deallocate(this->m_begin, this->m_capacity);
+      this->m_begin = this->m_end = inline_data();
+      this->m_capacity = N;
+    }
+  }
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  void inline_vector<T, N, Alloc, Growth>::steal(inline_vector &other) {
+    if (other.is_inline() || !allocators_equal(this->allocator_ref(), other.allocator_ref())) {
+      // Elements in the other inline buffer, or in a heap buffer this allocator can't free, can't change owners,
+      // so they are relocated into this vector's own storage.
+      this->reserve(other.size());
+      this->m_end = relocate(this->allocator_ref(), other.m_begin, other.m_end, this->m_begin);
+      other.m_end = other.m_begin;
     }
     else {
-      // If the current buffer isn't the inline buffer, we can just use the default grow() method.
-      vector<T, Alloc>::reserve(elements);
+      this->m_begin = other.m_begin;
+      this->m_end = other.m_end;
+      this->m_capacity = other.m_capacity;
+      other.m_begin = other.m_end = other.inline_data();
+      other.m_capacity = N;
     }
   }
-  
-template<typename T, typename Alloc = default_allocator<T>>
-class unordered_vector : public vector<T, Alloc> {
-public:
-  using iterator = typename vector<T, Alloc>::iterator;
-  
-  using vector<T, Alloc>::vector;
-  iterator erase(iterator position) override;
-  iterator erase(iterator first, iterator last) override;
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  void inline_vector<T, N, Alloc, Growth>::release_storage(pointer buffer, size_type capacity) noexcept {
+    if (buffer != inline_data()) {
+      this->allocator_ref().deallocate(buffer, capacity);
+    }
+    else {
+      // The elements just moved out of the inline buffer.
+      detail::record_vector_event(detail::vector_event::inline_spill, 1);
+    }
+  }
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  void inline_vector<T, N, Alloc, Growth>::shrink_capacity(size_type elements) {
+    if (is_inline()) return;
+    if (this->size() > N) {
+      base::shrink_capacity(elements);
+      return;
+    }
+    pointer heap_buffer{ this->m_begin };
+    size_type heap_capacity{ this->m_capacity };
+    this->m_end = relocate(this->allocator_ref(), this->m_begin, this->m_end, inline_data());
+    this->m_begin = inline_data();
+    this->m_capacity = N;
+    this->allocator_ref().deallocate(heap_buffer, heap_capacity);
+  }
+  template<typename T, std::size_t N, typename Alloc, typename Growth>
+  void inline_vector<T, N, Alloc, Growth>::swap(inline_vector &other) {
+    using propagate = typename base::propagate_swap_tag;
+    if (!is_inline() && !other.is_inline() && (propagate::value || allocators_equal(this->allocator_ref(), other.allocator_ref()))) {
+      base::swap(other);
+      return;
+    }
+    // Inline elements can't change owners, so they are relocated, as are heap elements when the allocators differ
+    // and don't propagate.
+    inline_vector temp(::std::move(other));
+    other.move_from(*this, propagate{});
+    move_from(temp, propagate{});
+  }
 
+template<typename T, typename Alloc = default_allocator<T>, typename Growth = default_growth>
+class unordered_vector : public vector_base<unordered_vector<T, Alloc, Growth>, T, Alloc, Growth> {
+  using base = vector_base<unordered_vector<T, Alloc, Growth>, T, Alloc, Growth>;
+public:
+  using iterator = typename base::iterator;
+  using pointer = typename base::pointer;
+  using size_type = typename base::size_type;
+
+  using base::base;
+  using base::operator=;
+  unordered_vector() = default;
+  // Erasing fills the hole with elements from the back, so only the moved elements change position.
+  iterator erase(iterator position);
+  iterator erase(iterator first, iterator last);
+  template<typename Predicate>
+  size_type erase_if(Predicate pred);
+  using base::retain;
+  template<typename Indices>
+  size_type erase_indices(const Indices &indices);
+  using base::erase_indices;
 };
   
 
-template<typename T, typename Alloc>
-typename vector<T, Alloc>::iterator unordered_vector<T, Alloc>::erase(iterator position) {
+template<typename T, typename Alloc, typename Growth>
+typename unordered_vector<T, Alloc, Growth>::iterator unordered_vector<T, Alloc, Growth>::erase(iterator position) {
+  const auto index{ position - this->m_begin };
   iterator it{ position };
   if (it != this->m_end - 1) {
-    *it = this->back();
+    detail::record_vector_event(detail::vector_event::erase_move, 1);
+    *it = ::std::move(this->back());
   }
-  this->pop_back();
-  return const_cast<iterator>(position);
+  this->truncate(this->m_end - 1);
+  return this->m_begin + index;
 }
 
-template<typename T, typename Alloc>
-typename vector<T, Alloc>::iterator unordered_vector<T, Alloc>::erase(iterator first, iterator last) {
+template<typename T, typename Alloc, typename Growth>
+typename unordered_vector<T, Alloc, Growth>::iterator unordered_vector<T, Alloc, Growth>::erase(iterator first, iterator last) {
   assert(first >= this->m_begin && "Iterator out of range.");
   assert(last <= this->m_end && "Iterator out of range.");
-   const iterator temp_end{ last }, temp_begin{ first };
-  if (temp_end == this->m_end) {
-    while (this->m_end >= temp_begin)
-      this->pop_back();
-    return const_cast<iterator>(first);
+  const auto index{ first - this->m_begin };
+  const size_type count{ static_cast<size_type>(last - first) };
+  const size_type after{ static_cast<size_type>(this->m_end - last) };
+  // Only as many elements as the hole can take are moved in from the back.
+  const size_type moved{ count < after ? count : after };
+  detail::record_vector_event(detail::vector_event::erase_move, moved);
+  detail::move_assign(this->m_end - moved, this->m_end, first);
+  this->truncate(this->m_end - count);
+  return this->m_begin + index;
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename Predicate>
+typename unordered_vector<T, Alloc, Growth>::size_type unordered_vector<T, Alloc, Growth>::erase_if(Predicate pred) {
+  const size_type old_size{ this->size() };
+  pointer it{ this->m_begin };
+  pointer last{ this->m_end };
+  // Every removed element is replaced by the last survivor, so each element is tested once and moved at most once.
+  while (it != last) {
+    if (!pred(*it)) {
+      ++it;
+      continue;
+    }
+    do {
+      --last;
+    } while (last != it && pred(*last));
+    if (last == it) break;
+    detail::record_vector_event(detail::vector_event::erase_move, 1);
+    *it = ::std::move(*last);
+    ++it;
+  }
+  this->truncate(last);
+  return old_size - this->size();
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename Indices>
+typename unordered_vector<T, Alloc, Growth>::size_type unordered_vector<T, Alloc, Growth>::erase_indices(const Indices &indices) {
+  auto first = ::std::begin(indices);
+  auto it = ::std::end(indices);
+  pointer last{ this->m_end };
+  // Walking the indices from the back means everything past the current one is a survivor which may fill its slot.
+  while (it != first) {
+    pointer position{ this->m_begin + *--it };
+    assert(position < last && "Indices must be sorted, unique and in range.");
+    if (position != --last) {
+      detail::record_vector_event(detail::vector_event::erase_move, 1);
+      *position = ::std::move(*last);
+    }
+  }
+  const size_type removed{ static_cast<size_type>(this->m_end - last) };
+  this->truncate(last);
+  return removed;
+}
+
+  // Free function forms of the bulk removals, dispatching to the concrete vector type.
+  template<typename Derived, typename T, typename Alloc, typename Growth, typename Predicate>
+  typename vector_base<Derived, T, Alloc, Growth>::size_type erase_if(vector_base<Derived, T, Alloc, Growth> &vec, Predicate pred) {
+    return static_cast<Derived&>(vec).erase_if(pred);
   }
-  iterator it{ temp_begin };
-  for (; it != last && last != this->m_end; ++it) {
-    *it = this->back();
-    this->pop_back();
+  template<typename Derived, typename T, typename Alloc, typename Growth, typename Predicate>
+  typename vector_base<Derived, T, Alloc, Growth>::size_type retain(vector_base<Derived, T, Alloc, Growth> &vec, Predicate pred) {
+    return static_cast<Derived&>(vec).retain(pred);
   }
-  while (it++ != last) {
-    this->pop_back();
+  template<typename Derived, typename T, typename Alloc, typename Growth, typename Indices>
+  typename vector_base<Derived, T, Alloc, Growth>::size_type erase_indices(vector_base<Derived, T, Alloc, Growth> &vec, const Indices &indices) {
+    return static_cast<Derived&>(vec).erase_indices(indices);
   }
-  return (temp_begin);
-}
 } // namespace ftl
@@ -0,0 +1,290 @@
+// All content copyright (C) Allan Deutsch 2017. All rights reserved.
+
+#pragma once
+
+#include "report.hpp" // report_format
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <iomanip> // setw
+#include <ostream> // ostream
+
+// Instrumentation of the vector family's hot paths is off unless the build defines FTL_INSTRUMENT_VECTORS to 1.
+// Off, the event hooks are empty inline functions, so vectors compile to the same code as without them, and
+// sites, scopes and summaries still compile but count nothing. Every translation unit of a program must agree on it.
+#ifndef FTL_INSTRUMENT_VECTORS
+#define FTL_INSTRUMENT_VECTORS 0
+#endif
+
+#if FTL_INSTRUMENT_VECTORS
+#include <atomic> // atomic
+#include <mutex> // mutex, lock_guard
+#include <vector> // the site and thread registries
+#endif
+
+namespace ftl {
+
+  // What the vectors did while attributed to a site.
+  struct vector_event_counts {
+    // Reallocations made because the vector was full, by push_back, insert, resize, ...
+    ::std::uint64_t grows;
+    // Elements moved (or copied, when moving may throw) to a new buffer by a reallocation.
+    ::std::uint64_t relocated_elements;
+    // Elements insert copied in from its arguments.
+    ::std::uint64_t insert_copies;
+    // Elements insert moved: ones moved in from its arguments, and live ones shifted to open the gap.
+    ::std::uint64_t insert_moves;
+    // Live elements erase moved to close the gap.
+    ::std::uint64_t erase_moves;
+    // inline_vectors which outgrew their inline buffer.
+    ::std::uint64_t inline_spills;
+  };
+
+  // vector_site names the code vector events are attributed to. Events go to the site of the innermost
+  // vector_site_scope active on the thread, or to vector_site::unattributed() outside of any. Each thread counts into
+  // its own counters, which only it writes, and the counts of a site are summed over threads when read.
+  // Sites must outlive their scopes, so they are usually statics; FTL_VECTOR_SITE declares one with a scope:
+  //   void rebuild_index() {
+  //     FTL_VECTOR_SITE("rebuild_index");
+  //     ...
+  //   }
+  class vector_site {
+  public:
+    // Sites created beyond this many fold into unattributed(): their events and counts are its, and they aren't
+    // listed in summaries of their own.
+    static constexpr ::std::size_t max_sites{ 64 };
+
+    explicit vector_site(const char *name);
+    vector_site(const vector_site &) = delete;
+    vector_site& operator=(const vector_site &) = delete;
+    ~vector_site();
+
+    const char* name() const noexcept { return m_name; }
+    // The events of this site so far, over every thread.
+    vector_event_counts counts() const;
+
+    static vector_site& unattributed();
+    // Calls f(const vector_site&) for every live site, in the order they were created.
+    template<typename F>
+    static void for_each(F &&f);
+
+  private:
+    friend class vector_site_scope;
+    struct unattributed_tag {};
+    vector_site(const char *name, unattributed_tag);
+
+    const char *m_name;
+#if FTL_INSTRUMENT_VECTORS
+    ::std::size_t m_id;
+#endif
+  };
+
+  // Attributes the vector events of the thread to a site while it lives.
+  class vector_site_scope {
+  public:
+    explicit vector_site_scope(vector_site &site) noexcept;
+    vector_site_scope(const vector_site_scope &) = delete;
+    vector_site_scope& operator=(const vector_site_scope &) = delete;
+    ~vector_site_scope();
+  private:
+#if FTL_INSTRUMENT_VECTORS
+    ::std::size_t m_previous;
+#endif
+  };
+
+#define FTL_VECTOR_SITE_JOIN2(a, b) a##b
+#define FTL_VECTOR_SITE_JOIN(a, b) FTL_VECTOR_SITE_JOIN2(a, b)
+#define FTL_VECTOR_SITE(name) \
+  static ::ftl::vector_site FTL_VECTOR_SITE_JOIN(ftl_vector_site_, __LINE__){ name }; \
+  ::ftl::vector_site_scope FTL_VECTOR_SITE_JOIN(ftl_vector_site_scope_, __LINE__){ FTL_VECTOR_SITE_JOIN(ftl_vector_site_, __LINE__) }
+
+  // Writes the counts of every site, as a table or as a JSON array of objects.
+  void write_vector_event_summary(::std::ostream &out, report_format format = report_format::text);
+
+  namespace detail {
+    enum class vector_event : ::std::size_t { grow, relocate, insert_copy, insert_move, erase_move, inline_spill, count };
+
+#if FTL_INSTRUMENT_VECTORS
+    using event_row = ::std::atomic<::std::uint64_t>[static_cast<::std::size_t>(vector_event::count)];
+
+    // The counters of one thread, a row per site. Only the owning thread writes them, so they are bumped with
+    // relaxed loads and stores rather than read-modify-writes, and other threads may read them for summaries.
+    struct thread_vector_events {
+      thread_vector_events();
+      ~thread_vector_events();
+      event_row rows[vector_site::max_sites];
+      ::std::size_t current_site{ 0 };
+    };
+
+    struct vector_event_registry {
+      ::std::mutex mutex;
+      ::std::vector<const vector_site*> sites;
+      ::std::vector<const thread_vector_events*> threads;
+      // The counts of threads which have exited.
+      ::std::uint64_t retired[vector_site::max_sites][static_cast<::std::size_t>(vector_event::count)]{};
+      ::std::size_t next_site_id{ 1 };
+    };
+
+    inline vector_event_registry& vector_events_registry() {
+      static vector_event_registry instance;
+      return instance;
+    }
+
+    inline thread_vector_events::thread_vector_events() {
+      for (auto &row : rows) {
+        for (auto &count : row) count.store(0, ::std::memory_order_relaxed);
+      }
+      vector_event_registry &registry = vector_events_registry();
+      ::std::lock_guard<::std::mutex> lock{ registry.mutex };
+      registry.threads.push_back(this);
+    }
+
+    inline thread_vector_events::~thread_vector_events() {
+      vector_event_registry &registry = vector_events_registry();
+      ::std::lock_guard<::std::mutex> lock{ registry.mutex };
+      for (::std::size_t site{ 0 }; site < vector_site::max_sites; ++site) {
+        for (::std::size_t event{ 0 }; event < static_cast<::std::size_t>(vector_event::count); ++event) {
+          registry.retired[site][event] += rows[site][event].load(::std::memory_order_relaxed);
+        }
+      }
+      for (auto it = registry.threads.begin(); it != registry.threads.end(); ++it) {
+        if (*it == this) {
+          registry.threads.erase(it);
+          break;
+        }
+      }
+    }
+
+    inline thread_vector_events& this_thread_vector_events() {
+      static thread_local thread_vector_events instance;
+      return instance;
+    }
+
+    inline void record_vector_event(vector_event event, ::std::size_t n) noexcept {
+      if (n == 0) return;
+      thread_vector_events &events = this_thread_vector_events();
+      ::std::atomic<::std::uint64_t> &count = events.rows[events.current_site][static_cast<::std::size_t>(event)];
+      count.store(count.load(::std::memory_order_relaxed) + n, ::std::memory_order_relaxed);
+    }
+#else
+    inline void record_vector_event(vector_event, ::std::size_t) noexcept {}
+#endif
+  } // namespace detail
+
+#if FTL_INSTRUMENT_VECTORS
+  inline vector_site::vector_site(const char *name) : m_name{ name } {
+    detail::vector_event_registry &registry = detail::vector_events_registry();
+    ::std::lock_guard<::std::mutex> lock{ registry.mutex };
+    // Ids aren't reused, so the counts of a destroyed site never show up under a new one.
+    if (registry.next_site_id < max_sites) {
+      m_id = registry.next_site_id++;
+      registry.sites.push_back(this);
+    }
+    else {
+      m_id = 0;
+    }
+  }
+
+  inline vector_site::vector_site(const char *name, unattributed_tag) : m_name{ name }, m_id{ 0 } {
+    detail::vector_event_registry &registry = detail::vector_events_registry();
+    ::std::lock_guard<::std::mutex> lock{ registry.mutex };
+    registry.sites.push_back(this);
+  }
+
+  inline vector_site::~vector_site() {
+    detail::vector_event_registry &registry = detail::vector_events_registry();
+    ::std::lock_guard<::std::mutex> lock{ registry.mutex };
+    for (auto it = registry.sites.begin(); it != registry.sites.end(); ++it) {
+      if (*it == this) {
+        registry.sites.erase(it);
+        break;
+      }
+    }
+  }
+
+  inline vector_site& vector_site::unattributed() {
+    // Threads start out counting into row 0.
+    static vector_site instance{ "unattributed", unattributed_tag{} };
+    return instance;
+  }
+
+  inline vector_event_counts vector_site::counts() const {
+    ::std::uint64_t totals[static_cast<::std::size_t>(detail::vector_event::count)];
+    detail::vector_event_registry &registry = detail::vector_events_registry();
+    {
+      ::std::lock_guard<::std::mutex> lock{ registry.mutex };
+      for (::std::size_t event{ 0 }; event < static_cast<::std::size_t>(detail::vector_event::count); ++event) {
+        totals[event] = registry.retired[m_id][event];
+        for (const detail::thread_vector_events *thread : registry.threads) {
+          totals[event] += thread->rows[m_id][event].load(::std::memory_order_relaxed);
+        }
+      }
+    }
+    return { totals[0], totals[1], totals[2], totals[3], totals[4], totals[5] };
+  }
+
+  template<typename F>
+  void vector_site::for_each(F &&f) {
+    unattributed();
+    detail::vector_event_registry &registry = detail::vector_events_registry();
+    ::std::vector<const vector_site*> sites;
+    {
+      ::std::lock_guard<::std::mutex> lock{ registry.mutex };
+      sites = registry.sites;
+    }
+    for (const vector_site *site : sites) f(*site);
+  }
+
+  inline vector_site_scope::vector_site_scope(vector_site &site) noexcept {
+    detail::thread_vector_events &events = detail::this_thread_vector_events();
+    m_previous = events.current_site;
+    events.current_site = site.m_id;
+  }
+
+  inline vector_site_scope::~vector_site_scope() {
+    detail::this_thread_vector_events().current_site = m_previous;
+  }
+#else
+  inline vector_site::vector_site(const char *name) : m_name{ name } {}
+  inline vector_site::vector_site(const char *name, unattributed_tag) : m_name{ name } {}
+  inline vector_site::~vector_site() {}
+  inline vector_site& vector_site::unattributed() {
+    static vector_site instance{ "unattributed", unattributed_tag{} };
+    return instance;
+  }
+  inline vector_event_counts vector_site::counts() const { return {}; }
+  template<typename F>
+  void vector_site::for_each(F &&f) {
+    f(static_cast<const vector_site&>(unattributed()));
+  }
+  inline vector_site_scope::vector_site_scope(vector_site &) noexcept {}
+  inline vector_site_scope::~vector_site_scope() {}
+#endif
+
+  inline void write_vector_event_summary(::std::ostream &out, report_format format) {
+    if (format == report_format::json) {
+      bool first{ true };
+      out << '[';
+      vector_site::for_each([&](const vector_site &site) {
+        const vector_event_counts c{ site.counts() };
+        out << (first ? "{\"site\":" : ",{\"site\":");
+        detail::write_json_string(out, site.name());
+        out << ",\"grows\":" << c.grows << ",\"relocated_elements\":" << c.relocated_elements
+          << ",\"insert_copies\":" << c.insert_copies << ",\"insert_moves\":" << c.insert_moves
+          << ",\"erase_moves\":" << c.erase_moves << ",\"inline_spills\":" << c.inline_spills << '}';
+        first = false;
+      });
+      out << "]\n";
+      return;
+    }
+    out << ::std::left << ::std::setw(24) << "site" << ::std::right << ::std::setw(12) << "grows" << ::std::setw(14) << "relocated"
+      << ::std::setw(14) << "ins_copies" << ::std::setw(14) << "ins_moves" << ::std::setw(14) << "erase_moves" << ::std::setw(8) << "spills" << '\n';
+    vector_site::for_each([&](const vector_site &site) {
+      const vector_event_counts c{ site.counts() };
+      out << ::std::left << ::std::setw(24) << site.name() << ::std::right << ::std::setw(12) << c.grows << ::std::setw(14) << c.relocated_elements
+        << ::std::setw(14) << c.insert_copies << ::std::setw(14) << c.insert_moves << ::std::setw(14) << c.erase_moves
+        << ::std::setw(8) << c.inline_spills << '\n';
+    });
+  }
+
+} // namespace ftl